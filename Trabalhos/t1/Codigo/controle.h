@@ -11,10 +11,19 @@ typedef struct controle_t controle_t;
 #include "cpu.h"
 #include "console.h"
 #include "relogio.h"
+#include "pic.h"
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio);
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          pic_t *pic);
 void controle_destroi(controle_t *self);
 
+// coloca o controlador em modo lote, para execução sem operador
+// nesse modo, a execução começa sem esperar comando e termina quando a CPU
+//   estiver parada sem nenhum evento agendado (o SO indica assim que não tem
+//   mais nada a fazer); no final, é impressa na saída padrão uma linha com o
+//   resumo da execução
+void controle_define_lote(controle_t *self);
+
 // o laço principal da simulação
 void controle_laco(controle_t *self);
 
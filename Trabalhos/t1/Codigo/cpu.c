@@ -33,6 +33,13 @@ struct cpu_t {
   // função e argumento para implementar instrução CHAMAC
   func_chamaC_t funcaoC;
   void *argC;
+  // endereço onde cpu_executa_n deve parar (-1 se nenhum)
+  int breakpoint;
+  // se cpu_executa_n parou no breakpoint e o PC ainda não saiu dele; a
+  //   próxima execução começa pela instrução do breakpoint
+  bool no_breakpoint;
+  // se uma interrupção foi aceita (zerado no início de cpu_executa_n)
+  bool interrompida;
 };
 
 // CRIAÇÃO {{{1
@@ -52,6 +59,9 @@ cpu_t *cpu_cria(mem_t *mem, es_t *es)
   self->complemento = 0;
   self->modo = usuario;
   self->funcaoC = NULL;
+  self->breakpoint = -1;
+  self->no_breakpoint = false;
+  self->interrompida = false;
   // inicializa instruções privilegiadas
   memset(self->privilegiadas, 0, sizeof(self->privilegiadas));
   self->privilegiadas[PARA] = true;
@@ -77,6 +87,12 @@ void cpu_define_chamaC(cpu_t *self, func_chamaC_t funcaoC, void *argC)
   self->argC = argC;
 }
 
+void cpu_define_breakpoint(cpu_t *self, int endereco)
+{
+  self->breakpoint = endereco;
+  self->no_breakpoint = false;
+}
+
 // IMPRESSÃO {{{1
 static void imprime_registradores(cpu_t *self, char *str)
 {
@@ -484,6 +500,59 @@ void cpu_executa_1(cpu_t *self)
   }
 }
 
+// EXECUTA VÁRIAS INSTRUÇÕES {{{1
+
+// retorna true se a instrução no PC acessa dispositivos de E/S; CHAMAC conta,
+//   porque o SO acessa dispositivos
+// se a leitura não for possível, a execução vai causar o erro
+static bool instrucao_usa_es(cpu_t *self)
+{
+  int opcode;
+  if (mem_le(self->mem, self->PC, &opcode) != ERR_OK) return false;
+  return opcode == LE || opcode == ESCR || opcode == CHAMAC;
+}
+
+int cpu_executa_n(cpu_t *self, int max, cpu_parada_t *pmotivo, int *pespera)
+{
+  int n = 0;
+  *pmotivo = parada_limite;
+  *pespera = 0;
+  self->interrompida = false;
+  while (n < max) {
+    if (self->erro != ERR_OK) {
+      *pmotivo = parada_erro;
+      break;
+    }
+    if (self->PC == self->breakpoint && !self->no_breakpoint) {
+      self->no_breakpoint = true;
+      *pmotivo = parada_breakpoint;
+      break;
+    }
+    self->no_breakpoint = false;
+    bool es = instrucao_usa_es(self);
+    if (es && n > 0) {
+      *pmotivo = parada_es;
+      break;
+    }
+    cpu_modo_t modo = self->modo;
+    cpu_executa_1(self);
+    n++;
+    if (self->interrompida) {
+      *pmotivo = parada_interrupcao;
+      break;
+    }
+    if (es) {
+      *pmotivo = parada_es;
+      break;
+    }
+    if (self->modo != modo) {
+      *pmotivo = parada_modo;
+      break;
+    }
+  }
+  return n;
+}
+
 // INTERRUPÇÃO {{{1
 
 bool cpu_interrompe(cpu_t *self, irq_t irq)
@@ -513,6 +582,7 @@ bool cpu_interrompe(cpu_t *self, irq_t irq)
   self->PC = IRQ_END_TRATADOR;
   self->A = irq;
   self->erro = ERR_OK;
+  self->interrompida = true;
 
   return true;
 }
@@ -33,6 +33,40 @@ void cpu_destroi(cpu_t *self);
 //     e causa uma interrupção
 void cpu_executa_1(cpu_t *self);
 
+// os motivos para cpu_executa_n retornar
+typedef enum {
+  parada_limite,       // gastou o tempo máximo
+  parada_interrupcao,  // a CPU aceitou uma interrupção
+  parada_erro,         // a CPU está parada (executou PARA)
+  parada_es,           // executou uma instrução que acessa E/S, ou a próxima acessa
+  parada_breakpoint,   // a próxima instrução está no endereço de breakpoint
+  parada_modo,         // executou uma instrução que mudou o modo (RETI)
+} cpu_parada_t;
+
+// executa instruções em sequência, como chamadas repetidas a cpu_executa_1,
+//   até 'max' instruções
+// cada instrução gasta uma unidade de tempo; '*pespera' recebe o tempo gasto
+//   além disso, esperando pela memória (nesta CPU, sempre 0; a da t2 espera
+//   pelas faltas na TLB)
+// retorna antes se a CPU aceitar uma interrupção ou estiver parada, ou antes
+//   da instrução no endereço de breakpoint, ou depois de uma instrução que
+//   mude o modo da CPU (quando ela pode passar a aceitar interrupções); o
+//   motivo do retorno é colocado em '*pmotivo'
+// as instruções que acessam E/S (LE, ESCR e CHAMAC, que chama o SO) são
+//   executadas sozinhas: se não for a primeira, retorna antes dela; se for,
+//   retorna logo depois. Assim quem chama pode atualizar o relógio e os
+//   dispositivos antes de cada acesso
+// retorna o número de instruções executadas (0 se a CPU estiver parada ou
+//   a primeira instrução estiver no breakpoint)
+int cpu_executa_n(cpu_t *self, int max, cpu_parada_t *pmotivo, int *pespera);
+
+// define o endereço de breakpoint (-1 para nenhum)
+// cpu_executa_n retorna antes de executar uma instrução nesse endereço
+//   (mesmo que seja a primeira, por exemplo depois de uma interrupção), a
+//   não ser que tenha parado nela na execução anterior, para que se possa
+//   continuar depois do breakpoint
+void cpu_define_breakpoint(cpu_t *self, int endereco);
+
 // implementa uma interrupção
 // passa para modo supervisor, salva o estado da CPU no início da memória,
 //   altera A para identificar a requisição de interrupção, altera PC para
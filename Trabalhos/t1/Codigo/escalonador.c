@@ -0,0 +1,300 @@
+// escalonador.c
+// escalonador de processos
+// simulador de computador
+// so24b
+
+#include "escalonador.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// CONSTANTES E TIPOS {{{1
+
+// número de níveis da fila de prontos; na política prio, a prioridade (entre
+//   0 e 1, menor é melhor) é dividida igualmente entre eles
+#define N_NIVEIS 32
+// quantum das políticas rr, prio e loteria
+#define QUANTUM 15
+// mlfq: níveis usados, quantum do primeiro nível (dobra a cada nível) e
+//   intervalo (em interrupções do relógio) entre as voltas ao primeiro nível
+#define N_NIVEIS_MLFQ 4
+#define QUANTUM_MLFQ 4
+#define INTERVALO_MLFQ 100
+// loteria: bilhetes de cada processo, e o máximo com compensação
+#define BILHETES 100
+#define MAX_BILHETES (10 * BILHETES)
+
+typedef enum { pol_rr, pol_prio, pol_mlfq, pol_loteria, N_POLITICAS } politica_t;
+
+// nomes das políticas, na ordem de politica_t
+static char *nomes[N_POLITICAS] = { "rr", "prio", "mlfq", "loteria" };
+
+struct escalonador_t {
+  politica_t politica;
+  // processos prontos: uma fila por nível, ligados por prox_processo e
+  //   ant_processo, e um bit ligado em niveis_ocupados para cada nível que
+  //   tem algum processo. rr e loteria só usam o nível 0
+  processo_t *inicio[N_NIVEIS];
+  processo_t *fim[N_NIVEIS];
+  unsigned niveis_ocupados;
+  // quantum do processo em execução: o que ele recebeu e quanto resta
+  int quantum_inicial;
+  int quantum;
+  // mlfq: interrupções até a próxima volta ao primeiro nível, e quantas
+  //   voltas já teve
+  int t_ate_volta;
+  int epoca;
+  // loteria: total de bilhetes dos prontos e estado do gerador aleatório
+  int total_bilhetes;
+  unsigned aleatorio;
+};
+
+// CRIAÇÃO {{{1
+
+escalonador_t *escalonador_cria(char *nome)
+{
+  if (nome == NULL) nome = nomes[pol_prio];
+  int politica;
+  for (politica = 0; politica < N_POLITICAS; politica++) {
+    if (strcmp(nome, nomes[politica]) == 0) break;
+  }
+  if (politica == N_POLITICAS) return NULL;
+
+  escalonador_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  self->politica = politica;
+  for (int nivel = 0; nivel < N_NIVEIS; nivel++) {
+    self->inicio[nivel] = NULL;
+    self->fim[nivel] = NULL;
+  }
+  self->niveis_ocupados = 0;
+  self->quantum_inicial = QUANTUM;
+  self->quantum = QUANTUM;
+  self->t_ate_volta = INTERVALO_MLFQ;
+  self->epoca = 0;
+  self->total_bilhetes = 0;
+  // semente fixa, para as execuções serem repetíveis
+  self->aleatorio = 2463534242u;
+
+  return self;
+}
+
+void escalonador_destroi(escalonador_t *self)
+{
+  free(self);
+}
+
+char *escalonador_nome(escalonador_t *self)
+{
+  return nomes[self->politica];
+}
+
+void escalonador_cria_processo(escalonador_t *self, processo_t *processo)
+{
+  processo->prioridade = 0.5;
+  processo->nivel_mlfq = 0;
+  processo->epoca_mlfq = self->epoca;
+  processo->bilhetes = BILHETES;
+}
+
+// FILAS DE PRONTOS {{{1
+
+// nível da fila de prontos onde o processo deve ficar
+static int nivel_do_processo(escalonador_t *self, processo_t *processo)
+{
+  switch (self->politica) {
+    case pol_prio: {
+      int nivel = processo->prioridade * N_NIVEIS;
+      if (nivel < 0) return 0;
+      if (nivel >= N_NIVEIS) return N_NIVEIS - 1;
+      return nivel;
+    }
+    case pol_mlfq:
+      // se todos voltaram ao primeiro nível enquanto o processo não estava
+      //   pronto, ele também volta
+      if (processo->epoca_mlfq != self->epoca) {
+        processo->epoca_mlfq = self->epoca;
+        processo->nivel_mlfq = 0;
+      }
+      return processo->nivel_mlfq;
+    default:
+      return 0;
+  }
+}
+
+static void insere_no_nivel(escalonador_t *self, processo_t *processo, int nivel)
+{
+  processo->nivel = nivel;
+  processo->prox_processo = NULL;
+  processo->ant_processo = self->fim[nivel];
+  if (self->fim[nivel] == NULL) {
+    self->inicio[nivel] = processo;
+  } else {
+    self->fim[nivel]->prox_processo = processo;
+  }
+  self->fim[nivel] = processo;
+  self->niveis_ocupados |= 1u << nivel;
+}
+
+void escalonador_insere(escalonador_t *self, processo_t *processo)
+{
+  insere_no_nivel(self, processo, nivel_do_processo(self, processo));
+  self->total_bilhetes += processo->bilhetes;
+}
+
+void escalonador_remove(escalonador_t *self, processo_t *processo)
+{
+  int nivel = processo->nivel;
+  if (processo->ant_processo == NULL) {
+    self->inicio[nivel] = processo->prox_processo;
+  } else {
+    processo->ant_processo->prox_processo = processo->prox_processo;
+  }
+  if (processo->prox_processo == NULL) {
+    self->fim[nivel] = processo->ant_processo;
+  } else {
+    processo->prox_processo->ant_processo = processo->ant_processo;
+  }
+  if (self->inicio[nivel] == NULL) {
+    self->niveis_ocupados &= ~(1u << nivel);
+  }
+  self->total_bilhetes -= processo->bilhetes;
+}
+
+// gerador de números pseudo-aleatórios (xorshift)
+static unsigned aleatorio(escalonador_t *self)
+{
+  unsigned x = self->aleatorio;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  self->aleatorio = x;
+  return x;
+}
+
+// sorteia um bilhete entre os dos processos prontos
+// percorre a fila até o dono do bilhete, é linear no número de prontos
+static processo_t *sorteia(escalonador_t *self)
+{
+  if (self->total_bilhetes <= 0) return self->inicio[0];
+  int bilhete = aleatorio(self) % self->total_bilhetes;
+  processo_t *processo = self->inicio[0];
+  while (processo->prox_processo != NULL && bilhete >= processo->bilhetes) {
+    bilhete -= processo->bilhetes;
+    processo = processo->prox_processo;
+  }
+  return processo;
+}
+
+processo_t *escalonador_proximo(escalonador_t *self)
+{
+  if (self->niveis_ocupados == 0) return NULL;
+  if (self->politica == pol_loteria) return sorteia(self);
+  // o primeiro do nível ocupado mais baixo
+  return self->inicio[__builtin_ctz(self->niveis_ocupados)];
+}
+
+// QUANTUM {{{1
+
+void escalonador_executa(escalonador_t *self, processo_t *processo)
+{
+  if (self->politica == pol_mlfq) {
+    self->quantum_inicial = QUANTUM_MLFQ << processo->nivel_mlfq;
+  } else {
+    self->quantum_inicial = QUANTUM;
+  }
+  self->quantum = self->quantum_inicial;
+}
+
+// mlfq: coloca todos os processos prontos no primeiro nível; os que não estão
+//   prontos voltam quando ficarem (ver nivel_do_processo)
+static void volta_ao_primeiro_nivel(escalonador_t *self)
+{
+  self->epoca++;
+  for (int nivel = 1; nivel < N_NIVEIS_MLFQ; nivel++) {
+    while (self->inicio[nivel] != NULL) {
+      processo_t *processo = self->inicio[nivel];
+      escalonador_remove(self, processo);
+      processo->nivel_mlfq = 0;
+      processo->epoca_mlfq = self->epoca;
+      escalonador_insere(self, processo);
+    }
+  }
+}
+
+void escalonador_tictac(escalonador_t *self)
+{
+  self->quantum--;
+  if (self->politica == pol_mlfq && --self->t_ate_volta <= 0) {
+    self->t_ate_volta = INTERVALO_MLFQ;
+    volta_ao_primeiro_nivel(self);
+  }
+}
+
+bool escalonador_quantum_acabou(escalonador_t *self)
+{
+  return self->quantum <= 0;
+}
+
+int escalonador_quantum(escalonador_t *self)
+{
+  return self->quantum;
+}
+
+// EVENTOS DOS PROCESSOS {{{1
+
+// prio: a nova prioridade é a média entre a anterior e a fração do quantum
+//   usada
+static void envelhece(escalonador_t *self, processo_t *processo)
+{
+  double t_exec = self->quantum_inicial - self->quantum;
+  processo->prioridade = (processo->prioridade + t_exec / self->quantum_inicial) / 2;
+}
+
+void escalonador_bloqueou(escalonador_t *self, processo_t *processo)
+{
+  switch (self->politica) {
+    case pol_prio:
+      envelhece(self, processo);
+      break;
+    case pol_loteria: {
+      // compensação: quem usou uma fração f do quantum recebe 1/f bilhetes
+      int usado = self->quantum_inicial - self->quantum;
+      if (usado < 1) usado = 1;
+      int bilhetes = BILHETES * self->quantum_inicial / usado;
+      processo->bilhetes = bilhetes < MAX_BILHETES ? bilhetes : MAX_BILHETES;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void escalonador_preemptou(escalonador_t *self, processo_t *processo)
+{
+  switch (self->politica) {
+    case pol_prio:
+      envelhece(self, processo);
+      break;
+    case pol_mlfq:
+      if (processo->nivel_mlfq < N_NIVEIS_MLFQ - 1) processo->nivel_mlfq++;
+      break;
+    case pol_loteria:
+      processo->bilhetes = BILHETES;
+      break;
+    default:
+      break;
+  }
+}
+
+void escalonador_acordou(escalonador_t *self, processo_t *processo)
+{
+  // mlfq: quem bloqueou esperando E/S sobe um nível
+  if (self->politica == pol_mlfq && processo->nivel_mlfq > 0) {
+    processo->nivel_mlfq--;
+  }
+}
+
+// vim: foldmethod=marker
@@ -0,0 +1,70 @@
+// escalonador.h
+// escalonador de processos
+// simulador de computador
+// so24b
+
+#ifndef ESCALONADOR_H
+#define ESCALONADOR_H
+
+// o escalonador mantém os processos prontos e decide qual executa
+// o SO informa os eventos da vida de cada processo, e a política escolhida
+//   na criação decide o que fazer com eles:
+//   "rr"      round-robin: uma fila só, quantum fixo
+//   "prio"    prioridade com envelhecimento: a prioridade é a média entre a
+//             anterior e a fração do quantum usada na última execução
+//   "mlfq"    filas multinível com realimentação: quem gasta o quantum desce
+//             de nível (com quantum maior), e periodicamente todos voltam
+//             para o nível mais alto
+//   "loteria" sorteio com bilhetes; quem bloqueia antes de gastar o quantum
+//             ganha bilhetes de compensação para a próxima vez
+// o quantum é contado em interrupções do relógio
+
+#include "processo.h"
+
+typedef struct escalonador_t escalonador_t;
+
+// cria um escalonador com a política de nome 'nome' (NULL para a padrão)
+// retorna NULL se não existe política com esse nome
+escalonador_t *escalonador_cria(char *nome);
+
+// destrói um escalonador
+void escalonador_destroi(escalonador_t *self);
+
+// retorna o nome da política do escalonador
+char *escalonador_nome(escalonador_t *self);
+
+// inicializa os dados do escalonador no descritor de um processo novo
+void escalonador_cria_processo(escalonador_t *self, processo_t *processo);
+
+// o processo ficou pronto para executar
+void escalonador_insere(escalonador_t *self, processo_t *processo);
+
+// o processo deixou de estar pronto (vai executar, bloqueou ou morreu)
+void escalonador_remove(escalonador_t *self, processo_t *processo);
+
+// retorna o próximo processo a executar, sem tirar dos prontos (NULL se não
+//   tiver nenhum pronto)
+processo_t *escalonador_proximo(escalonador_t *self);
+
+// o processo passou a executar, com um quantum novo
+void escalonador_executa(escalonador_t *self, processo_t *processo);
+
+// houve uma interrupção do relógio
+void escalonador_tictac(escalonador_t *self);
+
+// retorna true se o quantum do processo em execução acabou
+bool escalonador_quantum_acabou(escalonador_t *self);
+
+// retorna quanto resta do quantum do processo em execução
+int escalonador_quantum(escalonador_t *self);
+
+// o processo em execução bloqueou
+void escalonador_bloqueou(escalonador_t *self, processo_t *processo);
+
+// o processo em execução perdeu a CPU porque o quantum acabou
+void escalonador_preemptou(escalonador_t *self, processo_t *processo);
+
+// o processo foi desbloqueado (é chamada antes de escalonador_insere)
+void escalonador_acordou(escalonador_t *self, processo_t *processo);
+
+#endif // ESCALONADOR_H
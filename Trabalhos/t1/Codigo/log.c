@@ -0,0 +1,218 @@
+// log.c
+// registro de mensagens de diagnóstico, com níveis e categorias
+// simulador de computador
+// so24b
+
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// CONSTANTES E TIPOS {{{1
+
+// número de mensagens na fila (potência de 2) e tamanho máximo de cada uma
+#define TAM_FILA 4096
+#define TAM_MSG 160
+// tamanho do buffer do arquivo
+#define TAM_BUFFER (64 * 1024)
+// quanto a thread que grava espera quando a fila está vazia (ms), e de quanto
+//   em quanto tempo ela esvazia o buffer do arquivo se não tem mais o que
+//   gravar
+#define ESPERA_VAZIA 2
+#define INTERVALO_FLUSH 200
+
+// a fila tem vários produtores (quem registra) e um consumidor (a thread que
+//   grava); cada posição tem um número de sequência que diz se ela está livre
+//   para o produtor da vez n (seq == n) ou pronta para o consumidor
+//   (seq == n + 1). O produtor reserva a posição incrementando 'insere'
+typedef struct {
+  atomic_uint seq;
+  char txt[TAM_MSG];
+} posicao_t;
+
+static char letras_niveis[N_LOG_NIVEIS] = { 'E', 'A', 'I', 'D' };
+static char *nomes_categorias[N_LOG_CATEGORIAS] = {
+  [log_console] = "console",
+  [log_so] = "so",
+  [log_escalona] = "escalona",
+  [log_mem] = "mem",
+  [log_es] = "es",
+};
+
+log_nivel_t log_niveis[N_LOG_CATEGORIAS] = {
+  log_info, log_info, log_info, log_info, log_info
+};
+
+static struct {
+  posicao_t fila[TAM_FILA];
+  atomic_uint insere;
+  // só usada pela thread que grava
+  unsigned remove;
+  atomic_uint perdidas;
+  atomic_bool terminar;
+  bool iniciado;
+  pthread_t thread;
+  FILE *arquivo;
+  char *buffer;
+  void (*eco)(char *txt);
+  log_nivel_t nivel_eco;
+} reg;
+
+// FILA {{{1
+
+static bool fila_insere(char *txt)
+{
+  unsigned pos = atomic_load_explicit(&reg.insere, memory_order_relaxed);
+  posicao_t *p;
+  for (;;) {
+    p = &reg.fila[pos % TAM_FILA];
+    unsigned seq = atomic_load_explicit(&p->seq, memory_order_acquire);
+    int dif = (int)(seq - pos);
+    if (dif == 0) {
+      if (atomic_compare_exchange_weak_explicit(&reg.insere, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (dif < 0) {
+      // o consumidor ainda não liberou a posição: a fila está cheia
+      return false;
+    } else {
+      pos = atomic_load_explicit(&reg.insere, memory_order_relaxed);
+    }
+  }
+  snprintf(p->txt, TAM_MSG, "%s", txt);
+  atomic_store_explicit(&p->seq, pos + 1, memory_order_release);
+  return true;
+}
+
+static bool fila_remove(char *txt)
+{
+  posicao_t *p = &reg.fila[reg.remove % TAM_FILA];
+  unsigned seq = atomic_load_explicit(&p->seq, memory_order_acquire);
+  if (seq != reg.remove + 1) return false;
+  strcpy(txt, p->txt);
+  atomic_store_explicit(&p->seq, reg.remove + TAM_FILA, memory_order_release);
+  reg.remove++;
+  return true;
+}
+
+// THREAD QUE GRAVA {{{1
+
+static long tempo_real_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void *laco_do_log(void *arg)
+{
+  char txt[TAM_MSG];
+  long ultimo_flush = tempo_real_ms();
+  bool gravou = false;
+  for (;;) {
+    // a ordem importa: quem registra antes de 'terminar' é gravado
+    bool terminar = atomic_load(&reg.terminar);
+    while (fila_remove(txt)) {
+      fputs(txt, reg.arquivo);
+      gravou = true;
+    }
+    if (terminar) break;
+    if (gravou && tempo_real_ms() - ultimo_flush >= INTERVALO_FLUSH) {
+      fflush(reg.arquivo);
+      ultimo_flush = tempo_real_ms();
+      gravou = false;
+    }
+    struct timespec ts = { 0, ESPERA_VAZIA * 1000000L };
+    nanosleep(&ts, NULL);
+  }
+  return NULL;
+}
+
+// INICIALIZAÇÃO {{{1
+
+void log_inicia(char *nome)
+{
+  if (reg.iniciado) return;
+  reg.arquivo = fopen(nome, "w");
+  if (reg.arquivo == NULL) return;
+  reg.buffer = malloc(TAM_BUFFER);
+  assert(reg.buffer != NULL);
+  setvbuf(reg.arquivo, reg.buffer, _IOFBF, TAM_BUFFER);
+  for (unsigned i = 0; i < TAM_FILA; i++) {
+    atomic_init(&reg.fila[i].seq, i);
+  }
+  atomic_init(&reg.insere, 0);
+  reg.remove = 0;
+  atomic_init(&reg.perdidas, 0);
+  atomic_init(&reg.terminar, false);
+  int r = pthread_create(&reg.thread, NULL, laco_do_log, NULL);
+  assert(r == 0);
+  reg.iniciado = true;
+}
+
+void log_termina(void)
+{
+  if (!reg.iniciado) return;
+  atomic_store(&reg.terminar, true);
+  pthread_join(reg.thread, NULL);
+  unsigned perdidas = atomic_load(&reg.perdidas);
+  if (perdidas > 0) {
+    fprintf(reg.arquivo, "log: %u mensagens perdidas com a fila cheia\n",
+            perdidas);
+  }
+  fclose(reg.arquivo);
+  free(reg.buffer);
+  reg.iniciado = false;
+}
+
+void log_define_nivel(log_categoria_t categoria, log_nivel_t nivel)
+{
+  log_niveis[categoria] = nivel;
+}
+
+void log_define_eco(void (*eco)(char *txt), log_nivel_t nivel)
+{
+  reg.eco = eco;
+  reg.nivel_eco = nivel;
+}
+
+// REGISTRO {{{1
+
+void log_grava(log_nivel_t nivel, log_categoria_t categoria, char *txt)
+{
+  if (!reg.iniciado) return;
+  // cada linha da mensagem vira uma linha no arquivo, com nível e categoria
+  char linha[TAM_MSG];
+  while (*txt != '\0') {
+    char *fim = strchr(txt, '\n');
+    int n = fim == NULL ? strlen(txt) : fim - txt;
+    snprintf(linha, sizeof(linha), "%c %s: %.*s\n", letras_niveis[nivel],
+             nomes_categorias[categoria], n, txt);
+    if (!fila_insere(linha)) {
+      atomic_fetch_add(&reg.perdidas, 1);
+    }
+    if (fim == NULL) break;
+    txt = fim + 1;
+  }
+}
+
+void log_printf(log_nivel_t nivel, log_categoria_t categoria, char *fmt, ...)
+{
+  char txt[TAM_MSG];
+  va_list arg;
+  va_start(arg, fmt);
+  vsnprintf(txt, sizeof(txt), fmt, arg);
+  va_end(arg);
+  log_grava(nivel, categoria, txt);
+  if (reg.eco != NULL && nivel <= reg.nivel_eco) reg.eco(txt);
+}
+
+// vim: foldmethod=marker
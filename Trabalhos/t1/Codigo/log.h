@@ -0,0 +1,87 @@
+// log.h
+// registro de mensagens de diagnóstico, com níveis e categorias
+// simulador de computador
+// so24b
+
+#ifndef LOG_H
+#define LOG_H
+
+// cada mensagem tem um nível (erro, aviso, info, depura) e uma categoria
+//   (parte do simulador que gerou a mensagem)
+// as mensagens são registradas pela macro LOG; as de nível acima de
+//   LOG_NIVEL_MAXIMO são removidas na compilação (por exemplo,
+//   make CPPFLAGS=-DLOG_NIVEL_MAXIMO=log_info), e as demais só são
+//   formatadas se o nível da categoria permitir (ver log_define_nivel)
+// uma mensagem registrada é colocada em uma fila sem travas e gravada no
+//   arquivo de log por uma thread própria, com E/S bufferizada; se a fila
+//   estiver cheia, a mensagem é perdida (e contada), a simulação não espera
+// as mensagens de nível até o nível de eco (log_define_eco) também são
+//   entregues a uma função de eco (a console as mostra na tela)
+// as funções podem ser chamadas por qualquer thread, mas a função de eco é
+//   chamada pela thread que registra: com eco ligado, só as threads que a
+//   função de eco admite podem registrar mensagens até o nível de eco (a da
+//   console admite só a thread da simulação e a da tela, ver console.h)
+
+#include <stdbool.h>
+
+typedef enum {
+  log_erro,
+  log_aviso,
+  log_info,
+  log_depura,
+  N_LOG_NIVEIS
+} log_nivel_t;
+
+typedef enum {
+  log_console,    // o que é impresso com console_printf
+  log_so,         // tratamento de interrupções e chamadas de sistema
+  log_escalona,   // escalonamento e despacho de processos
+  log_mem,        // memória e paginação
+  log_es,         // dispositivos de E/S
+  N_LOG_CATEGORIAS
+} log_categoria_t;
+
+#ifndef LOG_NIVEL_MAXIMO
+#define LOG_NIVEL_MAXIMO log_depura
+#endif
+
+// inicia o registro no arquivo 'nome', e a thread que grava nele
+// se não for chamada, as mensagens só vão para o eco
+void log_inicia(char *nome);
+
+// grava o que ainda estiver na fila, termina a thread e fecha o arquivo
+void log_termina(void);
+
+// define o nível máximo das mensagens registradas para a categoria (o padrão
+//   é log_info)
+void log_define_nivel(log_categoria_t categoria, log_nivel_t nivel);
+
+// define a função que recebe as mensagens até o nível 'nivel' (o padrão é
+//   não ter função); a mensagem recebida pode conter '\n'
+// a função é chamada na thread que registrou a mensagem
+void log_define_eco(void (*eco)(char *txt), log_nivel_t nivel);
+
+// nível máximo de cada categoria (não altere diretamente)
+extern log_nivel_t log_niveis[N_LOG_CATEGORIAS];
+
+// retorna true se mensagens do nível e categoria devem ser registradas
+static inline bool log_ligado(log_nivel_t nivel, log_categoria_t categoria)
+{
+  return nivel <= log_niveis[categoria];
+}
+
+// registra uma mensagem formatada como printf (use a macro LOG)
+void log_printf(log_nivel_t nivel, log_categoria_t categoria, char *fmt, ...)
+  __attribute__((format(printf, 3, 4)));
+
+// registra uma mensagem já formatada, só no arquivo (sem eco)
+void log_grava(log_nivel_t nivel, log_categoria_t categoria, char *txt);
+
+#define LOG(nivel, categoria, ...)                                      \
+  do {                                                                  \
+    if ((nivel) <= LOG_NIVEL_MAXIMO && log_ligado(nivel, categoria)) {  \
+      log_printf(nivel, categoria, __VA_ARGS__);                        \
+    }                                                                   \
+  } while (0)
+
+#endif // LOG_H
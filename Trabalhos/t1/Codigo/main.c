@@ -7,36 +7,47 @@
 #include "memoria.h"
 #include "cpu.h"
 #include "relogio.h"
+#include "pic.h"
 #include "console.h"
 #include "terminal.h"
 #include "es.h"
 #include "dispositivos.h"
 #include "so.h"
+#include "rastro.h"
+#include "log.h"
+#include "escalonador.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // constantes
-#define MEM_TAM 10000        // tamanho da memória principal
+#define MEM_TAM 10000        // tamanho padrão da memória principal (ver -m)
 
 // estrutura com os componentes do computador simulado
 typedef struct {
   mem_t *mem;
   cpu_t *cpu;
   relogio_t *relogio;
+  pic_t *pic;
   console_t *console;
   es_t *es;
   controle_t *controle;
 } hardware_t;
 
-static void cria_hardware(hardware_t *hw)
+// cria o hardware; se 'lote', sem tela e sem operador (ver controle_define_lote)
+// se 'rapido', os terminais não demoram para rolar e limpar a saída
+// a memória principal tem 'tam_mem' palavras, obtidas da forma 'tipo_mem'
+static void cria_hardware(hardware_t *hw, bool lote, bool rapido, int tam_mem,
+                          mem_tipo_t tipo_mem)
 {
   // cria a memória
-  hw->mem = mem_cria(MEM_TAM);
+  hw->mem = mem_cria_tipo(tam_mem, tipo_mem);
 
   // cria dispositivos de E/S
-  hw->console = console_cria();
-  hw->relogio = relogio_cria();
+  hw->console = lote ? console_cria_sem_tela() : console_cria();
+  hw->pic = pic_cria();
+  hw->relogio = relogio_cria(hw->pic);
 
   // cria o controlador de E/S e registra os dispositivos
   //   por exemplo, o dispositivo 8 do controlador de E/S (e da CPU) será o
@@ -45,40 +56,52 @@ static void cria_hardware(hardware_t *hw)
   // lê teclado, testa teclado, escreve tela, testa tela do terminal A
   terminal_t *terminal;
   terminal = console_terminal(hw->console, 'A');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_A_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_A_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_A_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_A_TELA_OK    , terminal, 3, terminal_leitura, NULL);
   // lê teclado, testa teclado, escreve tela, testa tela do terminal B
   terminal = console_terminal(hw->console, 'B');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_B_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_B_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_B_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_B_TELA_OK    , terminal, 3, terminal_leitura, NULL);
   // lê teclado, testa teclado, escreve tela, testa tela do terminal C
   terminal = console_terminal(hw->console, 'C');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_C_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_C_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_C_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_C_TELA_OK    , terminal, 3, terminal_leitura, NULL);
   // lê teclado, testa teclado, escreve tela, testa tela do terminal D
   terminal = console_terminal(hw->console, 'D');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_D_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_D_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_D_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_D_TELA_OK    , terminal, 3, terminal_leitura, NULL);
+  for (char t = 'A'; t <= 'D'; t++) {
+    terminal_define_rapido(console_terminal(hw->console, t), rapido);
+  }
   // lê relógio virtual, relógio real
   es_registra_dispositivo(hw->es, D_RELOGIO_INSTRUCOES, hw->relogio, 0, relogio_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_REAL      , hw->relogio, 1, relogio_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_TIMER     , hw->relogio, 2, relogio_leitura, relogio_escrita);
   es_registra_dispositivo(hw->es, D_RELOGIO_INTERRUPCAO,hw->relogio, 3, relogio_leitura, relogio_escrita);
+  // lê interrupções pendentes, lê e altera as habilitadas, cancela pendente
+  es_registra_dispositivo(hw->es, D_PIC_PENDENTES     , hw->pic, 0, pic_leitura, NULL);
+  es_registra_dispositivo(hw->es, D_PIC_HABILITADAS   , hw->pic, 1, pic_leitura, pic_escrita);
+  es_registra_dispositivo(hw->es, D_PIC_CANCELA       , hw->pic, 2, NULL, pic_escrita);
 
   // cria a unidade de execução e inicializa com a memória e o controlador de E/S
   hw->cpu = cpu_cria(hw->mem, hw->es);
 
-  // cria o controlador da CPU e inicializa com a unidade de execução, a console e
-  //   o relógio
-  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio);
+  // cria o controlador da CPU e inicializa com a unidade de execução, a console,
+  //   o relógio e o controlador de interrupções
+  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio, hw->pic);
+  if (lote) controle_define_lote(hw->controle);
 }
 
 static void destroi_hardware(hardware_t *hw)
@@ -87,25 +110,80 @@ static void destroi_hardware(hardware_t *hw)
   cpu_destroi(hw->cpu);
   es_destroi(hw->es);
   relogio_destroi(hw->relogio);
+  pic_destroi(hw->pic);
   console_destroi(hw->console);
   mem_destroi(hw->mem);
 }
 
-int main()
+// retorna o tipo de memória com o nome 'nome', ou -1
+static mem_tipo_t tipo_de_memoria(char *nome)
+{
+  if (strcmp(nome, "densa") == 0) return mem_densa;
+  if (strcmp(nome, "esparsa") == 0) return mem_esparsa;
+  if (strcmp(nome, "enorme") == 0) return mem_enorme;
+  return -1;
+}
+
+int main(int argc, char *argv[])
 {
   hardware_t hw;
   so_t *so;
 
+  // opções:
+  //   -l executa em modo lote: sem tela, sem esperar comandos, até o SO não
+  //      ter mais nada a fazer
+  //   -r terminais rápidos, sem a demora da rolagem e limpeza da saída
+  //   -t arq   registra os eventos da execução e grava no arquivo 'arq', no
+  //            formato de rastro do chrome (ver rastro.h)
+  //   -v registra também as mensagens de depuração no log (log_da_console)
+  //   -m tam   tamanho da memória principal, em palavras
+  //   -M tipo  forma de alocar a memória principal no hospedeiro: densa
+  //            (padrão), esparsa ou enorme (ver mem_tipo_t)
+  //   -e nome  política de escalonamento (rr, prio, mlfq ou loteria)
+  bool lote = false;
+  bool rapido = false;
+  char *arq_rastro = NULL;
+  int tam_mem = MEM_TAM;
+  char *tipo_mem = "densa";
+  char *politica = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-l") == 0) lote = true;
+    if (strcmp(argv[i], "-r") == 0) rapido = true;
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) arq_rastro = argv[++i];
+    if (strcmp(argv[i], "-v") == 0) {
+      for (int c = 0; c < N_LOG_CATEGORIAS; c++) log_define_nivel(c, log_depura);
+    }
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) tam_mem = atoi(argv[++i]);
+    if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) tipo_mem = argv[++i];
+    if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) politica = argv[++i];
+  }
+  escalonador_t *escalonador = escalonador_cria(politica);
+  if (escalonador == NULL) {
+    fprintf(stderr, "Política de escalonamento '%s' desconhecida\n", politica);
+    return 1;
+  }
+  mem_tipo_t tipo = tipo_de_memoria(tipo_mem);
+  if (tipo == -1 || tam_mem <= 0) {
+    fprintf(stderr, "Memória '%s' de %d palavras inválida\n", tipo_mem, tam_mem);
+    return 1;
+  }
+
   // cria o hardware
-  cria_hardware(&hw);
+  cria_hardware(&hw, lote, rapido, tam_mem, tipo);
+  if (arq_rastro != NULL) rastro_liga(hw.relogio);
   // cria o sistema operacional
-  so = so_cria(hw.cpu, hw.mem, hw.es, hw.console);
+  so = so_cria(hw.cpu, hw.mem, hw.es, hw.console, escalonador);
   
   // executa o laço principal do controlador
   controle_laco(hw.controle);
 
+  if (arq_rastro != NULL && !rastro_grava(arq_rastro)) {
+    fprintf(stderr, "Não foi possível gravar o rastro em '%s'\n", arq_rastro);
+  }
+
   // destroi tudo
   so_destroi(so);
+  escalonador_destroi(escalonador);
   destroi_hardware(&hw);
 }
 
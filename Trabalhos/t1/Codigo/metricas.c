@@ -0,0 +1,355 @@
+// metricas.c
+// métricas de execução do sistema operacional
+// simulador de computador
+// so24b
+
+#include "metricas.h"
+#include "processo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// CONSTANTES E TIPOS {{{1
+
+// as métricas dos processos são alocadas em blocos, que não mudam de lugar
+#define PROCESSOS_POR_BLOCO 256
+
+// versão do formato dos arquivos json e csv; deve mudar se mudar o formato
+#define VERSAO_FORMATO 1
+
+typedef struct {
+  int n;
+  long soma;
+  int min;
+  int max;
+  int faixa[METRICAS_N_FAIXAS];
+} histograma_t;
+
+typedef struct {
+  // estado atual, e instante em que entrou nele (o tempo no estado atual
+  //   ainda não está em estado_t_total)
+  int estado;
+  int t_entrada;
+  int estado_n_vezes[QUANTIDADE_ESTADOS_PROC];
+  int estado_t_total[QUANTIDADE_ESTADOS_PROC];
+  int n_preempcoes;
+  // instantes da criação e da morte (-1 se ainda vivo)
+  int t_criacao;
+  int t_morte;
+  // instante em que ficou pronto depois de criado ou desbloqueado, se ainda
+  //   não executou desde então (-1 se não)
+  int t_inicio_resposta;
+  histograma_t resposta;
+  histograma_t espera;
+} proc_metricas;
+
+struct metricas_t {
+  int tempo_total;
+  int tempo_ocioso;
+  int preempcoes;
+  int n_interrupcoes[N_IRQ];
+  // métricas de cada processo, em blocos de PROCESSOS_POR_BLOCO
+  int n_processos;
+  proc_metricas **blocos;
+  int n_blocos;
+  int cap_blocos;
+  // histogramas de todos os processos
+  histograma_t resposta;
+  histograma_t espera;
+  histograma_t retorno;
+};
+
+// nomes dos estados, nos arquivos gerados
+static char *nomes_estados[QUANTIDADE_ESTADOS_PROC] = {
+  [ESTADO_PROC_MORTO] = "morto",
+  [ESTADO_PROC_PRONTO] = "pronto",
+  [ESTADO_PROC_BLOQUEADO] = "bloqueado",
+  [ESTADO_PROC_EXECUTANDO] = "executando",
+};
+
+// nomes das interrupções, no arquivo json
+static char *nomes_irq[N_IRQ] = {
+  [IRQ_RESET] = "reset",
+  [IRQ_ERR_CPU] = "err_cpu",
+  [IRQ_SISTEMA] = "sistema",
+  [IRQ_RELOGIO] = "relogio",
+  [IRQ_TECLADO] = "teclado",
+  [IRQ_TELA] = "tela",
+};
+
+// CRIAÇÃO {{{1
+
+metricas_t *metricas_cria(void)
+{
+  metricas_t *self = calloc(1, sizeof(*self));
+  assert(self != NULL);
+  return self;
+}
+
+void metricas_destroi(metricas_t *self)
+{
+  for (int b = 0; b < self->n_blocos; b++) {
+    free(self->blocos[b]);
+  }
+  free(self->blocos);
+  free(self);
+}
+
+// HISTOGRAMAS {{{1
+
+static int faixa_do_valor(int valor)
+{
+  if (valor <= 0) return 0;
+  int faixa = 32 - __builtin_clz(valor);
+  return faixa < METRICAS_N_FAIXAS ? faixa : METRICAS_N_FAIXAS - 1;
+}
+
+static void histograma_insere(histograma_t *h, int valor)
+{
+  if (h->n == 0 || valor < h->min) h->min = valor;
+  if (h->n == 0 || valor > h->max) h->max = valor;
+  h->n++;
+  h->soma += valor;
+  h->faixa[faixa_do_valor(valor)]++;
+}
+
+static double histograma_media(histograma_t *h)
+{
+  return h->n == 0 ? 0 : (double)h->soma / h->n;
+}
+
+// CONTADORES {{{1
+
+void metricas_tempo(metricas_t *self, int delta, bool ocioso)
+{
+  self->tempo_total += delta;
+  if (ocioso) self->tempo_ocioso += delta;
+}
+
+void metricas_interrupcao(metricas_t *self, irq_t irq)
+{
+  if (irq >= 0 && irq < N_IRQ) self->n_interrupcoes[irq]++;
+}
+
+static proc_metricas *metricas_do_pid(metricas_t *self, int pid)
+{
+  assert(pid >= 0 && pid < self->n_processos);
+  return &self->blocos[pid / PROCESSOS_POR_BLOCO][pid % PROCESSOS_POR_BLOCO];
+}
+
+void metricas_cria_processo(metricas_t *self, int pid, int agora)
+{
+  assert(pid == self->n_processos);
+  if (pid == self->n_blocos * PROCESSOS_POR_BLOCO) {
+    if (self->n_blocos == self->cap_blocos) {
+      self->cap_blocos = self->cap_blocos == 0 ? 4 : 2 * self->cap_blocos;
+      self->blocos = realloc(self->blocos,
+                             self->cap_blocos * sizeof(*self->blocos));
+      assert(self->blocos != NULL);
+    }
+    self->blocos[self->n_blocos] = malloc(PROCESSOS_POR_BLOCO
+                                          * sizeof(proc_metricas));
+    assert(self->blocos[self->n_blocos] != NULL);
+    self->n_blocos++;
+  }
+  self->n_processos++;
+
+  proc_metricas *met = metricas_do_pid(self, pid);
+  memset(met, 0, sizeof(*met));
+  met->estado = ESTADO_PROC_MORTO;
+  met->t_entrada = agora;
+  met->t_criacao = agora;
+  met->t_morte = -1;
+  met->t_inicio_resposta = -1;
+}
+
+void metricas_muda_estado(metricas_t *self, int pid, int estado, int agora)
+{
+  proc_metricas *met = metricas_do_pid(self, pid);
+  int anterior = met->estado;
+
+  met->estado_t_total[anterior] += agora - met->t_entrada;
+  met->estado_n_vezes[estado]++;
+  if (anterior == ESTADO_PROC_PRONTO && estado != ESTADO_PROC_PRONTO) {
+    histograma_insere(&met->espera, agora - met->t_entrada);
+    histograma_insere(&self->espera, agora - met->t_entrada);
+  }
+  // quem fica pronto sem ter perdido a CPU está esperando resposta
+  if (estado == ESTADO_PROC_PRONTO && anterior != ESTADO_PROC_PRONTO
+      && anterior != ESTADO_PROC_EXECUTANDO) {
+    met->t_inicio_resposta = agora;
+  } else if (estado == ESTADO_PROC_EXECUTANDO && met->t_inicio_resposta != -1) {
+    histograma_insere(&met->resposta, agora - met->t_inicio_resposta);
+    histograma_insere(&self->resposta, agora - met->t_inicio_resposta);
+    met->t_inicio_resposta = -1;
+  }
+  if (estado == ESTADO_PROC_MORTO && anterior != ESTADO_PROC_MORTO) {
+    met->t_morte = agora;
+    met->t_inicio_resposta = -1;
+    histograma_insere(&self->retorno, agora - met->t_criacao);
+  }
+
+  met->estado = estado;
+  met->t_entrada = agora;
+}
+
+void metricas_preempcao(metricas_t *self, int pid)
+{
+  self->preempcoes++;
+  metricas_do_pid(self, pid)->n_preempcoes++;
+}
+
+// GRAVAÇÃO {{{1
+
+// tempo total do processo no estado, contando o estado atual até 'agora'
+static int tempo_no_estado(proc_metricas *met, int estado, int agora)
+{
+  int t = met->estado_t_total[estado];
+  if (met->estado == estado) t += agora - met->t_entrada;
+  return t;
+}
+
+static void grava_txt(metricas_t *self, FILE *arq, char *escalonador, int agora)
+{
+  fprintf(arq, "ESCALONADOR: %s\n", escalonador);
+  fprintf(arq, "QUANTIDADE PROC CRIADOS: %d\n", self->n_processos);
+  fprintf(arq, "TEMPO TOTAL EXEC: %d\n", self->tempo_total);
+  fprintf(arq, "TEMPO OCIOSO: %d\n", self->tempo_ocioso);
+  fprintf(arq, "PREEMPCOES: %d\n", self->preempcoes);
+  for (int irq = 0; irq < N_IRQ; irq++) {
+    fprintf(arq, "%s: %d\n", irq_nome(irq), self->n_interrupcoes[irq]);
+  }
+
+  for (int pid = 0; pid < self->n_processos; pid++) {
+    proc_metricas *met = metricas_do_pid(self, pid);
+    int soma_estados = 0;
+    fprintf(arq, "--------------------------------------------\n");
+    fprintf(arq, "PID: %d\n", pid);
+    for (int e = ESTADO_PROC_MORTO; e < QUANTIDADE_ESTADOS_PROC; e++) {
+      if (e != ESTADO_PROC_MORTO) soma_estados += met->estado_n_vezes[e];
+      fprintf(arq, "Estado %s: %d vezes\n", nomes_estados[e],
+              met->estado_n_vezes[e]);
+      fprintf(arq, "Estado %s: %d inst\n", nomes_estados[e],
+              tempo_no_estado(met, e, agora));
+    }
+    fprintf(arq, "Preempcoes: %d vezes\n", met->n_preempcoes);
+    fprintf(arq, "Tempo medio resposta: %f\n",
+            (double)tempo_no_estado(met, ESTADO_PROC_PRONTO, agora)
+            / met->estado_n_vezes[ESTADO_PROC_PRONTO]);
+    fprintf(arq, "Tempo retorno: %d inst\n", soma_estados);
+  }
+}
+
+static void grava_histograma_json(FILE *arq, histograma_t *h)
+{
+  fprintf(arq, "{\"n\": %d, \"soma\": %ld, \"min\": %d, \"max\": %d, "
+               "\"media\": %.3f, \"faixas\": [",
+          h->n, h->soma, h->min, h->max, histograma_media(h));
+  for (int f = 0; f < METRICAS_N_FAIXAS; f++) {
+    fprintf(arq, "%s%d", f == 0 ? "" : ", ", h->faixa[f]);
+  }
+  fprintf(arq, "]}");
+}
+
+static void grava_json(metricas_t *self, FILE *arq, char *escalonador, int agora)
+{
+  fprintf(arq, "{\n");
+  fprintf(arq, "  \"versao\": %d,\n", VERSAO_FORMATO);
+  fprintf(arq, "  \"escalonador\": \"%s\",\n", escalonador);
+  fprintf(arq, "  \"agora\": %d,\n", agora);
+  fprintf(arq, "  \"tempo_total\": %d,\n", self->tempo_total);
+  fprintf(arq, "  \"tempo_ocioso\": %d,\n", self->tempo_ocioso);
+  fprintf(arq, "  \"preempcoes\": %d,\n", self->preempcoes);
+  fprintf(arq, "  \"processos_criados\": %d,\n", self->n_processos);
+  fprintf(arq, "  \"interrupcoes\": {");
+  for (int irq = 0; irq < N_IRQ; irq++) {
+    fprintf(arq, "%s\"%s\": %d", irq == 0 ? "" : ", ", nomes_irq[irq],
+            self->n_interrupcoes[irq]);
+  }
+  fprintf(arq, "},\n");
+  // limite inferior de cada faixa dos histogramas
+  fprintf(arq, "  \"faixas\": [0");
+  for (int f = 1; f < METRICAS_N_FAIXAS; f++) {
+    fprintf(arq, ", %d", 1 << (f - 1));
+  }
+  fprintf(arq, "],\n");
+  fprintf(arq, "  \"resposta\": ");
+  grava_histograma_json(arq, &self->resposta);
+  fprintf(arq, ",\n  \"espera\": ");
+  grava_histograma_json(arq, &self->espera);
+  fprintf(arq, ",\n  \"retorno\": ");
+  grava_histograma_json(arq, &self->retorno);
+  fprintf(arq, ",\n  \"processos\": [");
+
+  for (int pid = 0; pid < self->n_processos; pid++) {
+    proc_metricas *met = metricas_do_pid(self, pid);
+    fprintf(arq, "%s\n    {\"pid\": %d, \"criacao\": %d, \"morte\": %d, "
+                 "\"preempcoes\": %d, \"estados\": {",
+            pid == 0 ? "" : ",", pid, met->t_criacao, met->t_morte,
+            met->n_preempcoes);
+    for (int e = ESTADO_PROC_MORTO; e < QUANTIDADE_ESTADOS_PROC; e++) {
+      fprintf(arq, "%s\"%s\": {\"vezes\": %d, \"tempo\": %d}",
+              e == ESTADO_PROC_MORTO ? "" : ", ", nomes_estados[e],
+              met->estado_n_vezes[e], tempo_no_estado(met, e, agora));
+    }
+    fprintf(arq, "},\n     \"resposta\": ");
+    grava_histograma_json(arq, &met->resposta);
+    fprintf(arq, ",\n     \"espera\": ");
+    grava_histograma_json(arq, &met->espera);
+    fprintf(arq, "}");
+  }
+  fprintf(arq, "\n  ]\n}\n");
+}
+
+static void grava_csv(metricas_t *self, FILE *arq, char *escalonador, int agora)
+{
+  fprintf(arq, "escalonador,pid,criacao,morte,retorno,preempcoes");
+  for (int e = ESTADO_PROC_MORTO; e < QUANTIDADE_ESTADOS_PROC; e++) {
+    fprintf(arq, ",vezes_%s,tempo_%s", nomes_estados[e], nomes_estados[e]);
+  }
+  fprintf(arq, ",resposta_n,resposta_media,resposta_max"
+               ",espera_n,espera_media,espera_max\n");
+
+  for (int pid = 0; pid < self->n_processos; pid++) {
+    proc_metricas *met = metricas_do_pid(self, pid);
+    int retorno = met->t_morte == -1 ? -1 : met->t_morte - met->t_criacao;
+    fprintf(arq, "%s,%d,%d,%d,%d,%d", escalonador, pid, met->t_criacao,
+            met->t_morte, retorno, met->n_preempcoes);
+    for (int e = ESTADO_PROC_MORTO; e < QUANTIDADE_ESTADOS_PROC; e++) {
+      fprintf(arq, ",%d,%d", met->estado_n_vezes[e],
+              tempo_no_estado(met, e, agora));
+    }
+    fprintf(arq, ",%d,%.3f,%d,%d,%.3f,%d\n",
+            met->resposta.n, histograma_media(&met->resposta), met->resposta.max,
+            met->espera.n, histograma_media(&met->espera), met->espera.max);
+  }
+}
+
+bool metricas_grava(metricas_t *self, char *nome, char *escalonador, int agora)
+{
+  static const struct {
+    char *extensao;
+    void (*grava)(metricas_t *, FILE *, char *, int);
+  } formatos[] = {
+    { "txt", grava_txt },
+    { "json", grava_json },
+    { "csv", grava_csv },
+  };
+  bool ok = true;
+  for (int i = 0; i < sizeof(formatos) / sizeof(formatos[0]); i++) {
+    char nome_arq[strlen(nome) + 6];
+    sprintf(nome_arq, "%s.%s", nome, formatos[i].extensao);
+    FILE *arq = fopen(nome_arq, "w");
+    if (arq == NULL) {
+      ok = false;
+      continue;
+    }
+    formatos[i].grava(self, arq, escalonador, agora);
+    fclose(arq);
+  }
+  return ok;
+}
+
+// vim: foldmethod=marker
@@ -0,0 +1,60 @@
+// metricas.h
+// métricas de execução do sistema operacional
+// simulador de computador
+// so24b
+
+#ifndef METRICAS_H
+#define METRICAS_H
+
+// as métricas são os contadores globais da execução (tempo total, tempo
+//   ocioso, preempções, interrupções de cada tipo) e, para cada processo, o
+//   número de vezes e o tempo em cada estado, as preempções e histogramas
+//   dos tempos de resposta e de espera na fila de prontos
+// o tempo de resposta é o tempo entre o processo ficar pronto (ao ser criado
+//   ou desbloqueado) e começar a executar; o tempo de espera é o de cada
+//   passagem pelo estado pronto, incluindo as que seguem uma preempção
+// além desses, há histogramas de todos os processos juntos, inclusive do
+//   tempo de retorno (entre a criação e a morte do processo)
+// os histogramas têm faixas de potências de 2: a faixa 0 é o valor 0, a faixa
+//   k é de 2^(k-1) a 2^k - 1, e a última não tem limite superior
+// os pids devem ser distribuídos em sequência, a partir de 0
+// o tempo é medido no relógio do SO, e cada chamada informa o instante atual
+
+#include "irq.h"
+
+#include <stdbool.h>
+
+// número de faixas dos histogramas
+#define METRICAS_N_FAIXAS 16
+
+typedef struct metricas_t metricas_t;
+
+// cria as métricas, com todos os contadores zerados
+metricas_t *metricas_cria(void);
+
+// destrói as métricas
+void metricas_destroi(metricas_t *self);
+
+// passaram 'delta' unidades de tempo; 'ocioso' se nenhum processo executou
+void metricas_tempo(metricas_t *self, int delta, bool ocioso);
+
+// o SO atendeu uma interrupção
+void metricas_interrupcao(metricas_t *self, irq_t irq);
+
+// foi criado o processo 'pid' (no estado morto, até a primeira mudança)
+void metricas_cria_processo(metricas_t *self, int pid, int agora);
+
+// o processo 'pid' passou para o estado 'estado' (um estado_processo_id)
+void metricas_muda_estado(metricas_t *self, int pid, int estado, int agora);
+
+// o processo 'pid' perdeu a CPU porque o quantum acabou
+void metricas_preempcao(metricas_t *self, int pid);
+
+// grava as métricas em três arquivos: 'nome'.txt (texto livre), 'nome'.json
+//   e 'nome'.csv (um processo por linha)
+// pode ser chamada a qualquer momento; o tempo no estado atual de cada
+//   processo é contado até 'agora'
+// retorna false se não conseguir criar algum dos arquivos
+bool metricas_grava(metricas_t *self, char *nome, char *escalonador, int agora);
+
+#endif // METRICAS_H
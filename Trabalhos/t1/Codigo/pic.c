@@ -0,0 +1,207 @@
+// pic.c
+// controlador de interrupções
+// simulador de computador
+// so24b
+
+#include "pic.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+// um evento agendado
+typedef struct {
+  // instante em que o evento vence
+  long long tempo;
+  // interrupção a pedir quando vencer
+  irq_t irq;
+  // função a chamar quando vencer, e seus argumentos
+  pic_f_evento_t f;
+  void *arg;
+  int dado;
+} evento_t;
+
+struct pic_t {
+  // hora atual, informada em pic_avanca
+  long long agora;
+  // interrupções pendentes e habilitadas (bit 'irq' para cada interrupção)
+  unsigned pendentes;
+  unsigned habilitadas;
+  // prioridade de cada interrupção (a maior é entregue primeiro)
+  int prioridade[N_IRQ];
+  // heap de eventos agendados, com o que vence primeiro na posição 0
+  evento_t *eventos;
+  int n_eventos;
+  int cap_eventos;
+};
+
+pic_t *pic_cria(void)
+{
+  pic_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  self->agora = 0;
+  self->pendentes = 0;
+  // teclado e tela só interrompem se o SO quiser
+  self->habilitadas = ~((1u << IRQ_TECLADO) | (1u << IRQ_TELA));
+  for (int irq = 0; irq < N_IRQ; irq++) {
+    self->prioridade[irq] = 0;
+  }
+  self->prioridade[IRQ_RELOGIO] = 3;
+  self->prioridade[IRQ_TECLADO] = 2;
+  self->prioridade[IRQ_TELA] = 1;
+  self->cap_eventos = 8;
+  self->n_eventos = 0;
+  self->eventos = malloc(self->cap_eventos * sizeof(*self->eventos));
+  assert(self->eventos != NULL);
+
+  return self;
+}
+
+void pic_destroi(pic_t *self)
+{
+  free(self->eventos);
+  free(self);
+}
+
+// PEDIDOS DE INTERRUPÇÃO {{{1
+
+void pic_levanta(pic_t *self, irq_t irq)
+{
+  self->pendentes |= 1u << irq;
+}
+
+void pic_abaixa(pic_t *self, irq_t irq)
+{
+  self->pendentes &= ~(1u << irq);
+}
+
+void pic_habilita(pic_t *self, irq_t irq, bool habilitada)
+{
+  if (habilitada) {
+    self->habilitadas |= 1u << irq;
+  } else {
+    self->habilitadas &= ~(1u << irq);
+  }
+}
+
+void pic_define_prioridade(pic_t *self, irq_t irq, int prioridade)
+{
+  self->prioridade[irq] = prioridade;
+}
+
+bool pic_proxima(pic_t *self, irq_t *pirq)
+{
+  unsigned prontas = self->pendentes & self->habilitadas;
+  if (prontas == 0) return false;
+  int melhor = -1;
+  for (int irq = 0; irq < N_IRQ; irq++) {
+    if ((prontas & (1u << irq)) == 0) continue;
+    if (melhor == -1 || self->prioridade[irq] > self->prioridade[melhor]) {
+      melhor = irq;
+    }
+  }
+  *pirq = melhor;
+  return true;
+}
+
+// EVENTOS AGENDADOS {{{1
+
+static void troca_eventos(pic_t *self, int i, int j)
+{
+  evento_t aux = self->eventos[i];
+  self->eventos[i] = self->eventos[j];
+  self->eventos[j] = aux;
+}
+
+void pic_agenda(pic_t *self, int atraso, irq_t irq,
+                pic_f_evento_t f, void *arg, int dado)
+{
+  if (self->n_eventos == self->cap_eventos) {
+    self->cap_eventos *= 2;
+    self->eventos = realloc(self->eventos,
+                            self->cap_eventos * sizeof(*self->eventos));
+    assert(self->eventos != NULL);
+  }
+  int i = self->n_eventos++;
+  self->eventos[i] = (evento_t){ self->agora + atraso, irq, f, arg, dado };
+  // sobe o evento no heap até a posição certa
+  while (i > 0 && self->eventos[(i-1)/2].tempo > self->eventos[i].tempo) {
+    troca_eventos(self, i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+// remove o primeiro evento do heap
+static void remove_primeiro_evento(pic_t *self)
+{
+  self->eventos[0] = self->eventos[--self->n_eventos];
+  // desce o evento no heap até a posição certa
+  int i = 0;
+  for (;;) {
+    int menor = i;
+    int esq = 2*i + 1, dir = 2*i + 2;
+    if (esq < self->n_eventos
+        && self->eventos[esq].tempo < self->eventos[menor].tempo) menor = esq;
+    if (dir < self->n_eventos
+        && self->eventos[dir].tempo < self->eventos[menor].tempo) menor = dir;
+    if (menor == i) break;
+    troca_eventos(self, i, menor);
+    i = menor;
+  }
+}
+
+void pic_avanca(pic_t *self, long long agora)
+{
+  self->agora = agora;
+  while (self->n_eventos > 0 && self->eventos[0].tempo <= agora) {
+    evento_t evento = self->eventos[0];
+    remove_primeiro_evento(self);
+    if (evento.f == NULL || evento.f(evento.arg, evento.dado)) {
+      pic_levanta(self, evento.irq);
+    }
+  }
+}
+
+int pic_tempo_ate_evento(pic_t *self)
+{
+  if (self->n_eventos == 0) return -1;
+  // o evento foi agendado com um atraso int, então a diferença cabe em um int
+  return (int)(self->eventos[0].tempo - self->agora);
+}
+
+// ACESSO COMO DISPOSITIVO DE E/S {{{1
+
+err_t pic_leitura(void *disp, int id, int *pvalor)
+{
+  pic_t *self = disp;
+  switch (id) {
+    case 0:
+      *pvalor = self->pendentes;
+      break;
+    case 1:
+      *pvalor = self->habilitadas;
+      break;
+    default:
+      return ERR_END_INV;
+  }
+  return ERR_OK;
+}
+
+err_t pic_escrita(void *disp, int id, int valor)
+{
+  pic_t *self = disp;
+  switch (id) {
+    case 1:
+      self->habilitadas = valor;
+      break;
+    case 2:
+      if (valor < 0 || valor >= N_IRQ) return ERR_OP_INV;
+      pic_abaixa(self, valor);
+      break;
+    default:
+      return ERR_END_INV;
+  }
+  return ERR_OK;
+}
+
+// vim: foldmethod=marker
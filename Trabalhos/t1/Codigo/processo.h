@@ -1,19 +1,39 @@
+#ifndef PROCESSO_H
+#define PROCESSO_H
+
+#include <stdbool.h>
+
 typedef struct porta_t porta_t;
 typedef struct processo_t processo_t;
-typedef struct proc_metricas proc_metricas;
+typedef struct fila_espera_t fila_espera_t;
+
+// fila de processos bloqueados pelo mesmo motivo, ligados por prox_espera
+struct fila_espera_t
+{
+  processo_t *inicio;
+  processo_t *fim;
+};
 
 struct porta_t
 {
-  bool porta_ocupada;
+  // quantos processos vivos usam o terminal
+  int n_processos;
   int teclado_estado;
   int teclado;
   int tela_estado;
   int tela;
+  // processos esperando o teclado ter caractere e a tela ficar pronta
+  fila_espera_t espera_teclado;
+  fila_espera_t espera_tela;
 };
 
 struct processo_t
 {
   int pid_processo;
+  // entrada da tabela de processos onde está o descritor, e quantas vezes
+  //   ela já foi liberada (para reconhecer referências a um processo antigo)
+  int entrada;
+  int geracao;
   int reg_A;
   int reg_X;
   int reg_PC;
@@ -24,10 +44,22 @@ struct processo_t
   int bloqueio_motivo;
   int pid_esperado;
   porta_t *porta_processo;
+  // vizinhos na fila de prontos, e o nível dela em que o processo está
   processo_t *prox_processo;
-  proc_metricas *metricas;
+  processo_t *ant_processo;
+  int nivel;
+  // fila em que o processo está bloqueado (NULL se nenhuma) e o próximo nela
+  fila_espera_t *fila_espera;
+  processo_t *prox_espera;
+  // processos esperando a morte deste
+  fila_espera_t espera_morte;
 
+  // dados do escalonador: prioridade (política prio), nível e época
+  //   (política mlfq), bilhetes (política loteria)
   double prioridade;
+  int nivel_mlfq;
+  int epoca_mlfq;
+  int bilhetes;
 };
 
 typedef enum
@@ -46,9 +78,4 @@ typedef enum
   BLOQUEIO_ESPERA     = 3
 } bloqueio_id;
 
-struct proc_metricas
-{
-  int estado_n_vezes[QUANTIDADE_ESTADOS_PROC];
-  int estado_t_total[QUANTIDADE_ESTADOS_PROC];
-  int n_preempcoes;
-};
\ No newline at end of file
+#endif // PROCESSO_H
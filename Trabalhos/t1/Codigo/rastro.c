@@ -0,0 +1,204 @@
+// rastro.c
+// registro de eventos da simulação, para ver a linha do tempo de uma execução
+// simulador de computador
+// so24b
+
+#include "rastro.h"
+
+#ifndef SEM_RASTRO
+
+#include "irq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+// um evento registrado
+typedef struct {
+  long long tempo;
+  long long ns;
+  unsigned char evento;
+  unsigned char fase;
+  int a;
+  int b;
+} registro_t;
+
+// em que trilha da linha do tempo aparecem os eventos de cada tipo
+typedef enum { trilha_so, trilha_hardware, trilha_processo } trilha_t;
+
+// descrição de cada tipo de evento: nome, trilha e nomes dos dados
+static struct {
+  char *nome;
+  trilha_t trilha;
+  char *nome_a;
+  char *nome_b;
+} tipos[N_RASTRO_EVENTOS] = {
+  [rastro_interrupcao]  = { "interrupcao", trilha_so,       "irq",         NULL },
+  [rastro_escalona]     = { "escalona",    trilha_so,       "pid",         NULL },
+  [rastro_despacha]     = { "despacha",    trilha_so,       "pid",         "para" },
+  [rastro_estado]       = { "estado",      trilha_processo, "pid",         "estado" },
+  [rastro_chamada]      = { "chamada",     trilha_processo, "pid",         "chamada" },
+  [rastro_falta_pagina] = { "falta_pagina",trilha_hardware, "endereco",    "pagina" },
+  [rastro_le_es]        = { "le_es",       trilha_hardware, "dispositivo", "valor" },
+  [rastro_escreve_es]   = { "escreve_es",  trilha_hardware, "dispositivo", "valor" },
+};
+
+// identificação das trilhas no arquivo; a do processo 'pid' é TID_PROCESSO+pid
+#define TID_SO 0
+#define TID_HARDWARE 1
+#define TID_PROCESSO 2
+
+bool rastro_ligado = false;
+
+static struct {
+  relogio_t *relogio;
+  registro_t *registros;
+  // número de eventos já registrados (o próximo vai na posição
+  //   n % RASTRO_CAPACIDADE)
+  long n;
+  // nomes dos valores do dado b de cada tipo de evento (ver
+  //   rastro_define_nomes)
+  int n_nomes[N_RASTRO_EVENTOS];
+  char **nomes[N_RASTRO_EVENTOS];
+} rastro;
+
+void rastro_liga(relogio_t *relogio)
+{
+  if (rastro.registros == NULL) {
+    rastro.registros = malloc(RASTRO_CAPACIDADE * sizeof(*rastro.registros));
+    assert(rastro.registros != NULL);
+  }
+  rastro.relogio = relogio;
+  rastro_ligado = true;
+}
+
+void rastro_define_nomes(rastro_evento_t evento, int n, char *nomes[n])
+{
+  rastro.n_nomes[evento] = n;
+  rastro.nomes[evento] = nomes;
+}
+
+void rastro_registra(rastro_evento_t evento, rastro_fase_t fase, int a, int b)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  registro_t *r = &rastro.registros[rastro.n++ % RASTRO_CAPACIDADE];
+  r->tempo = relogio_agora(rastro.relogio);
+  r->ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+  r->evento = evento;
+  r->fase = fase;
+  r->a = a;
+  r->b = b;
+}
+
+// GRAVAÇÃO {{{1
+
+static int tid_do_registro(registro_t *r)
+{
+  switch (tipos[r->evento].trilha) {
+    case trilha_so: return TID_SO;
+    case trilha_hardware: return TID_HARDWARE;
+    default: return TID_PROCESSO + (r->a < 0 ? 0 : r->a);
+  }
+}
+
+// nome do valor 'b' para o tipo de evento, ou NULL se não tiver
+static char *nome_do_valor(rastro_evento_t evento, int b)
+{
+  if (b < 0 || b >= rastro.n_nomes[evento]) return NULL;
+  return rastro.nomes[evento][b];
+}
+
+static void grava_registro(FILE *arq, registro_t *r, char fase, char *nome)
+{
+  fprintf(arq, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,"
+               "\"pid\":1,\"tid\":%d,",
+          nome, tipos[r->evento].nome, fase, r->tempo, tid_do_registro(r));
+  if (fase == 'i') fprintf(arq, "\"s\":\"t\",");
+  fprintf(arq, "\"args\":{\"ns\":%lld,\"%s\":%d", r->ns, tipos[r->evento].nome_a,
+          r->a);
+  if (tipos[r->evento].nome_b != NULL) {
+    fprintf(arq, ",\"%s\":%d", tipos[r->evento].nome_b, r->b);
+  }
+  fprintf(arq, "}}");
+}
+
+static void grava_nome_trilha(FILE *arq, int tid, char *nome)
+{
+  fprintf(arq, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+               "\"args\":{\"name\":\"%s\"}}", tid, nome);
+}
+
+bool rastro_grava(char *nome)
+{
+  if (rastro.registros == NULL) return false;
+  FILE *arq = fopen(nome, "w");
+  if (arq == NULL) return false;
+
+  long primeiro = rastro.n > RASTRO_CAPACIDADE ? rastro.n - RASTRO_CAPACIDADE : 0;
+
+  // descobre quais processos aparecem, para dar nome às suas trilhas; a
+  //   trilha de um processo mostra o estado em que ele está, e por isso
+  //   lembra se tem um estado aberto
+  int max_pid = -1;
+  for (long i = primeiro; i < rastro.n; i++) {
+    registro_t *r = &rastro.registros[i % RASTRO_CAPACIDADE];
+    if (tipos[r->evento].trilha == trilha_processo && r->a > max_pid) {
+      max_pid = r->a;
+    }
+  }
+  bool *aberto = calloc(max_pid + 2, sizeof(*aberto));
+  assert(aberto != NULL);
+
+  fprintf(arq, "{\"otherData\":{\"eventos\":%ld,"
+               "\"perdidos\":%ld},\n\"traceEvents\":[\n", rastro.n - primeiro,
+          primeiro);
+  fprintf(arq, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+               "\"args\":{\"name\":\"simulador\"}}");
+  grava_nome_trilha(arq, TID_SO, "SO");
+  grava_nome_trilha(arq, TID_HARDWARE, "hardware");
+  for (long i = primeiro; i < rastro.n; i++) {
+    registro_t *r = &rastro.registros[i % RASTRO_CAPACIDADE];
+    if (tipos[r->evento].trilha == trilha_processo && r->a >= 0
+        && !aberto[r->a + 1]) {
+      aberto[r->a + 1] = true;
+      char nome_trilha[30];
+      sprintf(nome_trilha, "processo %d", r->a);
+      grava_nome_trilha(arq, TID_PROCESSO + r->a, nome_trilha);
+    }
+  }
+  memset(aberto, 0, (max_pid + 2) * sizeof(*aberto));
+
+  static char fases[] = { [rastro_instante] = 'i', [rastro_inicio] = 'B',
+                          [rastro_fim] = 'E' };
+  for (long i = primeiro; i < rastro.n; i++) {
+    registro_t *r = &rastro.registros[i % RASTRO_CAPACIDADE];
+    char *nome_valor = nome_do_valor(r->evento, r->b);
+    switch (r->evento) {
+      case rastro_interrupcao:
+        grava_registro(arq, r, fases[r->fase], irq_nome(r->a));
+        break;
+      case rastro_estado:
+        // cada estado é um intervalo na trilha do processo, até o próximo
+        if (r->a >= 0 && aberto[r->a + 1]) grava_registro(arq, r, 'E', "");
+        grava_registro(arq, r, 'B', nome_valor ? nome_valor : "estado");
+        if (r->a >= 0) aberto[r->a + 1] = true;
+        break;
+      default:
+        grava_registro(arq, r, fases[r->fase],
+                       nome_valor ? nome_valor : tipos[r->evento].nome);
+        break;
+    }
+  }
+  fprintf(arq, "\n]}\n");
+
+  free(aberto);
+  fclose(arq);
+  return true;
+}
+
+#endif // SEM_RASTRO
+
+// vim: foldmethod=marker
@@ -11,20 +11,32 @@
 
 struct relogio_t {
   // que horas são (em tics)
-  int agora;
-  // quanto tempo até gerar uma interrupção
+  long long agora;
+  // quanto tempo até gerar uma interrupção, contado a partir de t_escrita
   int t_ate_interrupcao;
+  // hora em que t_ate_interrupcao foi escrito
+  long long t_escrita;
   // 1 se está gerando interrupção, 0 se não
   int interrupcao;
+  // número da programação do timer, para descartar eventos de programações
+  //   anteriores
+  int geracao;
+  // controlador onde a interrupção é agendada
+  pic_t *pic;
 };
 
-relogio_t *relogio_cria(void)
+relogio_t *relogio_cria(pic_t *pic)
 {
   relogio_t *self;
   self = malloc(sizeof(relogio_t));
   assert(self != NULL);
 
   self->agora = 0;
+  self->t_ate_interrupcao = 0;
+  self->t_escrita = 0;
+  self->interrupcao = 0;
+  self->geracao = 0;
+  self->pic = pic;
 
   return self;
 }
@@ -36,17 +48,27 @@ void relogio_destroi(relogio_t *self)
 
 void relogio_tictac(relogio_t *self)
 {
-  self->agora++;
-  // vê se tem que gerar interrupção
-  if (self->t_ate_interrupcao != 0) {
-    self->t_ate_interrupcao--;
-    if (self->t_ate_interrupcao == 0) {
-      self->interrupcao = 1;
-    }
-  }
+  relogio_tictac_n(self, 1);
+}
+
+void relogio_tictac_n(relogio_t *self, int n)
+{
+  // a interrupção é gerada pelo evento agendado no controlador
+  self->agora += n;
+}
+
+// chamada pelo controlador de interrupções quando vence o timer
+static bool relogio_expirou(void *arg, int geracao)
+{
+  relogio_t *self = arg;
+  // o timer foi reprogramado depois do agendamento deste evento
+  if (geracao != self->geracao) return false;
+  self->t_ate_interrupcao = 0;
+  self->interrupcao = 1;
+  return true;
 }
 
-int relogio_agora(relogio_t *self)
+long long relogio_agora(relogio_t *self)
 {
   return self->agora;
 }
@@ -57,13 +79,14 @@ err_t relogio_leitura(void *disp, int id, int *pvalor)
   err_t err = ERR_OK;
   switch (id) {
     case 0:
-      *pvalor = self->agora;
+      *pvalor = (int)self->agora;
       break;
     case 1:
       *pvalor = clock()/(CLOCKS_PER_SEC/1000);
       break;
     case 2:
       *pvalor = self->t_ate_interrupcao;
+      if (*pvalor != 0) *pvalor -= (int)(self->agora - self->t_escrita);
       break;
     case 3:
       *pvalor = self->interrupcao;
@@ -81,9 +104,20 @@ err_t relogio_escrita(void *disp, int id, int pvalor)
   switch (id) {
     case 2:
       self->t_ate_interrupcao = pvalor;
+      self->t_escrita = self->agora;
+      self->geracao++;
+      if (pvalor > 0) {
+        pic_agenda(self->pic, pvalor, IRQ_RELOGIO, relogio_expirou,
+                   self, self->geracao);
+      }
       break;
     case 3:
       self->interrupcao = (pvalor == 0) ? 0 : 1;
+      if (self->interrupcao) {
+        pic_levanta(self->pic, IRQ_RELOGIO);
+      } else {
+        pic_abaixa(self->pic, IRQ_RELOGIO);
+      }
       break;
     default: 
       err = ERR_END_INV;
@@ -10,11 +10,13 @@
 // registra a passagem do tempo
 
 #include "err.h"
+#include "pic.h"
 
 typedef struct relogio_t relogio_t;
 
 // cria e inicializa um relógio
-relogio_t *relogio_cria(void);
+// as interrupções do timer são agendadas no controlador de interrupções 'pic'
+relogio_t *relogio_cria(pic_t *pic);
 
 // destrói um relógio
 // nenhuma outra operação pode ser realizada no relógio após esta chamada
@@ -24,8 +26,18 @@ void relogio_destroi(relogio_t *self);
 // esta função é chamada pelo controlador após a execução de cada instrução
 void relogio_tictac(relogio_t *self);
 
+// registra a passagem de n unidades de tempo de uma vez
+// equivale a n chamadas a relogio_tictac; usada pelo controlador quando a CPU
+//   executa várias instruções em lote
+// a interrupção do timer não é verificada aqui, ela é um evento agendado no
+//   controlador de interrupções
+void relogio_tictac_n(relogio_t *self, int n);
+
 // retorna a hora atual do sistema, em unidades de tempo
-int relogio_agora(relogio_t *self);
+// o relógio tem 64 bits, para não estourar em execuções longas (o tempo com
+//   a CPU parada passa de uma vez até o próximo evento); lido como dispositivo
+//   de E/S, tem só os 32 bits de baixo
+long long relogio_agora(relogio_t *self);
 
 // Funções para acessar o relógio como dispositivo de E/S, com id:
 //   '0' para ler o relógio local (contador de instruções)
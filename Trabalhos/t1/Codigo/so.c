@@ -10,27 +10,54 @@
 #include "programa.h"
 #include "instrucao.h"
 #include "processo.h"
+#include "escalonador.h"
+#include "metricas.h"
+#include "rastro.h"
+#include "log.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
-
-// METRICAS E DADOS
-int QUANTIDADE_PROC_CRIADOS = 0;
-int TEMPO_TOTAL_EXEC = 0;
-int TEMPO_OCIOSO = 0;
-int PREEMPCOES = 0;
-int NUMERO_INTERRUPCOES_TIPO[N_IRQ] = {0, 0, 0, 0, 0, 0};
+#include <assert.h>
 
 // CONSTANTES E TIPOS {{{1
 // intervalo entre interrupções do relógio
 #define INTERVALO_INTERRUPCAO 30 // em instruções executadas
 
-#define QUANTIDADE_PROCESSOS 4
-#define QUANTUM 15
+#define QUANTIDADE_TERMINAIS 4
+// tamanho dos blocos em que são alocados os descritores de processo, e
+//   tamanho inicial do mapa de pids (potência de 2)
+#define PROCESSOS_POR_BLOCO 64
+#define CAP_INICIAL_MAPA 64
 
 int PID_GLOBAL = 0;
 
+// nomes dos estados e das chamadas de sistema, para o rastro
+static char *nomes_estados[QUANTIDADE_ESTADOS_PROC] = {
+  [ESTADO_PROC_MORTO] = "morto",
+  [ESTADO_PROC_PRONTO] = "pronto",
+  [ESTADO_PROC_BLOQUEADO] = "bloqueado",
+  [ESTADO_PROC_EXECUTANDO] = "executando",
+};
+static char *nomes_chamadas[] = {
+  [SO_LE] = "le",
+  [SO_ESCR] = "escr",
+  [SO_CRIA_PROC] = "cria_proc",
+  [SO_MATA_PROC] = "mata_proc",
+  [SO_ESPERA_PROC] = "espera_proc",
+};
+
+// entrada do mapa de pids; pid MAPA_VAZIO se nunca foi usada, MAPA_REMOVIDO se
+//   o processo já morreu (a busca tem que continuar depois dela)
+#define MAPA_VAZIO -1
+#define MAPA_REMOVIDO -2
+typedef struct
+{
+  int pid;
+  int entrada;
+  int geracao;
+} entrada_mapa_t;
+
 struct so_t
 {
   cpu_t *cpu;
@@ -38,13 +65,32 @@ struct so_t
   es_t *es;
   console_t *console;
   bool erro_interno;
-  processo_t tabela_processos[QUANTIDADE_PROCESSOS];
   processo_t *processo_corrente;
 
-  porta_t tabela_portas[QUANTIDADE_PROCESSOS];
-
-  processo_t *fila_processos;
-  int quantum;
+  // tabela de processos: os descritores são alocados em blocos que nunca
+  //   mudam de lugar (as filas guardam ponteiros para eles); a entrada i está
+  //   no bloco i / PROCESSOS_POR_BLOCO. As entradas de processos mortos vão
+  //   para uma pilha e são reaproveitadas
+  processo_t **blocos_processos;
+  int n_blocos_processos;
+  int cap_blocos_processos;
+  int n_entradas;
+  int *entradas_livres;
+  int n_entradas_livres;
+  int n_processos_vivos;
+  // mapa de espalhamento pid -> entrada, com endereçamento aberto; n_mapa
+  //   conta as posições vazias que já foram usadas
+  entrada_mapa_t *mapa;
+  int cap_mapa;
+  int n_mapa;
+
+  porta_t tabela_portas[QUANTIDADE_TERMINAIS];
+
+  // mantém os processos prontos e decide qual executa
+  escalonador_t *escalonador;
+
+  // contadores e histogramas da execução, gravados quando todos morrem
+  metricas_t *metricas;
 
   int relogio_so;
 };
@@ -59,73 +105,78 @@ static int so_carrega_programa(so_t *self, char *nome_do_executavel);
 static bool copia_str_da_mem(int tam, char str[tam], mem_t *mem, int ender);
 
 // minhas funcoes
-static void trata_pendencia_esc(so_t *self, processo_t *processo);
-static void trata_pendencia_le(so_t *self, processo_t *processo);
-static void trata_pendencia_espera(so_t *self, processo_t *processo);
+static void acorda_leitores(so_t *self, porta_t *porta);
+static void acorda_escritores(so_t *self, porta_t *porta);
+static void acorda_quem_espera(so_t *self, processo_t *processo);
+static void habilita_irq_terminais(so_t *self);
 static void inicializa_proc(so_t *self, processo_t *processo, int ender_carga);
 static void desarma_relogio(so_t *self);
+static bool imprime_metricas(so_t *self);
 static void so_atualiza_metricas(so_t *self, int delta);
 static void so_sincroniza(so_t *self);
-static void muda_estado_proc(processo_t *processo, int novo_estado);
-char *nome_estado(int estado);
+static void muda_estado_proc(so_t *self, processo_t *processo, int novo_estado);
+static void mata_processo(so_t *self, processo_t *processo);
 
 // CRIAÇÃO {{{1
 
-err_t inicializa_tabela_processos(so_t *self)
+static void esvazia_mapa(entrada_mapa_t *mapa, int cap)
 {
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
+  for (int i = 0; i < cap; i++)
   {
-    self->tabela_processos[i].estado_processo = ESTADO_PROC_MORTO;
-    self->tabela_processos[i].porta_processo = NULL;
+    mapa[i].pid = MAPA_VAZIO;
   }
-  return ERR_OK;
 }
 
-err_t inicializa_tabela_portas(so_t *self)
+err_t inicializa_tabela_processos(so_t *self)
 {
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
-  {
-    self->tabela_portas[i].porta_ocupada = false;
-  }
+  self->blocos_processos = NULL;
+  self->n_blocos_processos = 0;
+  self->cap_blocos_processos = 0;
+  self->n_entradas = 0;
+  self->entradas_livres = NULL;
+  self->n_entradas_livres = 0;
+  self->n_processos_vivos = 0;
+
+  self->cap_mapa = CAP_INICIAL_MAPA;
+  self->n_mapa = 0;
+  self->mapa = malloc(self->cap_mapa * sizeof(*self->mapa));
+  assert(self->mapa != NULL);
+  esvazia_mapa(self->mapa, self->cap_mapa);
+
   return ERR_OK;
 }
 
-static void so_atualiza_metricas_proc(so_t *self, int delta)
+static void destroi_tabela_processos(so_t *self)
 {
-  for(int i = 0; i < QUANTIDADE_PROC_CRIADOS; i++)
+  for (int i = 0; i < self->n_blocos_processos; i++)
   {
-    processo_t *p = &self->tabela_processos[i];
-
-    p->metricas->estado_t_total[p->estado_processo] += delta;
+    free(self->blocos_processos[i]);
   }
+  free(self->blocos_processos);
+  free(self->entradas_livres);
+  free(self->mapa);
 }
 
-static void so_atualiza_metricas(so_t *self, int delta)
+err_t inicializa_tabela_portas(so_t *self)
 {
-  TEMPO_TOTAL_EXEC += delta;
-  
-  if (self->processo_corrente == NULL) {
-    TEMPO_OCIOSO += delta;
+  for (int i = 0; i < QUANTIDADE_TERMINAIS; i++)
+  {
+    porta_t *p = &self->tabela_portas[i];
+    int deslocamento = 4 * i;
+    p->n_processos = 0;
+    p->teclado = D_TERM_A_TECLADO + deslocamento;
+    p->teclado_estado = D_TERM_A_TECLADO_OK + deslocamento;
+    p->tela = D_TERM_A_TELA + deslocamento;
+    p->tela_estado = D_TERM_A_TELA_OK + deslocamento;
+    p->espera_teclado.inicio = NULL;
+    p->espera_tela.inicio = NULL;
   }
-
-  so_atualiza_metricas_proc(self, delta);
+  return ERR_OK;
 }
 
-char *nome_estado(int estado)
+static void so_atualiza_metricas(so_t *self, int delta)
 {
-  switch(estado)
-  {
-    case ESTADO_PROC_BLOQUEADO:
-      return "bloqueado";
-    case ESTADO_PROC_EXECUTANDO:
-      return "executando";
-    case ESTADO_PROC_MORTO:
-      return "morto";
-    case ESTADO_PROC_PRONTO:
-      return "pronto";
-    default:
-      return "desconhecido";
-  }
+  metricas_tempo(self->metricas, delta, self->processo_corrente == NULL);
 }
 
 static void so_sincroniza(so_t *self)
@@ -148,7 +199,8 @@ static void so_sincroniza(so_t *self)
   so_atualiza_metricas(self, delta);
 }
 
-so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console)
+so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console,
+              escalonador_t *escalonador)
 {
   so_t *self = malloc(sizeof(*self));
   if (self == NULL)
@@ -161,6 +213,11 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console)
   self->erro_interno = false;
 
   self->relogio_so = -1;
+  self->processo_corrente = NULL;
+  self->escalonador = escalonador;
+  self->metricas = metricas_cria();
+  rastro_define_nomes(rastro_estado, QUANTIDADE_ESTADOS_PROC, nomes_estados);
+  rastro_define_nomes(rastro_chamada, sizeof(nomes_chamadas) / sizeof(nomes_chamadas[0]), nomes_chamadas);
 
   if (inicializa_tabela_processos(self) != ERR_OK)
   {
@@ -193,6 +250,10 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console)
     self->erro_interno = true;
   }
 
+  // os terminais avisam por interrupção quando chega um caractere ou a tela
+  //   fica pronta, em vez de o SO ter que consultar o estado a cada interrupção
+  habilita_irq_terminais(self);
+
   // programa o relógio para gerar uma interrupção após INTERVALO_INTERRUPCAO
   if (es_escreve(self->es, D_RELOGIO_TIMER, INTERVALO_INTERRUPCAO) != ERR_OK)
   {
@@ -203,18 +264,183 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console)
   return self;
 }
 
+static void habilita_irq_terminais(so_t *self)
+{
+  int habilitadas;
+  if (es_le(self->es, D_PIC_HABILITADAS, &habilitadas) != ERR_OK
+      || es_escreve(self->es, D_PIC_HABILITADAS,
+                    habilitadas | (1 << IRQ_TECLADO) | (1 << IRQ_TELA)) != ERR_OK)
+  {
+    console_printf("SO: problema na habilitação das interrupções dos terminais");
+    self->erro_interno = true;
+  }
+}
+
 void so_destroi(so_t *self)
 {
   cpu_define_chamaC(self->cpu, NULL, NULL);
+  destroi_tabela_processos(self);
+  metricas_destroi(self->metricas);
   free(self);
 }
 
+// TABELA DE PROCESSOS {{{1
+
+static processo_t *processo_da_entrada(so_t *self, int entrada)
+{
+  return &self->blocos_processos[entrada / PROCESSOS_POR_BLOCO][entrada % PROCESSOS_POR_BLOCO];
+}
+
+// retorna uma entrada livre da tabela, aumentando a tabela se não tiver
+static int pega_entrada(so_t *self)
+{
+  if (self->n_entradas_livres > 0)
+  {
+    return self->entradas_livres[--self->n_entradas_livres];
+  }
+  if (self->n_entradas == self->n_blocos_processos * PROCESSOS_POR_BLOCO)
+  {
+    if (self->n_blocos_processos == self->cap_blocos_processos)
+    {
+      self->cap_blocos_processos = self->cap_blocos_processos == 0 ? 4 : 2 * self->cap_blocos_processos;
+      self->blocos_processos = realloc(self->blocos_processos, self->cap_blocos_processos * sizeof(*self->blocos_processos));
+      assert(self->blocos_processos != NULL);
+      self->entradas_livres = realloc(self->entradas_livres, self->cap_blocos_processos * PROCESSOS_POR_BLOCO * sizeof(*self->entradas_livres));
+      assert(self->entradas_livres != NULL);
+    }
+    processo_t *bloco = malloc(PROCESSOS_POR_BLOCO * sizeof(*bloco));
+    assert(bloco != NULL);
+    for (int i = 0; i < PROCESSOS_POR_BLOCO; i++)
+    {
+      bloco[i].estado_processo = ESTADO_PROC_MORTO;
+      bloco[i].porta_processo = NULL;
+      bloco[i].entrada = self->n_entradas + i;
+      bloco[i].geracao = 0;
+    }
+    self->blocos_processos[self->n_blocos_processos++] = bloco;
+  }
+  return self->n_entradas++;
+}
+
+// posição do mapa onde está o pid, ou onde ele deve ser inserido
+static int posicao_no_mapa(entrada_mapa_t *mapa, int cap, int pid, bool inserindo)
+{
+  unsigned pos = ((unsigned)pid * 2654435761u) & (cap - 1);
+  int removida = -1;
+  for (;;)
+  {
+    if (mapa[pos].pid == pid)
+    {
+      return pos;
+    }
+    if (mapa[pos].pid == MAPA_VAZIO)
+    {
+      return (inserindo && removida != -1) ? removida : (int)pos;
+    }
+    if (mapa[pos].pid == MAPA_REMOVIDO && removida == -1)
+    {
+      removida = pos;
+    }
+    pos = (pos + 1) & (cap - 1);
+  }
+}
+
+// refaz o mapa sem as posições removidas, dobrando de tamanho se estiver
+//   mais da metade ocupado por processos vivos
+static void refaz_mapa(so_t *self)
+{
+  int cap = self->cap_mapa;
+  if (2 * self->n_processos_vivos >= cap)
+  {
+    cap *= 2;
+  }
+  entrada_mapa_t *mapa = malloc(cap * sizeof(*mapa));
+  assert(mapa != NULL);
+  esvazia_mapa(mapa, cap);
+  for (int i = 0; i < self->cap_mapa; i++)
+  {
+    if (self->mapa[i].pid >= 0)
+    {
+      mapa[posicao_no_mapa(mapa, cap, self->mapa[i].pid, true)] = self->mapa[i];
+    }
+  }
+  free(self->mapa);
+  self->mapa = mapa;
+  self->cap_mapa = cap;
+  self->n_mapa = self->n_processos_vivos;
+}
+
+static void mapa_insere(so_t *self, processo_t *processo)
+{
+  // mantém pelo menos um quarto das posições vazias
+  if (4 * (self->n_mapa + 1) > 3 * self->cap_mapa)
+  {
+    refaz_mapa(self);
+  }
+  int pos = posicao_no_mapa(self->mapa, self->cap_mapa, processo->pid_processo, true);
+  if (self->mapa[pos].pid == MAPA_VAZIO)
+  {
+    self->n_mapa++;
+  }
+  self->mapa[pos] = (entrada_mapa_t){ processo->pid_processo, processo->entrada, processo->geracao };
+}
+
+static void mapa_remove(so_t *self, int pid)
+{
+  int pos = posicao_no_mapa(self->mapa, self->cap_mapa, pid, false);
+  if (self->mapa[pos].pid == pid)
+  {
+    self->mapa[pos].pid = MAPA_REMOVIDO;
+  }
+}
+
+// retorna o processo vivo com o pid, ou NULL se não existe
+static processo_t *busca_processo(so_t *self, int pid)
+{
+  if (pid < 0)
+  {
+    return NULL;
+  }
+  entrada_mapa_t *e = &self->mapa[posicao_no_mapa(self->mapa, self->cap_mapa, pid, false)];
+  if (e->pid != pid)
+  {
+    return NULL;
+  }
+  processo_t *processo = processo_da_entrada(self, e->entrada);
+  // a entrada pode ter sido reaproveitada por outro processo
+  if (processo->geracao != e->geracao || processo->pid_processo != pid)
+  {
+    return NULL;
+  }
+  return processo;
+}
+
+// cria um processo em uma entrada livre da tabela, pronto para executar a
+//   partir de ender_carga
+static processo_t *cria_processo(so_t *self, int ender_carga)
+{
+  processo_t *processo = processo_da_entrada(self, pega_entrada(self));
+  inicializa_proc(self, processo, ender_carga);
+  mapa_insere(self, processo);
+  self->n_processos_vivos++;
+  return processo;
+}
+
+// devolve para a tabela a entrada de um processo que morreu
+static void libera_processo(so_t *self, processo_t *processo)
+{
+  processo->porta_processo->n_processos--;
+  mapa_remove(self, processo->pid_processo);
+  processo->geracao++;
+  self->entradas_livres[self->n_entradas_livres++] = processo->entrada;
+  self->n_processos_vivos--;
+}
+
 // TRATAMENTO DE INTERRUPÇÃO {{{1
 
 // funções auxiliares para o tratamento de interrupção
 static void so_salva_estado_da_cpu(so_t *self);
 static void so_trata_irq(so_t *self, int irq);
-static void so_trata_pendencias(so_t *self);
 static void so_escalona(so_t *self);
 static int so_despacha(so_t *self);
 
@@ -236,20 +462,30 @@ static int so_trata_interrupcao(void *argC, int reg_A)
 {
   so_t *self = argC;
   irq_t irq = reg_A;
-  // esse print polui bastante, recomendo tirar quando estiver com mais confiança
-  // console_printf("SO: recebi IRQ %d (%s)", irq, irq_nome(irq));
+  // esse print polui bastante; é de depuração, só vai para o log com a
+  //   opção -v
+  LOG(log_depura, log_so, "SO: recebi IRQ %d (%s)", irq, irq_nome(irq));
+  RASTRO_INICIO(rastro_interrupcao, irq, 0);
   // salva o estado da cpu no descritor do processo que foi interrompido
   so_salva_estado_da_cpu(self);
   // sincroniza o relogio do so
   so_sincroniza(self);
-  // faz o atendimento da interrupção
+  // faz o atendimento da interrupção (os processos bloqueados são
+  //   desbloqueados pelas interrupções dos terminais ou pela morte do
+  //   processo esperado, não precisam ser verificados aqui)
   so_trata_irq(self, irq);
-  // faz o processamento independente da interrupção
-  so_trata_pendencias(self);
+  // o operador pode pedir as métricas no meio da execução (comando M da
+  //   console); no final, elas são gravadas quando o relógio é desarmado
+  if (console_pedido_de_metricas(self->console) && imprime_metricas(self))
+  {
+    console_printf("SO: métricas gravadas em metricas.txt, .json e .csv");
+  }
   // escolhe o próximo processo a executar
   so_escalona(self);
   // recupera o estado do processo escolhido
-  return so_despacha(self);
+  int para = so_despacha(self);
+  RASTRO_FIM(rastro_interrupcao, irq, 0);
+  return para;
 }
 
 static void so_salva_estado_da_cpu(so_t *self)
@@ -299,45 +535,6 @@ static void so_salva_estado_da_cpu(so_t *self)
   }
 }
 
-static void so_trata_pendencias(so_t *self)
-{
-
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
-  {
-    processo_t *processo = &self->tabela_processos[i];
-    if (processo->estado_processo == ESTADO_PROC_BLOQUEADO)
-    {
-      switch (processo->bloqueio_motivo)
-      {
-      case BLOQUEIO_ESC:
-        trata_pendencia_esc(self, processo);
-        break;
-
-      case BLOQUEIO_LE:
-        trata_pendencia_le(self, processo);
-        break;
-
-      case BLOQUEIO_ESPERA:
-        trata_pendencia_espera(self, processo);
-        break;
-
-      default:
-        console_printf("Motivo de bloqueio desconhecido.");
-        self->erro_interno = true;
-        break;
-      }
-    }
-  }
-}
-
-static void atualiza_prioridade(so_t *self, processo_t *processo)
-{
-  double t_exec = QUANTUM - self->quantum;
-  double prio = (processo->prioridade + (t_exec / QUANTUM)) / 2;
-
-  processo->prioridade = prio;
-}
-
 static int so_precisa_escalonar(so_t *self)
 {
   if (self->processo_corrente == NULL)
@@ -348,71 +545,101 @@ static int so_precisa_escalonar(so_t *self)
 
   if (self->processo_corrente->estado_processo == ESTADO_PROC_BLOQUEADO)
   {
-    console_printf("vou escalonar pq bloqueou");
-    console_printf("prio: %lf -> ", self->processo_corrente->prioridade);
-    atualiza_prioridade(self, self->processo_corrente);
-    console_printf("%lf", self->processo_corrente->prioridade);
+    double prio = self->processo_corrente->prioridade;
+    escalonador_bloqueou(self->escalonador, self->processo_corrente);
+    LOG(log_depura, log_escalona, "vou escalonar pq bloqueou; prio: %lf -> %lf", prio, self->processo_corrente->prioridade);
     return 1;
   }
 
-  if (self->quantum <= 0)
+  if (escalonador_quantum_acabou(self->escalonador))
   {
-    PREEMPCOES++;
-    self->processo_corrente->metricas->n_preempcoes += 1;
-    console_printf("vou escalonar pq quantum < 0");
+    metricas_preempcao(self->metricas, self->processo_corrente->pid_processo);
+    double prio = self->processo_corrente->prioridade;
+    escalonador_preemptou(self->escalonador, self->processo_corrente);
+    LOG(log_depura, log_escalona, "vou escalonar pq quantum < 0; prio: %lf -> %lf", prio, self->processo_corrente->prioridade);
     //self->processo_corrente->estado_processo = ESTADO_PROC_PRONTO;
-    muda_estado_proc(self->processo_corrente, ESTADO_PROC_PRONTO);
-    console_printf("prio: %lf -> ", self->processo_corrente->prioridade);
-    atualiza_prioridade(self, self->processo_corrente);
-    console_printf("%lf", self->processo_corrente->prioridade);
+    muda_estado_proc(self, self->processo_corrente, ESTADO_PROC_PRONTO);
     return 1;
   }
 
   return 0;
 }
 
-static void bloqueia_processo(so_t *self, processo_t *processo, bloqueio_id motivo, int pid_esperado)
+// filas de espera: cada motivo de bloqueio tem sua fila (uma por terminal
+//   para leitura, uma por terminal para escrita, uma por processo esperado),
+//   e quem desbloqueia só percorre os processos que estão na fila certa
+
+static void fila_espera_insere(fila_espera_t *fila, processo_t *processo)
 {
-  if (processo->estado_processo != ESTADO_PROC_BLOQUEADO && processo->estado_processo != ESTADO_PROC_MORTO)
+  processo->prox_espera = NULL;
+  processo->fila_espera = fila;
+  if (fila->inicio == NULL)
   {
-    //processo->estado_processo = ESTADO_PROC_BLOQUEADO;
-    muda_estado_proc(processo, ESTADO_PROC_BLOQUEADO);
-    processo->bloqueio_motivo = motivo;
+    fila->inicio = processo;
+  }
+  else
+  {
+    fila->fim->prox_espera = processo;
+  }
+  fila->fim = processo;
+}
 
-    if (motivo == BLOQUEIO_ESPERA)
-    {
-      processo->pid_esperado = pid_esperado;
-    }
+static void fila_espera_remove(fila_espera_t *fila, processo_t *processo)
+{
+  processo_t *anterior = NULL;
+  processo_t *andarilho = fila->inicio;
+  while (andarilho != NULL && andarilho != processo)
+  {
+    anterior = andarilho;
+    andarilho = andarilho->prox_espera;
+  }
+  if (andarilho == NULL)
+  {
+    return;
+  }
+  if (anterior == NULL)
+  {
+    fila->inicio = processo->prox_espera;
   }
+  else
+  {
+    anterior->prox_espera = processo->prox_espera;
+  }
+  if (fila->fim == processo)
+  {
+    fila->fim = anterior;
+  }
+  processo->prox_espera = NULL;
+  processo->fila_espera = NULL;
 }
 
-processo_t *pega_maior_prioridade(processo_t *fila_processos)
+static void bloqueia_processo(so_t *self, processo_t *processo, bloqueio_id motivo, fila_espera_t *fila)
 {
-  double menor = 999;
-  processo_t *andarilho = fila_processos;
-  processo_t *retorno = NULL;
-  while (andarilho != NULL)
+  if (processo->estado_processo != ESTADO_PROC_BLOQUEADO && processo->estado_processo != ESTADO_PROC_MORTO)
   {
-    if (andarilho->prioridade < menor)
-    {
-      retorno = andarilho;
-      menor = andarilho->prioridade;
-    }
-    andarilho = andarilho->prox_processo;
+    //processo->estado_processo = ESTADO_PROC_BLOQUEADO;
+    muda_estado_proc(self, processo, ESTADO_PROC_BLOQUEADO);
+    processo->bloqueio_motivo = motivo;
+    fila_espera_insere(fila, processo);
   }
-  return retorno;
 }
 
 static void desbloqueia_processo(so_t *self, processo_t *processo)
 {
+  if (processo->fila_espera != NULL)
+  {
+    fila_espera_remove(processo->fila_espera, processo);
+  }
   if (processo->estado_processo == ESTADO_PROC_BLOQUEADO)
   {
+    escalonador_acordou(self->escalonador, processo);
     //processo->estado_processo = ESTADO_PROC_PRONTO;
-    muda_estado_proc(processo, ESTADO_PROC_PRONTO);
+    muda_estado_proc(self, processo, ESTADO_PROC_PRONTO);
   }
 }
 
-static void tenta_ler(so_t *self, processo_t *processo, int chamada_sistema)
+// retorna true se conseguiu ler
+static bool tenta_ler(so_t *self, processo_t *processo, int chamada_sistema)
 {
 
   int estado;
@@ -423,12 +650,16 @@ static void tenta_ler(so_t *self, processo_t *processo, int chamada_sistema)
   {
     console_printf("SO: problema no acesso ao estado do teclado");
     self->erro_interno = true;
-    return;
+    return false;
   }
 
-  if (estado == 0 && chamada_sistema == 1)
+  if (estado == 0)
   {
-    bloqueia_processo(self, processo, BLOQUEIO_LE, 0);
+    if (chamada_sistema)
+    {
+      bloqueia_processo(self, processo, BLOQUEIO_LE, &processo->porta_processo->espera_teclado);
+    }
+    return false;
   }
   else
   {
@@ -437,15 +668,17 @@ static void tenta_ler(so_t *self, processo_t *processo, int chamada_sistema)
     {
       console_printf("SO: problema no acesso ao teclado");
       self->erro_interno = true;
-      return;
+      return false;
     }
     processo->reg_A = dado;
 
     desbloqueia_processo(self, processo);
+    return true;
   }
 }
 
-static void tenta_escrever(so_t *self, processo_t *processo, int chamada_sistema)
+// retorna true se conseguiu escrever
+static bool tenta_escrever(so_t *self, processo_t *processo, int chamada_sistema)
 {
   int estado;
   int tela_estado = processo->porta_processo->tela_estado;
@@ -455,12 +688,16 @@ static void tenta_escrever(so_t *self, processo_t *processo, int chamada_sistema
   {
     console_printf("SO: problema no acesso ao estado da tela");
     self->erro_interno = true;
-    return;
+    return false;
   }
 
-  if (estado == 0 && chamada_sistema == 1)
+  if (estado == 0)
   {
-    bloqueia_processo(self, processo, BLOQUEIO_ESC, 0);
+    if (chamada_sistema)
+    {
+      bloqueia_processo(self, processo, BLOQUEIO_ESC, &processo->porta_processo->espera_tela);
+    }
+    return false;
   }
   else
   {
@@ -469,7 +706,7 @@ static void tenta_escrever(so_t *self, processo_t *processo, int chamada_sistema
     {
       console_printf("SO: problema no acesso a tela");
       // self->erro_interno = true;
-      return;
+      return false;
     }
     desbloqueia_processo(self, processo);
 
@@ -477,91 +714,42 @@ static void tenta_escrever(so_t *self, processo_t *processo, int chamada_sistema
     {
       processo->reg_A = 0;
     }
+    return true;
   }
 }
 
-static void trata_pendencia_le(so_t *self, processo_t *processo)
-{
-  tenta_ler(self, processo, false);
-}
-
-static void trata_pendencia_esc(so_t *self, processo_t *processo)
-{
-  tenta_escrever(self, processo, false);
-}
-
-static void trata_pendencia_espera(so_t *self, processo_t *processo)
-{
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
-  {
-    processo_t *processo_esperado = &self->tabela_processos[i];
-    if (processo_esperado->pid_processo == processo->pid_esperado && processo_esperado->estado_processo == ESTADO_PROC_MORTO)
-    {
-      desbloqueia_processo(self, processo);
-      console_printf("Desbloquando processo porque o esperado de PID %d morreu.", processo_esperado->pid_processo);
-    }
-  }
-}
-
-static void coloca_processo_fila(so_t *self, processo_t *processo)
+// desbloqueia, em ordem, os processos esperando o teclado da porta, enquanto
+//   tiver caractere para eles
+static void acorda_leitores(so_t *self, porta_t *porta)
 {
-  /* if (self->fila_processos == NULL)
+  while (porta->espera_teclado.inicio != NULL && tenta_ler(self, porta->espera_teclado.inicio, false))
   {
-    self->fila_processos = processo;
+    ;
   }
-  else
-  {
-    processo_t *andarilho = self->fila_processos;
-    while (andarilho->prox_processo != NULL)
-    {
-      andarilho = andarilho->prox_processo;
-    }
-    andarilho->prox_processo = processo;
-  }
-  processo->prox_processo = NULL; */
-  if (self->fila_processos == NULL)
-    processo->prox_processo = NULL;
-  else
-    processo->prox_processo = self->fila_processos;
-
-  self->fila_processos = processo;
 }
 
-static void imprime_tabela_processos(so_t *self)
+// desbloqueia, em ordem, os processos esperando a tela da porta, enquanto ela
+//   estiver pronta
+static void acorda_escritores(so_t *self, porta_t *porta)
 {
-  /* processo_t *p = self->fila_processos;
-  while(p != NULL)
+  while (porta->espera_tela.inicio != NULL && tenta_escrever(self, porta->espera_tela.inicio, false))
   {
-    console_printf("pid: %d estado: %d", p->pid_processo, p->estado_processo);
-    p = p->prox_processo;
-  } */
-
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
-  {
-    processo_t *p = &self->tabela_processos[i];
-    console_printf("pid %d estado %s", p->pid_processo, nome_estado(p->estado_processo));
+    ;
   }
 }
 
-static err_t atualiza_fila(so_t *self)
+// desbloqueia os processos que esperam a morte do processo
+static void acorda_quem_espera(so_t *self, processo_t *processo)
 {
-  self->fila_processos = NULL; // reseta a fila
-
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
+  while (processo->espera_morte.inicio != NULL)
   {
-    processo_t *p = &self->tabela_processos[i];
-    if (p->estado_processo == ESTADO_PROC_PRONTO)
-    {
-      coloca_processo_fila(self, p);
-    }
+    desbloqueia_processo(self, processo->espera_morte.inicio);
+    LOG(log_info, log_so, "Desbloquando processo porque o esperado de PID %d morreu.", processo->pid_processo);
   }
-
-  return ERR_OK;
 }
 
 static void so_escalona(so_t *self)
 {
-  imprime_tabela_processos(self);
   // escolhe o próximo processo a executar, que passa a ser o processo
   //   corrente; pode continuar sendo o mesmo de antes ou não
   // t1: na primeira versão, escolhe um processo caso o processo corrente não possa continuar
@@ -575,27 +763,19 @@ static void so_escalona(so_t *self)
   else
   {
     ant = self->processo_corrente;
-
-    if (atualiza_fila(self) != ERR_OK)
-    {
-      self->erro_interno = true;
-      return;
-    }
-    else
-    {
-      self->processo_corrente = pega_maior_prioridade(self->fila_processos);
-    }
+    self->processo_corrente = escalonador_proximo(self->escalonador);
+    RASTRO(rastro_escalona, self->processo_corrente == NULL ? -1 : self->processo_corrente->pid_processo, 0);
   }
 
-  if (self->processo_corrente != ant)
+  if (self->processo_corrente != ant && self->processo_corrente != NULL)
   { // se mudou o processo em execucao, reseta o quantum
-    self->quantum = QUANTUM;
+    escalonador_executa(self->escalonador, self->processo_corrente);
   }
 }
 
 static int so_despacha(so_t *self)
 {
-  console_printf("quantum = %d", self->quantum);
+  LOG(log_depura, log_escalona, "quantum = %d", escalonador_quantum(self->escalonador));
   // t1: se houver processo corrente, coloca o estado desse processo onde ele
   //   será recuperado pela CPU (em IRQ_END_*) e retorna 0, senão retorna 1
   // o valor retornado será o valor de retorno de CHAMAC
@@ -603,11 +783,12 @@ static int so_despacha(so_t *self)
 
   if (self->erro_interno || self->processo_corrente == NULL)
   {
-    console_printf("deu ruim na 1 verificacao do despacha, erro interno %d", self->erro_interno);
+    LOG(log_depura, log_escalona, "deu ruim na 1 verificacao do despacha, erro interno %d", self->erro_interno);
     if (self->processo_corrente != NULL)
     {
-      console_printf("proc corrente %d estado %d", self->processo_corrente->pid_processo, self->processo_corrente->estado_processo);
+      LOG(log_depura, log_escalona, "proc corrente %d estado %d", self->processo_corrente->pid_processo, self->processo_corrente->estado_processo);
     }
+    RASTRO(rastro_despacha, -1, 1);
     return 1;
   }
   else
@@ -644,8 +825,9 @@ static int so_despacha(so_t *self)
     else
     {
       // self->processo_corrente->estado_processo = ESTADO_PROC_EXECUTANDO;
-      console_printf("proc corrente %d", self->processo_corrente->pid_processo);
-      muda_estado_proc(self->processo_corrente, ESTADO_PROC_EXECUTANDO);
+      LOG(log_depura, log_escalona, "proc corrente %d", self->processo_corrente->pid_processo);
+      muda_estado_proc(self, self->processo_corrente, ESTADO_PROC_EXECUTANDO);
+      RASTRO(rastro_despacha, self->processo_corrente->pid_processo, 0);
       return 0; // deu tudo certo
     }
   }
@@ -658,11 +840,13 @@ static void so_trata_irq_reset(so_t *self);
 static void so_trata_irq_chamada_sistema(so_t *self);
 static void so_trata_irq_err_cpu(so_t *self);
 static void so_trata_irq_relogio(so_t *self);
+static void so_trata_irq_teclado(so_t *self);
+static void so_trata_irq_tela(so_t *self);
 static void so_trata_irq_desconhecida(so_t *self, int irq);
 
 static void so_trata_irq(so_t *self, int irq)
 {
-  NUMERO_INTERRUPCOES_TIPO[irq] += 1;
+  metricas_interrupcao(self->metricas, irq);
   // verifica o tipo de interrupção que está acontecendo, e atende de acordo
   switch (irq)
   {
@@ -678,6 +862,12 @@ static void so_trata_irq(so_t *self, int irq)
   case IRQ_RELOGIO:
     so_trata_irq_relogio(self);
     break;
+  case IRQ_TECLADO:
+    so_trata_irq_teclado(self);
+    break;
+  case IRQ_TELA:
+    so_trata_irq_tela(self);
+    break;
   default:
     so_trata_irq_desconhecida(self, irq);
   }
@@ -701,24 +891,7 @@ static void so_trata_irq_reset(so_t *self)
     return;
   }
 
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
-  {
-    processo_t *processo = &self->tabela_processos[i];
-    if (processo->estado_processo == ESTADO_PROC_MORTO)
-    {
-
-      inicializa_proc(self, processo, ender);
-
-      if (processo->porta_processo == NULL)
-      {
-        console_printf("Impossivel atribuir terminal ao processo.");
-        self->erro_interno = true;
-      }
-      // self->processo_corrente = processo;
-      QUANTIDADE_PROC_CRIADOS++;
-      return;
-    }
-  }
+  cria_processo(self, ender);
 }
 
 static void so_trata_irq_err_cpu(so_t *self)
@@ -736,64 +909,58 @@ static void so_trata_irq_err_cpu(so_t *self)
   console_printf("SO: IRQ não tratada -- erro na CPU: %s", err_nome(err));
   
   console_printf("Matando o processo...PID %d", self->processo_corrente->pid_processo);
-  muda_estado_proc(self->processo_corrente, ESTADO_PROC_MORTO);
+  mata_processo(self, self->processo_corrente);
 }
 
-static void imprime_metricas(so_t *self)
+// grava as métricas nos arquivos metricas.*; retorna false em caso de erro
+static bool imprime_metricas(so_t *self)
 {
-    FILE *arquivo = fopen("metricas.txt", "w");
-    if (arquivo == NULL) {
-        console_printf("Erro ao abrir o arquivo para escrita.\n");
-        return;
-    }
-
-    fprintf(arquivo, "QUANTIDADE PROC CRIADOS: %d\n", QUANTIDADE_PROC_CRIADOS);
-    fprintf(arquivo, "TEMPO TOTAL EXEC: %d\n", TEMPO_TOTAL_EXEC);
-    fprintf(arquivo, "TEMPO OCIOSO: %d\n", TEMPO_OCIOSO);
-    fprintf(arquivo, "PREEMPCOES: %d\n", PREEMPCOES);
-
-    
-    for (int i = 0; i < N_IRQ; i++) {
-        fprintf(arquivo, "%s: %d\n", irq_nome(i), NUMERO_INTERRUPCOES_TIPO[i]);
-    }
-
-    for (int i = 0; i < QUANTIDADE_PROC_CRIADOS; i++) {
-      int soma_estados = 0;
-        processo_t *p = &self->tabela_processos[i];
-        proc_metricas *met = p->metricas;
-        fprintf(arquivo, "--------------------------------------------\n");
-        fprintf(arquivo, "PID: %d\n", p->pid_processo);
-
-        for (int j = 1; j < QUANTIDADE_ESTADOS_PROC; j++) {
-          if(j >= 2)
-            soma_estados += met->estado_n_vezes[j];
-          fprintf(arquivo, "Estado %s: %d vezes\n", nome_estado(j), met->estado_n_vezes[j]);
-          fprintf(arquivo, "Estado %s: %d inst\n", nome_estado(j), met->estado_t_total[j]);
-        }
-      fprintf(arquivo, "Preempcoes: %d vezes\n", met->n_preempcoes);
-      fprintf(arquivo, "Tempo medio resposta: %f\n", (double)met->estado_t_total[ESTADO_PROC_PRONTO]/met->estado_n_vezes[ESTADO_PROC_PRONTO]);
-      fprintf(arquivo, "Tempo retorno: %d inst\n", soma_estados);
-      
-    }
-
-    fclose(arquivo);
+  if (!metricas_grava(self->metricas, "metricas", escalonador_nome(self->escalonador), self->relogio_so))
+  {
+    console_printf("SO: erro ao gravar os arquivos de metricas.");
+    return false;
+  }
+  return true;
 }
 
-static void muda_estado_proc(processo_t *processo, int novo_estado)
+static void muda_estado_proc(so_t *self, processo_t *processo, int novo_estado)
 {
+  // mantém a fila de prontos com os processos no estado pronto
+  if (processo->estado_processo == ESTADO_PROC_PRONTO && novo_estado != ESTADO_PROC_PRONTO)
+  {
+    escalonador_remove(self->escalonador, processo);
+  }
+  else if (processo->estado_processo != ESTADO_PROC_PRONTO && novo_estado == ESTADO_PROC_PRONTO)
+  {
+    escalonador_insere(self->escalonador, processo);
+  }
   processo->estado_processo = novo_estado;
-  processo->metricas->estado_n_vezes[novo_estado] += 1;
+  RASTRO(rastro_estado, processo->pid_processo, novo_estado);
+  metricas_muda_estado(self->metricas, processo->pid_processo, novo_estado, self->relogio_so);
+}
+
+// mata o processo, desbloqueia quem estava esperando por ele e libera sua
+//   entrada na tabela
+static void mata_processo(so_t *self, processo_t *processo)
+{
+  if (processo->estado_processo == ESTADO_PROC_MORTO)
+  {
+    return;
+  }
+  if (processo->fila_espera != NULL)
+  {
+    fila_espera_remove(processo->fila_espera, processo);
+  }
+  muda_estado_proc(self, processo, ESTADO_PROC_MORTO);
+  acorda_quem_espera(self, processo);
+  libera_processo(self, processo);
 }
 
 static void desarma_relogio(so_t *self)
 {
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
+  if (self->n_processos_vivos > 0)
   {
-    processo_t *p = &self->tabela_processos[i];
-    if (p->estado_processo != ESTADO_PROC_MORTO)
-    {
-      return;
-    }
+    return;
   }
 
   err_t e1 = es_escreve(self->es, D_RELOGIO_INTERRUPCAO, 0);
@@ -822,7 +989,26 @@ static void so_trata_irq_relogio(so_t *self)
     self->erro_interno = true;
   }
   desarma_relogio(self);
-  self->quantum--;
+  escalonador_tictac(self->escalonador);
+}
+
+// chegou caractere em algum terminal; os terminais compartilham a
+//   interrupção, então verifica as filas de leitura de cada terminal
+static void so_trata_irq_teclado(so_t *self)
+{
+  for (int i = 0; i < QUANTIDADE_TERMINAIS; i++)
+  {
+    acorda_leitores(self, &self->tabela_portas[i]);
+  }
+}
+
+// a tela de algum terminal ficou pronta; verifica as filas de escrita
+static void so_trata_irq_tela(so_t *self)
+{
+  for (int i = 0; i < QUANTIDADE_TERMINAIS; i++)
+  {
+    acorda_escritores(self, &self->tabela_portas[i]);
+  }
 }
 
 // foi gerada uma interrupção para a qual o SO não está preparado
@@ -846,8 +1032,9 @@ static void so_trata_irq_chamada_sistema(so_t *self)
   // a identificação da chamada está no registrador A
   // t1: com processos, o reg A tá no descritor do processo corrente
   int id_chamada = self->processo_corrente->reg_A;
+  RASTRO(rastro_chamada, self->processo_corrente->pid_processo, id_chamada);
 
-  // console_printf("SO: chamada de sistema %d", id_chamada);
+  LOG(log_depura, log_so, "SO: chamada de sistema %d", id_chamada);
   switch (id_chamada)
   {
   case SO_LE:
@@ -867,7 +1054,7 @@ static void so_trata_irq_chamada_sistema(so_t *self)
     break;
   default:
     console_printf("SO: chamada de sistema desconhecida (%d)", id_chamada);
-    muda_estado_proc(self->processo_corrente, ESTADO_PROC_MORTO);
+    mata_processo(self, self->processo_corrente);
   }
 }
 
@@ -885,24 +1072,21 @@ static void so_chamada_escr(so_t *self)
   tenta_escrever(self, self->processo_corrente, true);
 }
 
+// escolhe o terminal com menos processos (o primeiro, se empatar); com mais
+//   processos que terminais, eles compartilham
 porta_t *atribuir_porta(so_t *self)
 {
-  for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
+  porta_t *escolhida = &self->tabela_portas[0];
+  for (int i = 1; i < QUANTIDADE_TERMINAIS; i++)
   {
     porta_t *p = &self->tabela_portas[i];
-    if (p->porta_ocupada == false)
+    if (p->n_processos < escolhida->n_processos)
     {
-      int deslocamento = 4 * i;
-      p->porta_ocupada = true;
-      p->teclado = D_TERM_A_TECLADO + deslocamento;
-      p->teclado_estado = D_TERM_A_TECLADO_OK + deslocamento;
-      p->tela = D_TERM_A_TELA + deslocamento;
-      p->tela_estado = D_TERM_A_TELA_OK + deslocamento;
-
-      return p;
+      escolhida = p;
     }
   }
-  return NULL;
+  escolhida->n_processos++;
+  return escolhida;
 }
 
 static void inicializa_proc(so_t *self, processo_t *processo, int ender_carga)
@@ -916,19 +1100,15 @@ static void inicializa_proc(so_t *self, processo_t *processo, int ender_carga)
   processo->pid_processo = PID_GLOBAL++;
   processo->porta_processo = atribuir_porta(self);
   processo->bloqueio_motivo = 0;
+  processo->fila_espera = NULL;
+  processo->prox_espera = NULL;
+  processo->espera_morte.inicio = NULL;
 
-  processo->prioridade = 0.5;
+  escalonador_cria_processo(self->escalonador, processo);
 
-  processo->metricas = (proc_metricas*)malloc(sizeof(proc_metricas));
+  metricas_cria_processo(self->metricas, processo->pid_processo, self->relogio_so);
 
-  for(int i = 0; i < QUANTIDADE_ESTADOS_PROC; i++)
-  {
-    processo->metricas->estado_n_vezes[i] = 0;
-    processo->metricas->estado_t_total[i] = 0;
-    processo->metricas->n_preempcoes = 0;
-  }
-
-  muda_estado_proc(processo, ESTADO_PROC_PRONTO);
+  muda_estado_proc(self, processo, ESTADO_PROC_PRONTO);
 }
 
 // implementação da chamada se sistema SO_CRIA_PROC
@@ -948,27 +1128,9 @@ static void so_chamada_cria_proc(so_t *self)
     int ender_carga = so_carrega_programa(self, nome);
     if (ender_carga > 0)
     {
-      for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
-      {
-        processo_t *processo = &self->tabela_processos[i];
-        if (processo->estado_processo == ESTADO_PROC_MORTO)
-        {
-
-          inicializa_proc(self, processo, ender_carga);
-
-          if (processo->porta_processo == NULL)
-          {
-            console_printf("Impossivel atribuir terminal, por isso nao cria o processo.");
-            self->processo_corrente->reg_A = -1;
-            return;
-          }
-
-          console_printf("Criando novo processo...com PID %d", processo->pid_processo);
-          self->processo_corrente->reg_A = processo->pid_processo;
-          QUANTIDADE_PROC_CRIADOS++;
-          return;
-        }
-      }
+      processo_t *processo = cria_processo(self, ender_carga);
+      console_printf("Criando novo processo...com PID %d", processo->pid_processo);
+      self->processo_corrente->reg_A = processo->pid_processo;
     }
     else
     {
@@ -985,23 +1147,18 @@ static void so_chamada_mata_proc(so_t *self)
   if (self->processo_corrente->reg_X != 0)
   {
     console_printf("Matando o processo de PID %d", self->processo_corrente->reg_X);
-    for (int i = 0; i < QUANTIDADE_PROCESSOS; i++)
+    processo_t *processo = busca_processo(self, self->processo_corrente->reg_X);
+    if (processo == NULL)
     {
-      if (self->tabela_processos[i].pid_processo == self->processo_corrente->reg_X)
-      {
-        //self->tabela_processos[i].estado_processo = ESTADO_PROC_MORTO;
-        muda_estado_proc(&self->tabela_processos[i], ESTADO_PROC_MORTO);
-        self->tabela_processos[i].porta_processo->porta_ocupada = false;
-        return;
-      }
       console_printf("Nao achei o processo com esse PID para matar.");
+      return;
     }
+    mata_processo(self, processo);
   }
   else if (self->processo_corrente->reg_X == 0)
   {
     console_printf("Matando o proprio processo de PID %d.", self->processo_corrente->pid_processo);
-    muda_estado_proc(self->processo_corrente, ESTADO_PROC_MORTO);
-    self->processo_corrente->porta_processo->porta_ocupada = false;
+    mata_processo(self, self->processo_corrente);
   }
 }
 
@@ -1009,7 +1166,15 @@ static void so_chamada_mata_proc(so_t *self)
 // espera o fim do processo com pid X
 static void so_chamada_espera_proc(so_t *self)
 {
-  bloqueia_processo(self, self->processo_corrente, BLOQUEIO_ESPERA, self->processo_corrente->reg_X);
+  // entra na fila do processo esperado; se ele não existe ou já morreu, não
+  //   tem o que esperar
+  int pid = self->processo_corrente->reg_X;
+  processo_t *processo_esperado = busca_processo(self, pid);
+  if (processo_esperado != NULL)
+  {
+    self->processo_corrente->pid_esperado = pid;
+    bloqueia_processo(self, self->processo_corrente, BLOQUEIO_ESPERA, &processo_esperado->espera_morte);
+  }
 }
 
 // CARGA DE PROGRAMA {{{1
@@ -1029,13 +1194,12 @@ static int so_carrega_programa(so_t *self, char *nome_do_executavel)
   int end_ini = prog_end_carga(prog);
   int end_fim = end_ini + prog_tamanho(prog);
 
-  for (int end = end_ini; end < end_fim; end++)
+  if (mem_escreve_bloco(self->mem, end_ini, prog_tamanho(prog),
+                        prog_dados(prog)) != ERR_OK)
   {
-    if (mem_escreve(self->mem, end, prog_dado(prog, end)) != ERR_OK)
-    {
-      console_printf("Erro na carga da memória, endereco %d\n", end);
-      return -1;
-    }
+    console_printf("Erro na carga da memória, endereços %d-%d\n", end_ini, end_fim);
+    prog_destroi(prog);
+    return -1;
   }
 
   prog_destroi(prog);
@@ -12,8 +12,12 @@ typedef struct so_t so_t;
 #include "cpu.h"
 #include "es.h"
 #include "console.h" // só para uma gambiarra
+#include "escalonador.h"
 
-so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console);
+// cria o SO; os processos são escalonados por 'escalonador' (que não é
+//   destruído com o SO)
+so_t *so_cria(cpu_t *cpu, mem_t *mem, es_t *es, console_t *console,
+              escalonador_t *escalonador);
 void so_destroi(so_t *self);
 
 // Chamadas de sistema
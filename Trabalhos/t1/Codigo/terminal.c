@@ -6,7 +6,6 @@
 #include "terminal.h"
 
 #include <stdlib.h>
-#include <string.h>
 #include <assert.h>
 
 // TERMINAL
@@ -16,22 +15,42 @@ struct terminal_t {
   // número de caracteres que cabem em uma linha
   int tam_linha;
   // texto já digitado no terminal, esperando para ser lido
+  // é uma fila circular com 'n_entrada' caracteres a partir de 'ini_entrada',
+  //   com capacidade para 'cap_entrada'
   char *entrada;
-  // texto sendo mostrado na saída do terminal
+  int ini_entrada;
+  int n_entrada;
+  int cap_entrada;
+  // texto sendo mostrado na saída do terminal, também em uma fila circular
+  //   (a linha rola removendo caracteres do início)
   char *saida;
+  int ini_saida;
+  int n_saida;
+  int cap_saida;
+  // cópias das linhas em forma de string, montadas quando a console pede
+  char *txt_entrada;
+  char *txt_saida;
   // normal: aceitando novos caracteres na saída
   // rolando: removendo um caractere no início para gerar espaço.
-  //   move um caractere por vez para a esquerda, até chegar no final
-  //   da linha.
+  //   leva um tictac por caractere da linha, e o caractere só sai no final.
   //   entra neste estado quando recebe um caractere na última posição.
   //   não aceita novos caracteres
-  // limpando: removendo um caractere no início da linha por vez, até
+  // limpando: removendo um caractere no início da linha por tictac, até
   //   ficar com a linha vazia.
   //   entra nesse estado quando recebe um '\n'.
   //   não aceita novos caracteres
   enum { normal, rolando, limpando } estado_saida;
-  // posicao do caractere que está sendo movido durante uma rolagem
-  int pos_rolagem;
+  // quantos tictacs faltam para a rolagem ou limpeza terminar
+  int t_ocupado;
+  // terminal rápido: não tem rolagem nem limpeza demoradas, a saída está
+  //   sempre pronta
+  bool rapido;
+  // controlador de interrupções (NULL se o terminal não interrompe)
+  pic_t *pic;
+  // arquivo onde é copiada a saída (NULL se nenhum)
+  FILE *arq_saida;
+  // se a entrada ou a saída foi alterada desde a última consulta
+  bool alterado;
 };
 
 
@@ -40,14 +59,27 @@ terminal_t *terminal_cria(int tam_linha)
   terminal_t *self = malloc(sizeof(*self));
   assert(self != NULL);
 
-  self->saida = malloc(tam_linha + 1);
-  self->entrada = malloc(tam_linha + 1);
+  self->tam_linha = tam_linha;
+  // os limites são os mesmos de quando as linhas eram strings
+  self->cap_entrada = tam_linha - 2;
+  self->cap_saida = tam_linha - 1;
+  self->entrada = malloc(self->cap_entrada);
+  self->saida = malloc(self->cap_saida);
+  self->txt_entrada = malloc(tam_linha + 1);
+  self->txt_saida = malloc(tam_linha + 1);
   assert(self->saida != NULL && self->entrada != NULL);
+  assert(self->txt_saida != NULL && self->txt_entrada != NULL);
 
-  self->tam_linha = tam_linha;
-  strcpy(self->entrada, "");
-  strcpy(self->saida, "");
+  self->ini_entrada = 0;
+  self->n_entrada = 0;
+  self->ini_saida = 0;
+  self->n_saida = 0;
   self->estado_saida = normal;
+  self->t_ocupado = 0;
+  self->rapido = false;
+  self->pic = NULL;
+  self->arq_saida = NULL;
+  self->alterado = true;
 
   return self;
 }
@@ -56,32 +88,50 @@ void terminal_destroi(terminal_t *self)
 {
   free(self->entrada);
   free(self->saida);
+  free(self->txt_entrada);
+  free(self->txt_saida);
   free(self);
 }
 
+void terminal_define_pic(terminal_t *self, pic_t *pic)
+{
+  self->pic = pic;
+}
+
+void terminal_define_arquivo(terminal_t *self, FILE *arq)
+{
+  self->arq_saida = arq;
+}
+
+void terminal_define_rapido(terminal_t *self, bool rapido)
+{
+  self->rapido = rapido;
+}
+
 static bool terminal_entrada_vazia(terminal_t *self)
 {
-  return self->entrada[0] == '\0';
+  return self->n_entrada == 0;
 }
 
 static char terminal_le_char(terminal_t *self)
 {
-  char *p = self->entrada;
-  char ch = p[0];
-  if (ch != '\0') {
-    memmove(&p[0], &p[1], strlen(p));
-  }
+  if (self->n_entrada == 0) return '\0';
+  char ch = self->entrada[self->ini_entrada];
+  self->ini_entrada = (self->ini_entrada + 1) % self->cap_entrada;
+  self->n_entrada--;
+  self->alterado = true;
   return ch;
 }
 
 void terminal_insere_char(terminal_t *self, char ch)
 {
-  char *p = self->entrada;
-  int tam = strlen(p);
   // se não cabe, ignora silenciosamente
-  if (tam >= self->tam_linha-2) return;
-  p[tam] = ch;
-  p[tam+1] = '\0';
+  if (self->n_entrada >= self->cap_entrada) return;
+  int pos = (self->ini_entrada + self->n_entrada) % self->cap_entrada;
+  self->entrada[pos] = ch;
+  self->n_entrada++;
+  self->alterado = true;
+  if (self->pic != NULL) pic_levanta(self->pic, IRQ_TECLADO);
 }
 
 static bool terminal_pode_imprimir(terminal_t *self)
@@ -89,78 +139,119 @@ static bool terminal_pode_imprimir(terminal_t *self)
   return self->estado_saida == normal;
 }
 
+// chamada pelo controlador de interrupções quando a rolagem ou limpeza
+//   agendada em terminal_ocupa deve ter terminado
+static bool terminal_pronto(void *arg, int dado)
+{
+  return terminal_pode_imprimir(arg);
+}
+
+// coloca a saída no estado 'estado' até terminar a rolagem ou limpeza, que
+//   levam um tictac por caractere na linha, e agenda a interrupção para
+//   quando terminar
+static void terminal_ocupa(terminal_t *self, int estado)
+{
+  self->estado_saida = estado;
+  self->t_ocupado = self->n_saida > 0 ? self->n_saida : 1;
+  if (self->pic == NULL) return;
+  pic_agenda(self->pic, self->t_ocupado, IRQ_TELA, terminal_pronto, self, 0);
+}
+
+// remove n caracteres do início da saída
+static void terminal_remove_saida(terminal_t *self, int n)
+{
+  if (n > self->n_saida) n = self->n_saida;
+  self->ini_saida = (self->ini_saida + n) % self->cap_saida;
+  self->n_saida -= n;
+}
+
 static void terminal_imprime(terminal_t *self, char ch)
 {
   if (terminal_pode_imprimir(self)) {
+    if (self->arq_saida != NULL) fputc(ch, self->arq_saida);
+    self->alterado = true;
     if (ch == '\n') {
-      self->estado_saida = limpando;
+      if (self->rapido) {
+        terminal_remove_saida(self, self->n_saida);
+      } else {
+        terminal_ocupa(self, limpando);
+      }
       return;
     }
-    int tam = strlen(self->saida);
-    self->saida[tam] = ch;
-    tam++;
-    self->saida[tam] = '\0';
-    if (tam >= self->tam_linha - 1) {
-      self->estado_saida = rolando;
-      self->pos_rolagem = 0;
+    int pos = (self->ini_saida + self->n_saida) % self->cap_saida;
+    self->saida[pos] = ch;
+    self->n_saida++;
+    if (self->n_saida >= self->cap_saida) {
+      if (self->rapido) {
+        terminal_remove_saida(self, 1);
+      } else {
+        terminal_ocupa(self, rolando);
+      }
     }
   }
 }
 
 void terminal_limpa_saida(terminal_t *self)
 {
-  self->saida[0] = '\0';
+  self->n_saida = 0;
   self->estado_saida = normal;
+  self->t_ocupado = 0;
+  self->alterado = true;
 }
 
-static void terminal_atualiza_rolagem(terminal_t *self)
+// passa o tempo da rolagem ou limpeza
+void terminal_tictac_n(terminal_t *self, int n)
 {
-  // remove o caractere na posição de rolagem e avança
-  // se chegou no final da string, terminou a rolagem
-  char *p = self->saida;
-  p[self->pos_rolagem] = p[self->pos_rolagem + 1];
-  if (p[self->pos_rolagem] != '\0') {
-    self->pos_rolagem++;
-    p[self->pos_rolagem] = ' ';
-  } else {
+  // só há o que fazer enquanto a saída estiver rolando ou sendo limpa
+  if (self->estado_saida == normal) return;
+  if (n > self->t_ocupado) n = self->t_ocupado;
+  self->t_ocupado -= n;
+  if (self->estado_saida == limpando) {
+    terminal_remove_saida(self, n);
+    self->alterado = true;
+  }
+  if (self->t_ocupado == 0) {
+    if (self->estado_saida == rolando) {
+      terminal_remove_saida(self, 1);
+      self->alterado = true;
+    }
     self->estado_saida = normal;
   }
 }
 
-static void terminal_atualiza_limpeza(terminal_t *self)
+void terminal_tictac(terminal_t *self)
 {
-  // remove um caractere do início da string; volta ao estado normal se era o último
-  char *p = self->saida;
-  int tam = strlen(p);
-  memmove(p, p+1, tam);
-  if (tam <= 1) {
-    self->estado_saida = normal;
-  }
+  terminal_tictac_n(self, 1);
 }
 
-// altera a string de saída em 1 caractere, se estiver rolando ou limpando
-void terminal_tictac(terminal_t *self)
+// copia 'n' caracteres da fila circular 'buf' a partir de 'ini' para a string
+//   'txt'
+static char *copia_fila(char *txt, char *buf, int cap, int ini, int n)
 {
-  switch (self->estado_saida) {
-    case normal: 
-      break;
-    case rolando:
-      terminal_atualiza_rolagem(self);
-      break;
-    case limpando:
-      terminal_atualiza_limpeza(self);
-      break;
+  for (int i = 0; i < n; i++) {
+    txt[i] = buf[(ini + i) % cap];
   }
+  txt[n] = '\0';
+  return txt;
 }
 
 char *terminal_txt_entrada(terminal_t *self)
 {
-  return self->entrada;
+  return copia_fila(self->txt_entrada, self->entrada, self->cap_entrada,
+                    self->ini_entrada, self->n_entrada);
 }
 
 char *terminal_txt_saida(terminal_t *self)
 {
-  return self->saida;
+  return copia_fila(self->txt_saida, self->saida, self->cap_saida,
+                    self->ini_saida, self->n_saida);
+}
+
+bool terminal_foi_alterado(terminal_t *self)
+{
+  bool alterado = self->alterado;
+  self->alterado = false;
+  return alterado;
 }
 
 // Operações de leitura e escrita no terminal, chamadas pelo controlador de E/S
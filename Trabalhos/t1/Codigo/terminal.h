@@ -23,16 +23,24 @@
 // o número de caracteres na saída é limitado ao tamanho da linha. um caractere
 //   adicional causa a "rolagem", que remove o primeiro caractere da linha para
 //   gerar espaço para o novo. a impressão de um \n causa a "limpeza" da linha.
-// a escrita não é possível se a saída estiver rolando ou sendo limpa, o que é
-//   feito um caractere por vez (a cada chamada a tictac).
+// a escrita não é possível se a saída estiver rolando ou sendo limpa, o que
+//   leva uma chamada a tictac por caractere na linha.
+// um terminal "rápido" rola e limpa a linha na hora, e a escrita é sempre
+//   possível.
 //
 // a E/S efetiva é realizada pela console. ela obtém acesso às linhas de entrada e
 //   saída chamando terminal_txt_entrada ou terminal_txt_saida. a console insere
 //   caracteres digitados no terminal chamando terminal_insere_char, e limpa a
 //   linha de saída com terminal_limpa_saida.
+//
+// se estiver ligado a um controlador de interrupções, o terminal pede
+//   IRQ_TECLADO quando é digitado um caractere e IRQ_TELA quando a saída
+//   volta a aceitar caracteres depois de uma rolagem ou limpeza
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "es.h"
+#include "pic.h"
 
 typedef struct terminal_t terminal_t;
 
@@ -41,12 +49,28 @@ terminal_t *terminal_cria(int tam_linha);
 // libera a memória ocupada por um terminal
 void terminal_destroi(terminal_t *self);
 
+// liga o terminal ao controlador de interrupções
+void terminal_define_pic(terminal_t *self, pic_t *pic);
+
+// define um arquivo onde é copiado cada caractere escrito na saída
+//   (NULL para nenhum); usado quando não há tela para mostrar a saída
+void terminal_define_arquivo(terminal_t *self, FILE *arq);
+
+// liga ou desliga o modo rápido (sem a demora da rolagem e limpeza da saída)
+void terminal_define_rapido(terminal_t *self, bool rapido);
+
 // retorna a linha de entrada do terminal (para uso pela console)
 char *terminal_txt_entrada(terminal_t *self);
 
 // retorna a linha de saida do terminal (para uso pela console)
+// as linhas são mantidas em filas circulares, e estas duas funções montam uma
+//   cópia em forma de string, válida até a próxima chamada
 char *terminal_txt_saida(terminal_t *self);
 
+// retorna true se a linha de entrada ou de saída foi alterada desde a
+//   chamada anterior (para a console só redesenhar o que mudou)
+bool terminal_foi_alterado(terminal_t *self);
+
 // insere um novo caractere na entrada do terminal
 // (para uso pela console, para simular um caractere digitado no teclado)
 void terminal_insere_char(terminal_t *self, char ch);
@@ -57,6 +81,9 @@ void terminal_limpa_saida(terminal_t *self);
 // esta função deve ser chamada periodicamente
 void terminal_tictac(terminal_t *self);
 
+// equivale a n chamadas a terminal_tictac
+void terminal_tictac_n(terminal_t *self, int n);
+
 // Funções para implementar o protocolo de acesso a um dispositivo pelo
 //   controlador de E/S
 // Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h
@@ -0,0 +1,115 @@
+// bench_tabpag.c
+// compara as organizações de tabela de páginas (ver tabpag_tipo_t)
+// simulador de computador
+// so24b
+
+// para cada tipo de tabela, mapeia páginas de duas formas:
+//   densa: as páginas 0 a n-1, como um processo com o código e os dados
+//          contíguos a partir do endereço 0
+//   esparsa: n páginas sorteadas entre 0 e ESPACO_ESPARSO-1, como um
+//          processo com pedaços espalhados pelo espaço de endereçamento
+// e mede o tempo para mapear, o tempo por tradução (de páginas mapeadas,
+//   em ordem aleatória) e o espaço ocupado pela tabela no hospedeiro
+//
+// uso: bench_tabpag [n_paginas [n_traducoes]]
+
+#include "tabpag.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#define N_PAGINAS 10000
+#define N_TRADUCOES 10000000
+#define ESPACO_ESPARSO (1 << 20)
+
+// gerador de números pseudo-aleatórios próprio, para a sequência ser a
+//   mesma para todos os tipos de tabela
+static unsigned long long semente;
+
+static unsigned aleatorio(void)
+{
+  semente ^= semente << 13;
+  semente ^= semente >> 7;
+  semente ^= semente << 17;
+  return semente >> 32;
+}
+
+static double agora_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// preenche 'paginas' com 'n' páginas distintas, densas ou esparsas
+static void escolhe_paginas(int n, int paginas[n], bool esparsa)
+{
+  if (!esparsa) {
+    for (int i = 0; i < n; i++) paginas[i] = i;
+    return;
+  }
+  char *usada = calloc(ESPACO_ESPARSO, 1);
+  assert(usada != NULL);
+  for (int i = 0; i < n; i++) {
+    int pagina;
+    do {
+      pagina = aleatorio() % ESPACO_ESPARSO;
+    } while (usada[pagina]);
+    usada[pagina] = 1;
+    paginas[i] = pagina;
+  }
+  free(usada);
+}
+
+static void mede(tabpag_tipo_t tipo, bool esparsa, int n, int n_traducoes)
+{
+  int *paginas = malloc(n * sizeof(*paginas));
+  assert(paginas != NULL);
+  semente = 0x2545F4914F6CDD1Dull;
+  escolhe_paginas(n, paginas, esparsa);
+
+  tabpag_t *tab = tabpag_cria_tipo(tipo);
+  double t0 = agora_ns();
+  for (int i = 0; i < n; i++) {
+    tabpag_define_quadro(tab, paginas[i], i);
+  }
+  double t1 = agora_ns();
+  long soma = 0;
+  for (int i = 0; i < n_traducoes; i++) {
+    int quadro;
+    if (tabpag_traduz(tab, paginas[aleatorio() % n], &quadro) == ERR_OK) {
+      soma += quadro;
+    }
+  }
+  double t2 = agora_ns();
+  long bytes = tabpag_bytes(tab);
+  tabpag_destroi(tab);
+
+  // 'soma' é impressa para o laço de traduções não ser eliminado
+  printf("%-10s %-8s %10.1f %12.2f %12ld %8.1f  (%ld)\n",
+         tabpag_nome_do_tipo(tipo), esparsa ? "esparsa" : "densa",
+         (t1 - t0) / n, (t2 - t1) / n_traducoes, bytes, (double)bytes / n,
+         soma);
+  free(paginas);
+}
+
+int main(int argc, char *argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : N_PAGINAS;
+  int n_traducoes = argc > 2 ? atoi(argv[2]) : N_TRADUCOES;
+  if (n <= 0 || n > ESPACO_ESPARSO || n_traducoes <= 0) {
+    fprintf(stderr, "uso: %s [n_paginas [n_traducoes]]\n", argv[0]);
+    return 1;
+  }
+  printf("%d páginas, %d traduções\n", n, n_traducoes);
+  printf("%-10s %-8s %10s %12s %12s %8s\n", "tabela", "paginas",
+         "ns/mapeia", "ns/traducao", "bytes", "bytes/pag");
+  for (int esparsa = 0; esparsa < 2; esparsa++) {
+    for (tabpag_tipo_t tipo = 0; tipo < N_TABPAG_TIPOS; tipo++) {
+      mede(tipo, esparsa == 1, n, n_traducoes);
+    }
+  }
+  return 0;
+}
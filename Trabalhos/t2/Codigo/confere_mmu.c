@@ -0,0 +1,226 @@
+// confere_mmu.c
+// confere que a micro-TLB da CPU não altera o resultado da execução
+// simulador de computador
+// so24b
+
+// executa um programa de usuário com cada motor de execução, com algumas
+//   configurações da TLB, com a micro-TLB da CPU desligada e ligada
+// o programa executa em lotes de tamanhos variados, e entre os lotes faz-se
+//   o que faria um SO com memória virtual: os bits de acesso são observados
+//   e zerados, de tempos em tempos uma página é "gravada em disco" (o bit de
+//   alteração é zerado) e de tempos em tempos uma página muda de quadro
+// não tem SO: as interrupções (inclusive as chamadas de sistema) são
+//   tratadas com um RETI
+// com e sem micro-TLB, tem que ser igual: o estado da CPU, a memória, os bits
+//   de acesso e alteração observados entre os lotes, o tempo de espera e as
+//   estatísticas da TLB; sem custo nas faltas, o estado da CPU, a memória e
+//   os bits têm que ser iguais também para todos os motores (as consultas à
+//   TLB são diferentes em cada motor)
+//
+// uso: confere_mmu [programa.maq...]
+// termina com 0 se tudo conferir
+
+#include "cpu.h"
+#include "mmu.h"
+#include "memoria.h"
+#include "tabpag.h"
+#include "programa.h"
+#include "instrucao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static char *programas_padrao[] = { "p1.maq", "p2.maq", "p3.maq" };
+#define TAM_MEMORIA 2000
+#define TAM_PAGINA 8
+// o primeiro quadro usado pelo programa (os anteriores são do "SO")
+#define QUADRO_INICIAL 4
+#define N_LOTES 3000
+
+static char *nomes_motores[] = {
+  [motor_referencia] = "referencia",
+  [motor_predecodificado] = "predecod",
+  [motor_blocos] = "blocos",
+  [motor_jit] = "jit",
+};
+#define N_MOTORES (sizeof(nomes_motores) / sizeof(nomes_motores[0]))
+
+static mmu_config_tlb_t configs[] = {
+  { .entradas = 0, .vias = 1 },
+  { .entradas = 8, .vias = 2, .politica = tlb_lru, .usa_asid = true,
+    .custo_falta = 0 },
+  { .entradas = 8, .vias = 2, .politica = tlb_fifo, .usa_asid = false,
+    .custo_falta = 3 },
+};
+#define N_CONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+// o que é comparado entre as execuções
+typedef struct {
+  char cpu[100];
+  unsigned memoria;
+  unsigned bits;
+  long instrucoes;
+  long espera;
+  mmu_estat_tlb_t tlb;
+} resultado_t;
+
+static unsigned mistura(unsigned h, int v)
+{
+  return (h ^ (unsigned)v) * 16777619u;
+}
+
+static resultado_t executa(programa_t *prog, cpu_motor_t motor,
+                           mmu_config_tlb_t config, bool micro_tlb)
+{
+  mem_t *mem = mem_cria(TAM_MEMORIA);
+  mem_preenche(mem, 0, TAM_MEMORIA, 0);
+  mmu_t *mmu = mmu_cria(mem, TAM_PAGINA);
+  mmu_configura_tlb(mmu, config);
+  es_t *es = es_cria();
+  cpu_t *cpu = cpu_cria(mmu, es);
+  cpu_define_motor(cpu, motor);
+  cpu_define_micro_tlb(cpu, micro_tlb);
+
+  // carrega o programa em quadros a partir de QUADRO_INICIAL
+  int carga = prog_end_carga(prog);
+  int pag_ini = carga / TAM_PAGINA;
+  int pag_fim = (carga + prog_tamanho(prog) - 1) / TAM_PAGINA;
+  tabpag_t *tab = tabpag_cria();
+  for (int pag = pag_ini; pag <= pag_fim; pag++) {
+    tabpag_define_quadro(tab, pag, QUADRO_INICIAL + pag - pag_ini);
+  }
+  for (int i = 0; i < prog_tamanho(prog); i++) {
+    int end = (QUADRO_INICIAL - pag_ini) * TAM_PAGINA + carga + i;
+    mem_escreve(mem, end, prog_dado(prog, carga + i));
+  }
+  int quadro_livre = QUADRO_INICIAL + pag_fim - pag_ini + 1;
+  mmu_define_tabpag(mmu, tab);
+
+  // a CPU está no tratador da interrupção de reset, que retorna para o
+  //   início do programa
+  mem_escreve(mem, IRQ_END_PC, prog_end_inicio(prog));
+  mem_escreve(mem, IRQ_END_modo, usuario);
+  mem_escreve(mem, IRQ_END_TRATADOR, RETI);
+
+  resultado_t r = { .bits = 2166136261u };
+  for (int lote = 0; lote < N_LOTES; lote++) {
+    cpu_parada_t motivo;
+    int espera;
+    r.instrucoes += cpu_executa_n(cpu, 1 + lote * 7 % 53, &motivo, &espera);
+    r.espera += espera;
+    for (int pag = pag_ini; pag <= pag_fim; pag++) {
+      r.bits = mistura(r.bits, tabpag_bit_acesso(tab, pag) * 2
+                               + tabpag_bit_alteracao(tab, pag));
+      if (lote % 3 == 0) tabpag_zera_bit_acesso(tab, pag);
+    }
+    if (lote % 2 == 0) {
+      // grava as páginas: define o mesmo quadro, o que zera os bits
+      for (int pag = pag_ini; pag <= pag_fim; pag++) {
+        int quadro;
+        assert(tabpag_traduz(tab, pag, &quadro) == ERR_OK);
+        tabpag_define_quadro(tab, pag, quadro);
+      }
+    }
+    if (lote % 50 == 0) {
+      // muda uma página de quadro
+      int pag = pag_ini + lote / 50 % (pag_fim - pag_ini + 1);
+      int quadro;
+      assert(tabpag_traduz(tab, pag, &quadro) == ERR_OK);
+      mem_copia(mem, quadro_livre * TAM_PAGINA, quadro * TAM_PAGINA,
+                TAM_PAGINA);
+      tabpag_define_quadro(tab, pag, quadro_livre);
+      mmu_invalida_pagina(mmu, pag);
+      quadro_livre++;
+      if ((quadro_livre + 1) * TAM_PAGINA > TAM_MEMORIA) {
+        quadro_livre = QUADRO_INICIAL + pag_fim - pag_ini + 1;
+      }
+    }
+  }
+
+  cpu_concatena_descricao(cpu, r.cpu);
+  r.memoria = 2166136261u;
+  for (int end = 0; end < TAM_MEMORIA; end++) {
+    int valor;
+    mem_le(mem, end, &valor);
+    r.memoria = mistura(r.memoria, valor);
+  }
+  r.tlb = mmu_estat_tlb(mmu);
+
+  cpu_destroi(cpu);
+  es_destroi(es);
+  mmu_destroi(mmu);
+  tabpag_destroi(tab);
+  mem_destroi(mem);
+  return r;
+}
+
+// retorna true se a execução teve o mesmo efeito visível (sem contar tempo
+//   de espera e TLB)
+static bool mesmo_efeito(resultado_t *a, resultado_t *b)
+{
+  return strcmp(a->cpu, b->cpu) == 0 && a->memoria == b->memoria
+         && a->bits == b->bits && a->instrucoes == b->instrucoes;
+}
+
+static bool mesma_tlb(resultado_t *a, resultado_t *b)
+{
+  return a->espera == b->espera && a->tlb.acertos == b->tlb.acertos
+         && a->tlb.faltas == b->tlb.faltas;
+}
+
+// executa o programa em todas as combinações; retorna o número de diferenças
+static int confere(char *nome)
+{
+  programa_t *prog = prog_cria(nome);
+  if (prog == NULL) {
+    fprintf(stderr, "Erro na leitura de '%s'\n", nome);
+    return 1;
+  }
+  int erros = 0;
+  printf("%s\n", nome);
+  printf("%-10s %-3s %-5s %8s %8s %8s %8s %8s %8s  %s\n", "motor", "tlb",
+         "micro", "instr", "espera", "acertos", "faltas", "memoria", "bits",
+         "cpu");
+  for (int c = 0; c < N_CONFIGS; c++) {
+    resultado_t primeiro;
+    for (cpu_motor_t motor = 0; motor < N_MOTORES; motor++) {
+      resultado_t r[2];
+      for (int micro = 0; micro < 2; micro++) {
+        r[micro] = executa(prog, motor, configs[c], micro == 1);
+        printf("%-10s %-3d %-5s %8ld %8ld %8ld %8ld %08x %08x  %s\n",
+               nomes_motores[motor], c, micro ? "sim" : "nao",
+               r[micro].instrucoes, r[micro].espera, r[micro].tlb.acertos,
+               r[micro].tlb.faltas, r[micro].memoria, r[micro].bits,
+               r[micro].cpu);
+      }
+      if (!mesmo_efeito(&r[0], &r[1]) || !mesma_tlb(&r[0], &r[1])) {
+        printf("DIFERENTE: com e sem micro-TLB\n");
+        erros++;
+      }
+      if (motor == 0) {
+        primeiro = r[0];
+      } else if (configs[c].custo_falta == 0
+                 && !mesmo_efeito(&primeiro, &r[0])) {
+        printf("DIFERENTE: motor %s\n", nomes_motores[motor]);
+        erros++;
+      }
+    }
+  }
+  prog_destroi(prog);
+  return erros;
+}
+
+int main(int argc, char *argv[])
+{
+  int erros = 0;
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) erros += confere(argv[i]);
+  } else {
+    int n = sizeof(programas_padrao) / sizeof(programas_padrao[0]);
+    for (int i = 0; i < n; i++) erros += confere(programas_padrao[i]);
+  }
+  printf("%s\n", erros == 0 ? "ok" : "ERRO");
+  return erros == 0 ? 0 : 1;
+}
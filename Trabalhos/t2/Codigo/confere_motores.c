@@ -0,0 +1,196 @@
+// confere_motores.c
+// confere que os motores de execução da CPU têm o mesmo comportamento
+// simulador de computador
+// so24b
+
+// executa um programa de usuário com cada motor de execução (ver
+//   cpu_motor_t), com a TLB desligada e ligada, em lotes de tamanhos
+//   variados, como os que o controle faz para chegar ao próximo evento do
+//   relógio, até o programa causar um erro (p1 termina com PARA em modo
+//   usuário, que é privilegiada)
+// não tem SO: as interrupções (inclusive as chamadas de sistema) são
+//   tratadas com um RETI
+// para todos os motores, tem que ser igual: o estado da CPU, a memória e, em
+//   cada lote, o número de instruções executadas, o tempo de espera e o
+//   motivo da parada (o relógio avança o mesmo e as interrupções acontecem
+//   entre as mesmas instruções)
+// a execução é repetida para medir o tempo de cada motor
+//
+// uso: confere_motores [programa.maq [repetições]]
+// termina com 0 se tudo conferir
+
+#include "cpu.h"
+#include "mmu.h"
+#include "memoria.h"
+#include "tabpag.h"
+#include "programa.h"
+#include "instrucao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#define PROGRAMA "p1.maq"
+#define REPETICOES 100
+#define TAM_MEMORIA 2000
+#define TAM_PAGINA 16
+// o primeiro quadro usado pelo programa (os anteriores são do "SO")
+#define QUADRO_INICIAL 2
+// para não executar para sempre um programa que não causa erro
+#define MAX_LOTES 1000000
+
+static char *nomes_motores[] = {
+  [motor_referencia] = "referencia",
+  [motor_predecodificado] = "predecod",
+  [motor_blocos] = "blocos",
+  [motor_jit] = "jit",
+};
+#define N_MOTORES (sizeof(nomes_motores) / sizeof(nomes_motores[0]))
+
+static mmu_config_tlb_t configs[] = {
+  { .entradas = 0, .vias = 1 },
+  { .entradas = 16, .vias = 4, .politica = tlb_lru, .usa_asid = true,
+    .custo_falta = 0 },
+};
+#define N_CONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+// o que é comparado entre os motores
+typedef struct {
+  char cpu[100];
+  unsigned memoria;
+  // resumo do número de instruções, espera e motivo de cada lote
+  unsigned lotes;
+  int n_lotes;
+  long instrucoes;
+  long tempo;
+  // tempo no hospedeiro gasto na execução, em ns
+  double ns;
+} resultado_t;
+
+static unsigned mistura(unsigned h, int v)
+{
+  return (h ^ (unsigned)v) * 16777619u;
+}
+
+static double agora_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static resultado_t executa(programa_t *prog, cpu_motor_t motor,
+                           mmu_config_tlb_t config)
+{
+  mem_t *mem = mem_cria(TAM_MEMORIA);
+  mem_preenche(mem, 0, TAM_MEMORIA, 0);
+  mmu_t *mmu = mmu_cria(mem, TAM_PAGINA);
+  mmu_configura_tlb(mmu, config);
+  es_t *es = es_cria();
+  cpu_t *cpu = cpu_cria(mmu, es);
+  cpu_define_motor(cpu, motor);
+
+  // carrega o programa em quadros a partir de QUADRO_INICIAL
+  int carga = prog_end_carga(prog);
+  int pag_ini = carga / TAM_PAGINA;
+  int pag_fim = (carga + prog_tamanho(prog) - 1) / TAM_PAGINA;
+  tabpag_t *tab = tabpag_cria();
+  for (int pag = pag_ini; pag <= pag_fim; pag++) {
+    tabpag_define_quadro(tab, pag, QUADRO_INICIAL + pag - pag_ini);
+  }
+  for (int i = 0; i < prog_tamanho(prog); i++) {
+    int end = (QUADRO_INICIAL - pag_ini) * TAM_PAGINA + carga + i;
+    mem_escreve(mem, end, prog_dado(prog, carga + i));
+  }
+  mmu_define_tabpag(mmu, tab);
+
+  // a CPU está no tratador da interrupção de reset, que retorna para o
+  //   início do programa
+  mem_escreve(mem, IRQ_END_PC, prog_end_inicio(prog));
+  mem_escreve(mem, IRQ_END_modo, usuario);
+  mem_escreve(mem, IRQ_END_TRATADOR, RETI);
+
+  resultado_t r = { .lotes = 2166136261u };
+  double t0 = agora_ns();
+  for (r.n_lotes = 0; r.n_lotes < MAX_LOTES; r.n_lotes++) {
+    cpu_parada_t motivo;
+    int espera;
+    int n = cpu_executa_n(cpu, 1 + r.n_lotes * 37 % 200, &motivo, &espera);
+    r.instrucoes += n;
+    r.tempo += n + espera;
+    r.lotes = mistura(mistura(mistura(r.lotes, n), espera), motivo);
+    int erro;
+    mem_le(mem, IRQ_END_erro, &erro);
+    if (motivo == parada_interrupcao && erro != ERR_OK) break;
+  }
+  r.ns = agora_ns() - t0;
+
+  cpu_concatena_descricao(cpu, r.cpu);
+  r.memoria = 2166136261u;
+  for (int end = 0; end < TAM_MEMORIA; end++) {
+    int valor;
+    mem_le(mem, end, &valor);
+    r.memoria = mistura(r.memoria, valor);
+  }
+
+  cpu_destroi(cpu);
+  es_destroi(es);
+  mmu_destroi(mmu);
+  tabpag_destroi(tab);
+  mem_destroi(mem);
+  return r;
+}
+
+static bool mesmo_resultado(resultado_t *a, resultado_t *b)
+{
+  return strcmp(a->cpu, b->cpu) == 0 && a->memoria == b->memoria
+         && a->lotes == b->lotes && a->n_lotes == b->n_lotes
+         && a->instrucoes == b->instrucoes && a->tempo == b->tempo;
+}
+
+int main(int argc, char *argv[])
+{
+  char *nome = argc > 1 ? argv[1] : PROGRAMA;
+  int repeticoes = argc > 2 ? atoi(argv[2]) : REPETICOES;
+  programa_t *prog = prog_cria(nome);
+  if (prog == NULL || repeticoes <= 0) {
+    fprintf(stderr, "uso: %s [programa.maq [repetições]]\n", argv[0]);
+    return 1;
+  }
+  int erros = 0;
+  printf("%s, %d repetições\n", nome, repeticoes);
+  printf("%-10s %-3s %8s %8s %8s %8s %8s %10s %6s  %s\n", "motor", "tlb",
+         "lotes", "instr", "tempo", "resumo", "memoria", "ns/instr",
+         "acel", "cpu");
+  for (int c = 0; c < N_CONFIGS; c++) {
+    resultado_t ref;
+    double ns_ref = 0;
+    for (cpu_motor_t motor = 0; motor < N_MOTORES; motor++) {
+      resultado_t r = executa(prog, motor, configs[c]);
+      double ns = 0;
+      for (int i = 0; i < repeticoes; i++) {
+        resultado_t ri = executa(prog, motor, configs[c]);
+        assert(mesmo_resultado(&r, &ri));
+        ns += ri.ns;
+      }
+      ns /= (double)repeticoes * r.instrucoes;
+      if (motor == motor_referencia) {
+        ref = r;
+        ns_ref = ns;
+      }
+      printf("%-10s %-3d %8d %8ld %8ld %08x %08x %10.2f %6.1f  %s\n",
+             nomes_motores[motor], configs[c].entradas, r.n_lotes,
+             r.instrucoes, r.tempo, r.lotes, r.memoria, ns, ns_ref / ns,
+             r.cpu);
+      if (!mesmo_resultado(&ref, &r)) {
+        printf("DIFERENTE: motor %s\n", nomes_motores[motor]);
+        erros++;
+      }
+    }
+  }
+  prog_destroi(prog);
+  printf("%s\n", erros == 0 ? "ok" : "ERRO");
+  return erros == 0 ? 0 : 1;
+}
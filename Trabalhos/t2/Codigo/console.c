@@ -8,13 +8,18 @@
 #include "console.h"
 #include "terminal.h"
 #include "tela.h"
+#include "log.h"
 
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 
 // CONSTANTES {{{1
 
@@ -36,68 +41,265 @@
 #define LINHA_CONSOLE (LINHA_STATUS + N_LIN_STATUS)
 #define LINHA_ENTRADA (LINHA_CONSOLE + N_LIN_CONSOLE)
 
-// números de comandos para o controlador que podem ser guardados na console
-#define N_CMD_EXT 10
+// número máximo de vezes por segundo (de tempo real) que a tela é redesenhada
+#define QUADROS_POR_S 30
+
+// número de mensagens em cada fila entre a simulação e a tela
+#define TAM_FILA 256
+
+// tempo de espera da simulação quando está parada (ms)
+#define ESPERA_PARADO 5
 
 // DECLARAÇÃO {{{1
 
+// a tela é desenhada e o teclado é lido por uma thread própria, para que a
+//   simulação nunca espere por eles. As duas threads se comunicam por filas
+//   circulares com um só produtor e um só consumidor, sem travas:
+//   - a simulação manda para a tela as linhas impressas na console, a linha de
+//     status e as linhas dos terminais que mudaram;
+//   - a tela manda para a simulação o que o operador digitou para os terminais;
+//   - os comandos externos chegam à simulação como bits em uma variável
+//     atômica; o argumento do comando 'B' vai em outra, escrita antes do bit;
+//   - o pedido de métricas (comando 'M') é para o SO, e não passa pelo
+//     controlador: fica em uma variável atômica própria.
+// os terminais pertencem à simulação; a tela só conhece cópias das suas linhas
+
+typedef enum {
+  // da simulação para a tela
+  msg_console,  // linha impressa na console
+  msg_status,   // nova linha de status
+  msg_entrada,  // nova linha de entrada de um terminal
+  msg_saida,    // nova linha de saída de um terminal
+  // da tela para a simulação
+  msg_digita,   // string digitada pelo operador para um terminal
+  msg_limpa,    // esvaziamento da saída de um terminal
+} tipo_msg_t;
+
+typedef struct {
+  tipo_msg_t tipo;
+  int terminal;
+  char txt[N_COL+1];
+} mensagem_t;
+
+typedef struct {
+  mensagem_t msg[TAM_FILA];
+  // posição da próxima mensagem a retirar (só alterada pelo consumidor) e da
+  //   próxima a inserir (só alterada pelo produtor); a fila está vazia
+  //   quando são iguais
+  atomic_int ini;
+  atomic_int fim;
+} fila_t;
+
+// bits dos comandos externos
+#define CMD_F 1u
+#define CMD_P 2u
+#define CMD_1 4u
+#define CMD_C 8u
+#define CMD_B 16u
+
 struct console_t {
+  // não mudam depois da criação; usados pelas duas threads
   terminal_t *term[N_TERM];
-  int cor_txt[N_TERM];
-  int cor_cursor[N_TERM];
-  char txt_status[N_COL+1];
-  char txt_console[N_LIN_CONSOLE][N_COL+1];
-  char txt_entrada[N_COL+1];
-  char fila_de_comandos_externos[N_CMD_EXT];
-  FILE *arquivo_de_log;
+  // se a console está sem tela; nesse caso, não tem a thread da tela, e a
+  //   saída de cada terminal vai para um arquivo
+  bool sem_tela;
+  FILE *arquivo_terminal[N_TERM];
+
+  // comunicação entre as threads
+  fila_t para_tela;
+  fila_t para_simulacao;
+  atomic_uint comandos_externos;
+  // endereço do último comando 'B' (-1 para remover o breakpoint)
+  atomic_int breakpoint;
+  // se o operador pediu as métricas e o SO ainda não viu o pedido
+  atomic_bool pede_metricas;
+  atomic_bool terminar;
+  pthread_t thread_tela;
+
+  // usados só pela thread da simulação
+  struct {
+    // comandos já retirados de comandos_externos e ainda não entregues
+    unsigned comandos;
+    char txt_status[N_COL+1];
+    // o que ainda não foi mandado para a tela
+    bool status_alterado;
+    bool terminal_alterado[N_TERM];
+    // quando o estado foi mandado para a tela pela última vez (ms)
+    long ultimo_envio;
+  } sim;
+
+  // usados só pela thread da tela
+  struct {
+    int cor_txt[N_TERM];
+    int cor_cursor[N_TERM];
+    char txt_terminal[N_TERM][2][N_COL+1];
+    char txt_status[N_COL+1];
+    // linhas da console, em um vetor circular que começa na mais antiga
+    char txt_console[N_LIN_CONSOLE][N_COL+1];
+    int ini_console;
+    char txt_entrada[N_COL+1];
+    // partes da tela que foram alteradas desde o último desenho
+    bool terminal_alterado[N_TERM];
+    bool status_alterado;
+    bool console_alterada;
+    bool entrada_alterada;
+    // quando a tela foi desenhada pela última vez (ms de tempo real)
+    long ultimo_quadro;
+  } tela;
 };
 
+// se a thread que está executando é a da tela
+static _Thread_local bool na_thread_da_tela = false;
+
+// FILAS {{{1
+
+static void fila_inicializa(fila_t *fila)
+{
+  atomic_init(&fila->ini, 0);
+  atomic_init(&fila->fim, 0);
+}
+
+// insere uma mensagem na fila (só pelo produtor); retorna false se cheia
+static bool fila_insere(fila_t *fila, mensagem_t *msg)
+{
+  int fim = atomic_load_explicit(&fila->fim, memory_order_relaxed);
+  int prox = (fim + 1) % TAM_FILA;
+  if (prox == atomic_load_explicit(&fila->ini, memory_order_acquire)) {
+    return false;
+  }
+  fila->msg[fim] = *msg;
+  atomic_store_explicit(&fila->fim, prox, memory_order_release);
+  return true;
+}
+
+// retira uma mensagem da fila (só pelo consumidor); retorna false se vazia
+static bool fila_remove(fila_t *fila, mensagem_t *msg)
+{
+  int ini = atomic_load_explicit(&fila->ini, memory_order_relaxed);
+  if (ini == atomic_load_explicit(&fila->fim, memory_order_acquire)) {
+    return false;
+  }
+  *msg = fila->msg[ini];
+  atomic_store_explicit(&fila->ini, (ini + 1) % TAM_FILA, memory_order_release);
+  return true;
+}
+
+static bool envia(fila_t *fila, tipo_msg_t tipo, int terminal, char *txt)
+{
+  mensagem_t msg = { .tipo = tipo, .terminal = terminal };
+  strncpy(msg.txt, txt, N_COL);
+  msg.txt[N_COL] = '\0';
+  return fila_insere(fila, &msg);
+}
+
+// retorna o tempo real, em ms, contado de um instante qualquer
+static long tempo_real(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 // CRIAÇÃO {{{1
 
+static void *laco_da_tela(void *arg);
+static void eco_na_console(char *txt);
+
 static console_t *console_global; // gambiarra para simplificar o uso de prints na console
-console_t *console_cria(void)
+static console_t *console_cria_comum(bool sem_tela)
 {
   console_t *self = malloc(sizeof(*self));
   assert(self != NULL);
   console_global = self;
+  self->sem_tela = sem_tela;
 
   for (int t = 0; t < N_TERM; t++) {
     self->term[t] = terminal_cria(N_COL);
     if ((t % 2) == 0) {
-      self->cor_txt[t] = COR_TXT_PAR;
-      self->cor_cursor[t] = COR_CURSOR_PAR;
+      self->tela.cor_txt[t] = COR_TXT_PAR;
+      self->tela.cor_cursor[t] = COR_CURSOR_PAR;
     } else {
-      self->cor_txt[t] = COR_TXT_IMPAR;
-      self->cor_cursor[t] = COR_CURSOR_IMPAR;
+      self->tela.cor_txt[t] = COR_TXT_IMPAR;
+      self->tela.cor_cursor[t] = COR_CURSOR_IMPAR;
     }
+    strcpy(self->tela.txt_terminal[t][0], "");
+    strcpy(self->tela.txt_terminal[t][1], "");
+    self->tela.terminal_alterado[t] = true;
+    self->sim.terminal_alterado[t] = false;
   }
   for (int l = 0; l < N_LIN_CONSOLE; l++) {
-    strcpy(self->txt_console[l], "");
+    strcpy(self->tela.txt_console[l], "");
   }
-  strcpy(self->txt_entrada, "");
-  self->fila_de_comandos_externos[0] = '\0';
-  self->arquivo_de_log = fopen("log_da_console", "w");
+  self->tela.ini_console = 0;
+  strcpy(self->tela.txt_entrada, "");
+  strcpy(self->tela.txt_status, "");
+  strcpy(self->sim.txt_status, "");
+  self->sim.comandos = 0;
+  self->sim.status_alterado = false;
+  self->sim.ultimo_envio = 0;
+  self->tela.status_alterado = true;
+  self->tela.console_alterada = true;
+  self->tela.entrada_alterada = true;
+  self->tela.ultimo_quadro = 0;
+  fila_inicializa(&self->para_tela);
+  fila_inicializa(&self->para_simulacao);
+  atomic_init(&self->comandos_externos, 0);
+  atomic_init(&self->breakpoint, -1);
+  atomic_init(&self->pede_metricas, false);
+  atomic_init(&self->terminar, false);
+  // o que é impresso na console também vai para o log, gravado por outra
+  //   thread; os avisos e erros registrados com LOG aparecem na console
+  log_inicia("log_da_console");
+  log_define_eco(eco_na_console, log_aviso);
 
-  tela_init();
+  for (int t = 0; t < N_TERM; t++) {
+    self->arquivo_terminal[t] = NULL;
+    if (sem_tela) {
+      char nome[20];
+      sprintf(nome, "terminal_%c", 'A' + t);
+      self->arquivo_terminal[t] = fopen(nome, "w");
+      terminal_define_arquivo(self->term[t], self->arquivo_terminal[t]);
+    }
+  }
+
+  if (!sem_tela) {
+    int r = pthread_create(&self->thread_tela, NULL, laco_da_tela, self);
+    assert(r == 0);
+  }
 
   return self;
 }
 
-static void console_desenha(console_t *self);
+console_t *console_cria(void)
+{
+  return console_cria_comum(false);
+}
+
+console_t *console_cria_sem_tela(void)
+{
+  return console_cria_comum(true);
+}
+
+static void envia_estado(console_t *self);
 
 void console_destroi(console_t *self)
 {
-  console_desenha(self);
-  if (self->arquivo_de_log != NULL) fclose(self->arquivo_de_log);
-  tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
-  tela_atualiza();
-  while (tela_tecla() != '\n') {
-    ;
+  if (!self->sem_tela) {
+    // manda o estado final e espera a thread da tela terminar (ela espera o
+    //   operador digitar ENTER)
+    for (int t = 0; t < N_TERM; t++) {
+      self->sim.terminal_alterado[t] = true;
+    }
+    envia_estado(self);
+    atomic_store(&self->terminar, true);
+    pthread_join(self->thread_tela, NULL);
   }
-  tela_fim();
+  log_define_eco(NULL, log_erro);
+  log_termina();
 
   for (int t = 0; t < N_TERM; t++) {
     terminal_destroi(self->term[t]);
+    if (self->arquivo_terminal[t] != NULL) fclose(self->arquivo_terminal[t]);
   }
   free(self);
   return;
@@ -112,21 +314,17 @@ terminal_t *console_terminal(console_t *self, char id_terminal)
   return self->term[num_terminal];
 }
 
-static void atualiza_terminais(console_t *self)
+static void atualiza_terminais(console_t *self, int n)
 {
   for (int t = 0; t < N_TERM; t++) {
-    terminal_tictac(self->term[t]);
+    terminal_tictac_n(self->term[t], n);
   }
 }
 
-static void insere_string_no_terminal(console_t *self, char id_terminal, char *str)
+static void insere_string_no_terminal(console_t *self, int num_terminal, char *str)
 {
   // insere caracteres no terminal (e espaço no final)
-  terminal_t *terminal = console_terminal(self, id_terminal);
-  if (terminal == NULL) {
-    console_printf("Terminal '%c' inválido\n", id_terminal);
-    return;
-  }
+  terminal_t *terminal = self->term[num_terminal];
   char *p = str;
   while (*p != '\0') {
     terminal_insere_char(terminal, *p);
@@ -135,29 +333,52 @@ static void insere_string_no_terminal(console_t *self, char id_terminal, char *s
   terminal_insere_char(terminal, ' ');
 }
 
-static void limpa_saida_do_terminal(console_t *self, char id_terminal)
+// executa nos terminais o que o operador digitou para eles (na thread da
+//   simulação)
+static void recebe_da_tela(console_t *self)
 {
-  terminal_t *terminal = console_terminal(self, id_terminal);
-  if (terminal == NULL) {
-    console_printf("Terminal '%c' inválido\n", id_terminal);
-    return;
+  mensagem_t msg;
+  while (fila_remove(&self->para_simulacao, &msg)) {
+    switch (msg.tipo) {
+      case msg_digita:
+        insere_string_no_terminal(self, msg.terminal, msg.txt);
+        break;
+      case msg_limpa:
+        terminal_limpa_saida(self->term[msg.terminal]);
+        break;
+      default:
+        break;
+    }
   }
-  terminal_limpa_saida(terminal);
 }
 
 // SAÍDA {{{1
 
+// insere uma linha na cópia da console da thread da tela
+// a linha nova ocupa o lugar da mais antiga, sem mover as outras
+static void rola_console(console_t *self, char *s)
+{
+  char *linha = self->tela.txt_console[self->tela.ini_console];
+  strncpy(linha, s, N_COL);
+  linha[N_COL] = '\0'; // quem definiu strncpy é estúpido!
+  self->tela.ini_console = (self->tela.ini_console + 1) % N_LIN_CONSOLE;
+  self->tela.console_alterada = true;
+}
+
 static void insere_string_na_console(console_t *self, char *s)
 {
-  for(int l=0; l<N_LIN_CONSOLE-1; l++) {
-    strncpy(self->txt_console[l], self->txt_console[l+1], N_COL);
-    self->txt_console[l][N_COL] = '\0'; // quem definiu strncpy é estúpido!
+  if (self->sem_tela) {
+    printf("%s\n", s);
+    return;
   }
-  strncpy(self->txt_console[N_LIN_CONSOLE-1], s, N_COL);
-  self->txt_console[N_LIN_CONSOLE-1][N_COL] = '\0'; // grrrr
-  if (self->arquivo_de_log != NULL) {
-    fprintf(self->arquivo_de_log, "%s\n", s);
+  if (!na_thread_da_tela) {
+    // a linha não pode ser perdida; espera a tela abrir espaço na fila
+    while (!envia(&self->para_tela, msg_console, 0, s)) {
+      sched_yield();
+    }
+    return;
   }
+  rola_console(self, s);
 }
 
 static void insere_strings_na_console(console_t *self, char *s)
@@ -178,7 +399,12 @@ static void insere_strings_na_console(console_t *self, char *s)
 void console_print_status(console_t *self, char *txt)
 {
   // imprime alinhado a esquerda ("-"), max N_COL chars ("*")
-  sprintf(self->txt_status, "%-*s", N_COL, txt);
+  char novo[N_COL+1];
+  snprintf(novo, sizeof(novo), "%-*s", N_COL, txt);
+  if (strcmp(novo, self->sim.txt_status) != 0) {
+    strcpy(self->sim.txt_status, novo);
+    self->sim.status_alterado = true;
+  }
 }
 
 int console_printf(char *formato, ...)
@@ -187,33 +413,92 @@ int console_printf(char *formato, ...)
   // Se não sabe como é isso, dá uma olhada em:
   // https://www.geeksforgeeks.org/variadic-functions-in-c/
   console_t *self = console_global; // gambiarra para simplificar o uso de prints na console
-  char s[sizeof(self->txt_console)];
+  char s[sizeof(self->tela.txt_console)];
   va_list arg;
   va_start(arg, formato);
   int r = vsnprintf(s, sizeof(s), formato, arg);
+  va_end(arg);
+  log_grava(log_info, log_console, s);
   insere_strings_na_console(self, s);
   return r;
 }
 
+// recebe do log as mensagens que devem aparecer na console
+static void eco_na_console(char *txt)
+{
+  insere_strings_na_console(console_global, txt);
+}
+
+// manda para a tela o que mudou desde o último envio (na thread da simulação)
+// o que não couber nas filas fica para o próximo envio
+static void envia_estado(console_t *self)
+{
+  for (int t = 0; t < N_TERM; t++) {
+    terminal_t *terminal = self->term[t];
+    if (terminal_foi_alterado(terminal)) self->sim.terminal_alterado[t] = true;
+    if (!self->sim.terminal_alterado[t]) continue;
+    if (envia(&self->para_tela, msg_entrada, t, terminal_txt_entrada(terminal))
+        && envia(&self->para_tela, msg_saida, t, terminal_txt_saida(terminal))) {
+      self->sim.terminal_alterado[t] = false;
+    }
+  }
+  if (self->sim.status_alterado
+      && envia(&self->para_tela, msg_status, 0, self->sim.txt_status)) {
+    self->sim.status_alterado = false;
+  }
+}
+
 // ENTRADA {{{1
 
 static void insere_comando_externo(console_t *self, char c)
 {
-  int n_cmd = strlen(self->fila_de_comandos_externos);
-  if (n_cmd < N_CMD_EXT - 2) {
-    self->fila_de_comandos_externos[n_cmd] = c;
-    self->fila_de_comandos_externos[n_cmd+1] = '\0';
+  unsigned bit;
+  switch (c) {
+    case 'F': bit = CMD_F; break;
+    case 'P': bit = CMD_P; break;
+    case '1': bit = CMD_1; break;
+    case 'B': bit = CMD_B; break;
+    default:  bit = CMD_C; break;
   }
+  atomic_fetch_or(&self->comandos_externos, bit);
 }
 
 static char remove_comando_externo(console_t *self)
 {
-  char *p = self->fila_de_comandos_externos;
-  char cmd = *p;
-  if (cmd != '\0') {
-    memmove(p, p+1, strlen(p));
+  // só acessa a variável compartilhada quando os comandos já recebidos
+  //   acabarem; o custo é uma leitura atômica por lote de instruções
+  if (self->sim.comandos == 0) {
+    if (atomic_load_explicit(&self->comandos_externos, memory_order_relaxed) == 0) {
+      return '\0';
+    }
+    self->sim.comandos = atomic_exchange(&self->comandos_externos, 0);
+  }
+  // entrega um por vez; se chegaram vários juntos, o fim tem preferência
+  static const struct { unsigned bit; char cmd; } ordem[] = {
+    { CMD_F, 'F' }, { CMD_P, 'P' }, { CMD_1, '1' }, { CMD_C, 'C' },
+    { CMD_B, 'B' },
+  };
+  for (int i = 0; i < sizeof(ordem) / sizeof(ordem[0]); i++) {
+    if (self->sim.comandos & ordem[i].bit) {
+      self->sim.comandos &= ~ordem[i].bit;
+      return ordem[i].cmd;
+    }
+  }
+  return '\0';
+}
+
+// manda para a simulação uma mensagem para o terminal 'id_terminal'
+static void envia_para_terminal(console_t *self, tipo_msg_t tipo,
+                                char id_terminal, char *str)
+{
+  int num_terminal = tolower(id_terminal) - 'a';
+  if (num_terminal < 0 || num_terminal >= N_TERM) {
+    console_printf("Terminal '%c' inválido\n", id_terminal);
+    return;
+  }
+  if (!envia(&self->para_simulacao, tipo, num_terminal, str)) {
+    console_printf("Simulação ocupada, repita o comando\n");
   }
-  return cmd;
 }
 
 static void interpreta_linha_entrada(console_t *self)
@@ -227,22 +512,32 @@ static void interpreta_linha_entrada(console_t *self)
   // 1     executa uma instrução
   // C     continua a execução
   // F     fim da simulação
+  // Bn    define o breakpoint no endereço 'n'; só B remove  ex: b120
+  // M     pede ao SO que grave as métricas
 
-  char *linha = self->txt_entrada;
+  char *linha = self->tela.txt_entrada;
   console_printf("CMD: '%s'", linha);
   char cmd = toupper(linha[0]);
   int val;
   switch (cmd) {
     case 'E':
-      insere_string_no_terminal(self, linha[1], &linha[2]);
+      envia_para_terminal(self, msg_digita, linha[1], &linha[2]);
       break;
     case 'Z':
-      limpa_saida_do_terminal(self, linha[1]);
+      envia_para_terminal(self, msg_limpa, linha[1], "");
       break;
     case 'D':
       val = atoi(&linha[1]);
       tela_espera(val);
       break;
+    case 'B':
+      val = linha[1] == '\0' ? -1 : atoi(&linha[1]);
+      atomic_store(&self->breakpoint, val);
+      insere_comando_externo(self, cmd);
+      break;
+    case 'M':
+      atomic_store(&self->pede_metricas, true);
+      break;
     case 'P':
     case '1':
     case 'C':
@@ -252,34 +547,48 @@ static void interpreta_linha_entrada(console_t *self)
     default:
       console_printf("Comando '%c' não reconhecido", cmd);
   }
-  strcpy(self->txt_entrada, "");
+  strcpy(self->tela.txt_entrada, "");
 }
 
 // lê e guarda um caractere do teclado; interpreta linha se for 'enter'
 static void verifica_entrada(console_t *self)
 {
   char ch = tela_tecla();
+  if (ch == '\0') return;
 
-  int l = strlen(self->txt_entrada);
+  int l = strlen(self->tela.txt_entrada);
+  self->tela.entrada_alterada = true;
 
   if (ch == '\b' || ch == 127) {   // backspace ou del
     if (l > 0) {
-      self->txt_entrada[l - 1] = '\0';
+      self->tela.txt_entrada[l - 1] = '\0';
     }
   } else if (ch == '\n') {
     interpreta_linha_entrada(self);
   } else if (ch >= ' ' && ch < 127 && l < N_COL) {
-    self->txt_entrada[l] = ch;
-    self->txt_entrada[l+1] = '\0';
+    self->tela.txt_entrada[l] = ch;
+    self->tela.txt_entrada[l+1] = '\0';
   } // senão, ignora o caractere digitado
 }
 
 char console_comando_externo(console_t *self)
 {
-  verifica_entrada(self);
   return remove_comando_externo(self);
 }
 
+int console_breakpoint(console_t *self)
+{
+  return atomic_load(&self->breakpoint);
+}
+
+bool console_pedido_de_metricas(console_t *self)
+{
+  if (!atomic_load_explicit(&self->pede_metricas, memory_order_relaxed)) {
+    return false;
+  }
+  return atomic_exchange(&self->pede_metricas, false);
+}
+
 // DESENHO {{{1
 
 static void desenha_linha_terminal(char *txt, int linha, int cor_txt, int cor_cursor)
@@ -293,19 +602,20 @@ static void desenha_linha_terminal(char *txt, int linha, int cor_txt, int cor_cu
 static void desenha_terminais(console_t *self)
 {
   for (int t = 0; t < N_TERM; t++) {
-    terminal_t *terminal = self->term[t];
-    int cor_txt = self->cor_txt[t];
-    int cor_cursor = self->cor_cursor[t];
+    if (!self->tela.terminal_alterado[t]) continue;
+    int cor_txt = self->tela.cor_txt[t];
+    int cor_cursor = self->tela.cor_cursor[t];
     int linha = LINHA_TERM + t * 2;
-    desenha_linha_terminal(terminal_txt_entrada(terminal), linha, cor_txt, cor_cursor);
-    desenha_linha_terminal(terminal_txt_saida(terminal), linha+1, cor_txt, cor_cursor);
+    desenha_linha_terminal(self->tela.txt_terminal[t][0], linha, cor_txt, cor_cursor);
+    desenha_linha_terminal(self->tela.txt_terminal[t][1], linha+1, cor_txt, cor_cursor);
+    self->tela.terminal_alterado[t] = false;
   }
 }
 
 static void desenha_status(console_t *self)
 {
   tela_posiciona(LINHA_STATUS, 0);
-  tela_puts(COR_STATUS, self->txt_status);
+  tela_puts(COR_STATUS, self->tela.txt_status);
   tela_limpa_linha();
 }
 
@@ -313,7 +623,8 @@ static void desenha_console(console_t *self)
 {
   for (int l=0; l<N_LIN_CONSOLE; l++) {
     tela_posiciona(LINHA_CONSOLE + l, 0);
-    tela_puts(COR_CONSOLE, self->txt_console[l]);
+    int i = (self->tela.ini_console + l) % N_LIN_CONSOLE;
+    tela_puts(COR_CONSOLE, self->tela.txt_console[i]);
     tela_limpa_linha();
   }
 }
@@ -327,26 +638,113 @@ static void desenha_entrada(console_t *self)
   tela_posiciona(LINHA_ENTRADA, N_COL - sizeof(txt_fixo));
   tela_puts(COR_ENTRADA, txt_fixo);
   tela_posiciona(LINHA_ENTRADA, 0);
-  tela_puts(COR_ENTRADA, self->txt_entrada);
+  tela_puts(COR_ENTRADA, self->tela.txt_entrada);
 }
 
+// desenha as partes da tela que foram alteradas
 static void console_desenha(console_t *self)
 {
   desenha_terminais(self);
-  desenha_status(self);
-  desenha_console(self);
-  desenha_entrada(self);
+  if (self->tela.status_alterado) desenha_status(self);
+  if (self->tela.console_alterada) desenha_console(self);
+  // a entrada é desenhada por último porque deixa o cursor no lugar certo
+  if (self->tela.entrada_alterada) {
+    desenha_entrada(self);
+  } else {
+    tela_posiciona(LINHA_ENTRADA, strlen(self->tela.txt_entrada));
+  }
+  self->tela.status_alterado = false;
+  self->tela.console_alterada = false;
+  self->tela.entrada_alterada = false;
 
   // faz aparecer tudo que foi desenhado
   tela_atualiza();
 }
 
+// THREAD DA TELA {{{1
+
+// atualiza a cópia local do que a simulação mandou
+static void recebe_da_simulacao(console_t *self)
+{
+  mensagem_t msg;
+  while (fila_remove(&self->para_tela, &msg)) {
+    switch (msg.tipo) {
+      case msg_console:
+        rola_console(self, msg.txt);
+        break;
+      case msg_status:
+        strcpy(self->tela.txt_status, msg.txt);
+        self->tela.status_alterado = true;
+        break;
+      case msg_entrada:
+      case msg_saida:
+        strcpy(self->tela.txt_terminal[msg.terminal][msg.tipo == msg_saida],
+               msg.txt);
+        self->tela.terminal_alterado[msg.terminal] = true;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+static void *laco_da_tela(void *arg)
+{
+  console_t *self = arg;
+  na_thread_da_tela = true;
+  tela_init();
+  // a leitura do teclado espera um pouco se não tiver tecla, e dá o ritmo
+  //   do laço
+  while (!atomic_load(&self->terminar)) {
+    recebe_da_simulacao(self);
+    verifica_entrada(self);
+    if (tempo_real() - self->tela.ultimo_quadro >= 1000 / QUADROS_POR_S) {
+      console_desenha(self);
+      self->tela.ultimo_quadro = tempo_real();
+    }
+  }
+  recebe_da_simulacao(self);
+  console_desenha(self);
+  tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
+  tela_atualiza();
+  while (tela_tecla() != '\n') {
+    ;
+  }
+  tela_fim();
+  return NULL;
+}
+
 // TICTAC {{{1
+
+bool console_quadro_devido(console_t *self)
+{
+  if (self->sem_tela) return false;
+  return tempo_real() - self->sim.ultimo_envio >= 1000 / QUADROS_POR_S;
+}
+
 void console_tictac(console_t *self)
 {
-  verifica_entrada(self);
-  atualiza_terminais(self);
-  console_desenha(self);
+  console_tictac_terminais(self, 1);
+  console_atualiza(self);
+}
+
+void console_tictac_terminais(console_t *self, int n)
+{
+  recebe_da_tela(self);
+  atualiza_terminais(self, n);
+}
+
+void console_atualiza(console_t *self)
+{
+  if (!console_quadro_devido(self)) return;
+  envia_estado(self);
+  self->sim.ultimo_envio = tempo_real();
+}
+
+void console_espera(console_t *self)
+{
+  struct timespec ts = { 0, ESPERA_PARADO * 1000000L };
+  nanosleep(&ts, NULL);
 }
 
 // vim: foldmethod=marker
@@ -9,15 +9,29 @@
 #include <stdbool.h>
 #include "terminal.h"
 
+// a tela é desenhada e o teclado lido por uma thread própria, criada junto
+//   com a console; as funções devem ser chamadas pela thread da simulação.
+//   console_printf também é usada pela própria thread da tela (que escreve
+//   direto na sua cópia da console); outras threads não podem usá-la, porque
+//   a fila que leva as linhas para a tela só admite um produtor.
+//   O que a simulação altera (terminais, status) só chega à tela quando
+//   console_atualiza envia.
+
 typedef struct console_t console_t;
 
-// cria e inicializa a console
+// cria e inicializa a console, e a thread que cuida da tela
 console_t *console_cria(void);
 
-// destrói a console
+// cria a console sem tela, para execução sem operador
+// o que é impresso na console vai para a saída padrão, a saída de cada
+//   terminal vai para um arquivo ("terminal_A", etc), e não tem entrada
+console_t *console_cria_sem_tela(void);
+
+// destrói a console (com tela, espera o operador digitar ENTER)
 void console_destroi(console_t *self);
 
 // imprime na área geral do console
+// só pode ser chamada pela thread da simulação ou pela da tela
 int console_printf(char *fmt, ...);
 
 // imprime na linha de status
@@ -30,14 +44,43 @@ void console_print_status(console_t *self, char *txt);
 //   'P': para a execução,
 //   '1': executa uma instrução,
 //   'C': continua a execução,
-//   'F': finaliza a simulação.
+//   'F': finaliza a simulação,
+//   'B': define o endereço de breakpoint (ver console_breakpoint).
 // retorna '\0' caso não tenha comando externo digitado
+// não espera pelo teclado; pode ser chamada a cada lote de instruções
 char console_comando_externo(console_t *self);
 
+// retorna o endereço de breakpoint do último comando 'B' (-1 para nenhum)
+int console_breakpoint(console_t *self);
+
+// retorna true se o operador pediu a gravação das métricas (comando 'M')
+//   desde a última chamada; é consultada pelo SO, a cada interrupção
+bool console_pedido_de_metricas(console_t *self);
+
 // retorna o terminal identificado ('A', 'B', etc)
 terminal_t *console_terminal(console_t *self, char id_terminal);
 
 // esta função deve ser chamada periodicamente para que tela funcione
+// equivale a console_tictac_terminais(self, 1) seguida de console_atualiza
 void console_tictac(console_t *self);
 
+// registra a passagem de n unidades de tempo nos terminais, depois de
+//   entregar a eles o que o operador digitou
+void console_tictac_terminais(console_t *self, int n);
+
+// manda para a thread da tela as partes alteradas dos terminais e do status
+// não precisa ser chamada a cada instrução, só com frequência suficiente
+//   para a tela parecer viva
+// só envia no máximo algumas dezenas de vezes por segundo, que é o que a tela
+//   consegue mostrar
+void console_atualiza(console_t *self);
+
+// retorna true se a próxima chamada a console_atualiza vai enviar o estado
+// serve para evitar montar a linha de status quando ela não vai ser mostrada
+bool console_quadro_devido(console_t *self);
+
+// espera alguns ms de tempo real; para a simulação chamar quando não tem o
+//   que executar (parada), em vez de ocupar o processador à toa
+void console_espera(console_t *self);
+
 #endif // CONSOLE_H
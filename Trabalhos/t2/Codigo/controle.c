@@ -9,20 +9,40 @@
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <time.h>
+
+// número máximo de instruções executadas em um lote, quando não há nenhum
+//   evento de relógio programado
+#define MAX_LOTE 1000
 
 struct controle_t {
   cpu_t *cpu;
   relogio_t *relogio;
   console_t *console;
+  pic_t *pic;
   enum { executando, passo, parado, fim } estado;
+  // tempo passado com a CPU parada, esperando interrupção
+  long long t_ocioso;
+  // tempo passado com a CPU esperando a memória (faltas na TLB), além do
+  //   das instruções
+  long long t_espera;
+  // se está executando sem operador (ver controle_define_lote)
+  bool lote;
 };
 
 // funções auxiliares
+static int controle_tamanho_do_lote(controle_t *self);
+static int controle_tempo_ocioso(controle_t *self);
+static void controle_executa_lote(controle_t *self);
+static void controle_entrega_interrupcao(controle_t *self);
+static long controle_tempo_real(void);
+static void controle_imprime_resumo(controle_t *self, long t_real);
 static void controle_processa_comandos_da_console(controle_t *self);
 static void controle_atualiza_estado_na_console(controle_t *self);
 
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          pic_t *pic)
 {
   controle_t *self = malloc(sizeof(*self));
   assert(self != NULL);
@@ -30,7 +50,11 @@ controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
   self->cpu = cpu;
   self->console = console;
   self->relogio = relogio;
+  self->pic = pic;
   self->estado = parado;
+  self->t_ocioso = 0;
+  self->t_espera = 0;
+  self->lote = false;
 
   return self;
 }
@@ -40,38 +64,137 @@ void controle_destroi(controle_t *self)
   free(self);
 }
 
+void controle_define_lote(controle_t *self)
+{
+  self->lote = true;
+  self->estado = executando;
+}
+
 void controle_laco(controle_t *self)
 {
-  // executa uma instrução por vez até a console dizer que chega
+  long t_inicio = controle_tempo_real();
+  // executa um lote de instruções por vez até a console dizer que chega
   do {
+    // os comandos do operador chegam da thread da tela; verificar custa só
+    //   uma leitura atômica
+    controle_processa_comandos_da_console(self);
     if (self->estado == passo || self->estado == executando) {
-      cpu_executa_1(self->cpu);
-      relogio_tictac(self->relogio);
-
-      if (self->estado == passo) self->estado = parado;
-
-      // enquanto não tem controlador de interrupção, fala direto com o relógio
-      // o dispositivo 3 do relógio contém 1 se o timer expirou
-      int tem_int;
-      relogio_leitura(self->relogio, 3, &tem_int);
-      if (tem_int != 0) {
-        cpu_interrompe(self->cpu, IRQ_RELOGIO);
-      }
+      controle_executa_lote(self);
+    } else {
+      console_tictac_terminais(self->console, 1);
+      console_espera(self->console);
     }
-    console_tictac(self->console);
 
-    controle_processa_comandos_da_console(self);
-    controle_atualiza_estado_na_console(self);
+    // a tela é desenhada em outra thread, no ritmo dela; a linha de status só
+    //   é montada quando vai ser enviada para lá
+    if (console_quadro_devido(self->console)) {
+      controle_atualiza_estado_na_console(self);
+      console_atualiza(self->console);
+    }
   } while (self->estado != fim);
 
   console_printf("Fim da execução.");
-  console_printf("relógio: %d\n", relogio_agora(self->relogio));
+  console_printf("relógio: %lld (ocioso: %lld)\n",
+                 relogio_agora(self->relogio), self->t_ocioso);
+  if (self->lote) {
+    controle_imprime_resumo(self, controle_tempo_real() - t_inicio);
+  }
+}
+
+// imprime o resumo da execução em uma linha, no formato chave=valor
+// 't_real' é o tempo real de execução, em ms
+static void controle_imprime_resumo(controle_t *self, long t_real)
+{
+  long long agora = relogio_agora(self->relogio);
+  long long instrucoes = agora - self->t_ocioso - self->t_espera;
+  double instr_por_s = t_real > 0 ? instrucoes * 1000.0 / t_real : 0;
+  printf("RESUMO relogio=%lld ocioso=%lld espera=%lld instrucoes=%lld"
+         " t_real_ms=%ld instrucoes_por_s=%.0f\n",
+         agora, self->t_ocioso, self->t_espera, instrucoes, t_real,
+         instr_por_s);
 }
  
 
+// quanto tempo a CPU pode executar sem que o controlador precise intervir:
+//   até o próximo evento agendado no controlador de interrupções (sem espera
+//   pela memória, é o número de instruções)
+// uma interrupção que fica pendente porque a CPU não a aceitou (em modo
+//   supervisor) não limita o lote: a CPU só pode passar a aceitá-la depois de
+//   uma instrução que muda o modo ou para a CPU, e essas terminam o lote
+static int controle_tamanho_do_lote(controle_t *self)
+{
+  if (self->estado == passo) return 1;
+  int t_ate_evento = pic_tempo_ate_evento(self->pic);
+  if (t_ate_evento > 0 && t_ate_evento < MAX_LOTE) return t_ate_evento;
+  return MAX_LOTE;
+}
+
+// quanto tempo passar de uma vez com a CPU parada
+// nada acontece até o próximo evento agendado, então o relógio pode avançar
+//   direto até ele; sem evento agendado (ou executando passo a passo), só
+//   pode sair do estado parado por algo externo, e o tempo avança de 1 em 1
+static int controle_tempo_ocioso(controle_t *self)
+{
+  if (self->estado == passo) return 1;
+  int t_ate_evento = pic_tempo_ate_evento(self->pic);
+  if (t_ate_evento > 0) return t_ate_evento;
+  return 1;
+}
+
+static void controle_executa_lote(controle_t *self)
+{
+  cpu_parada_t motivo;
+  int espera;
+  int n = cpu_executa_n(self->cpu, controle_tamanho_do_lote(self), &motivo,
+                        &espera);
+  // o tempo passa com as instruções e com a espera da CPU pela memória
+  int t = n + espera;
+  self->t_espera += espera;
+  // com a CPU parada, o tempo passa do mesmo jeito
+  if (n == 0 && motivo != parada_breakpoint) {
+    // sem operador, se não tem nada agendado, a CPU não vai mais acordar
+    if (self->lote && pic_tempo_ate_evento(self->pic) == -1) {
+      self->estado = fim;
+      return;
+    }
+    t = controle_tempo_ocioso(self);
+    self->t_ocioso += t;
+  }
+  relogio_tictac_n(self->relogio, t);
+  console_tictac_terminais(self->console, t);
+  pic_avanca(self->pic, relogio_agora(self->relogio));
+
+  if (self->estado == passo) self->estado = parado;
+  if (motivo == parada_breakpoint) {
+    self->estado = parado;
+    console_printf("Breakpoint atingido");
+  }
+
+  controle_entrega_interrupcao(self);
+}
+
+// entrega à CPU a interrupção pendente de maior prioridade, se houver
+// se a CPU não aceitar, a interrupção continua pendente no controlador
+static void controle_entrega_interrupcao(controle_t *self)
+{
+  irq_t irq;
+  if (pic_proxima(self->pic, &irq) && cpu_interrompe(self->cpu, irq)) {
+    pic_abaixa(self->pic, irq);
+  }
+}
+
+// retorna o tempo real, em ms, contado de um instante qualquer
+static long controle_tempo_real(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 static void controle_processa_comandos_da_console(controle_t *self)
 {
   char cmd = console_comando_externo(self->console);
+  int endereco;
   switch (cmd) {
     case 'F':
       self->estado = fim;
@@ -85,6 +208,15 @@ static void controle_processa_comandos_da_console(controle_t *self)
     case 'C':
       self->estado = executando;
       break;
+    case 'B':
+      endereco = console_breakpoint(self->console);
+      cpu_define_breakpoint(self->cpu, endereco);
+      if (endereco == -1) {
+        console_printf("Breakpoint removido");
+      } else {
+        console_printf("Breakpoint em %d", endereco);
+      }
+      break;
   }
 }
 
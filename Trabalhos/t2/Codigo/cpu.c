@@ -4,6 +4,8 @@
 // so24b
 
 // INCLUDES {{{1
+// para memfd_create, usada pelo motor jit
+#define _GNU_SOURCE
 #include "cpu.h"
 #include "err.h"
 #include "instrucao.h"
@@ -14,7 +16,97 @@
 #include <string.h>
 #include <assert.h>
 
+// o motor jit só gera código para x86-64, com a convenção de chamada do
+//   System V, e o buffer de código usa memfd_create, do Linux
+#if defined(__x86_64__) && defined(__linux__)
+#define CPU_JIT_X86_64
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 // DECLARAÇÃO {{{1
+// número de posições de memória em cada bloco de instruções pré-decodificadas
+#define TAM_BLOCO_DECOD 64
+
+// uma entrada da micro-TLB: uma página traduzida, com o conteúdo do quadro
+//   correspondente na memória do hospedeiro (ver mmu_quadro_direto)
+typedef struct {
+  // página da entrada (-1 se vazia) e modo em que foi traduzida
+  int pagina;
+  cpu_modo_t modo;
+  // endereço físico do início do quadro, e seu conteúdo
+  int end_quadro;
+  const int *quadro;
+  // se a página já foi marcada como alterada
+  bool alterada;
+  // acertos na TLB feitos pela entrada e ainda não contados na MMU (ver
+  //   mmu_conta_acertos_tlb)
+  int acertos;
+} micro_tlb_t;
+
+// tipo das funções que executam uma instrução pré-decodificada
+// recebem o argumento da instrução (ignorado pelas instruções sem argumento)
+typedef void (*f_instrucao_t)(cpu_t *self, int A1);
+
+// uma posição da memória física, pré-decodificada como instrução
+typedef struct {
+  // função que executa a instrução; NULL se a posição não está decodificada
+  f_instrucao_t executa;
+  // argumento da instrução
+  int A1;
+  // se a instrução só pode ser executada em modo supervisor
+  bool privilegiada;
+  // se a instrução acessa E/S (ver cpu_executa_n)
+  bool es;
+} instr_decod_t;
+
+// superinstruções: sequências comuns de instruções que, dentro de um bloco
+//   traduzido, são executadas de uma vez (ver a tabela 'fusoes')
+typedef enum {
+  fus_chamada_sistema,  // cargi / trax / cargi / chamas
+  fus_salva_x,          // trax / armm
+  fus_restaura_x,       // trax / cargm / trax
+  fus_chamas_imediato,  // cargi / chamas
+  fus_testa_zero,       // cargx / desvz
+  fus_incx_desvia,      // incx / desv
+  N_FUSOES
+} fusao_id_t;
+
+// número de entradas na cache de blocos traduzidos
+#define N_BLOCOS 1024
+// número máximo de instruções em um bloco traduzido
+#define MAX_INSTR_BLOCO 32
+// número de vezes que um bloco é executado antes de ser traduzido
+#define LIMIAR_TRADUCAO 8
+
+// tipo do código nativo de um bloco compilado pelo motor jit
+// executa o bloco (e os seguintes, se estiverem compilados e couberem em 'max'
+//   instruções) e retorna o número de instruções executadas
+typedef int (*f_bloco_nativo_t)(cpu_t *self, int max);
+
+// um bloco básico da memória física, traduzido para uma sequência de
+//   instruções pré-decodificadas que são executadas sem voltar ao laço
+//   principal; só a última instrução pode alterar o fluxo de execução
+typedef struct {
+  // endereço físico da primeira instrução do bloco (-1 se entrada livre)
+  int inicio;
+  // versão da página quando o bloco foi traduzido
+  int versao;
+  // quantas vezes a entrada foi encontrada antes de ser traduzida
+  int execucoes;
+  // número de instruções traduzidas (0 se ainda não traduzido ou se a
+  //   primeira instrução não pode fazer parte de um bloco)
+  int n_instr;
+  bool traduzido;
+  instr_decod_t instr[MAX_INSTR_BLOCO];
+  // superinstrução que começa em cada instrução do bloco (-1 se nenhuma)
+  signed char fusao[MAX_INSTR_BLOCO];
+  // código nativo da tradução atual (NULL se o bloco não foi compilado)
+  f_bloco_nativo_t nativo;
+} bloco_t;
+
 // uma CPU tem estado, memória, controlador de ES
 struct cpu_t {
   // registradores
@@ -33,8 +125,69 @@ struct cpu_t {
   // função e argumento para implementar instrução CHAMAC
   func_chamaC_t funcaoC;
   void *argC;
+  // endereço onde cpu_executa_n deve parar (-1 se nenhum)
+  int breakpoint;
+  // se cpu_executa_n parou no breakpoint e o PC ainda não saiu dele; a
+  //   próxima execução começa pela instrução do breakpoint
+  bool no_breakpoint;
+  // se uma interrupção foi aceita (zerado no início de cpu_executa_n)
+  bool interrompida;
+  // se as faltas na TLB custam tempo, e o tempo de espera por elas no
+  //   cpu_executa_n atual (ver atualiza_espera)
+  bool conta_espera;
+  int espera;
+  // motor de execução em uso
+  cpu_motor_t motor;
+  // tamanho das páginas da MMU (2^bits_pagina), e máscara do deslocamento
+  int bits_pagina;
+  int mascara_pagina;
+  // instruções pré-decodificadas, em blocos de TAM_BLOCO_DECOD posições da
+  //   memória física; cada bloco é alocado quando é usado pela primeira vez
+  int n_blocos_decod;
+  instr_decod_t **blocos_decod;
+  // cache de blocos traduzidos, indexada pelo endereço físico do início
+  bloco_t *blocos;
+  // versão de cada página física, alterada quando é escrita uma posição que
+  //   faz parte de algum bloco traduzido
+  int *versao_pagina;
+  // se cada posição da memória física faz parte de algum bloco traduzido
+  bool *em_bloco;
+  // buffer com o código nativo dos blocos, gerado em sequência (NULL se não
+  //   há motor jit), e quantos bytes dele estão em uso; o código é escrito
+  //   em 'nativo' e executado no mesmo buffer mapeado em 'nativo_exec'
+  unsigned char *nativo;
+  unsigned char *nativo_exec;
+  int nativo_usado;
+  // número de execuções de cada superinstrução
+  long usos_fusao[N_FUSOES];
+  // micro-TLB: a última página de código e a última de dados acessadas, e a
+  //   página de código anterior; as traduções valem enquanto a geração da
+  //   MMU for 'utlb_geracao'
+  micro_tlb_t utlb_codigo;
+  micro_tlb_t utlb_dados;
+  micro_tlb_t utlb_codigo_ant;
+  unsigned utlb_geracao;
+  // a entrada da micro-TLB com o acerto mais recente
+  micro_tlb_t *utlb_ultima;
+  bool utlb_ligada;
 };
 
+// funções auxiliares para a micro-TLB
+static void utlb_esvazia(cpu_t *self);
+static void utlb_confere(cpu_t *self);
+static void utlb_descarrega(cpu_t *self);
+
+// funções auxiliares para a pré-decodificação
+static void cpu_cria_decod(cpu_t *self);
+static void cpu_destroi_decod(cpu_t *self);
+static void cpu_cria_blocos(cpu_t *self);
+static void cpu_destroi_blocos(cpu_t *self);
+
+// funções auxiliares para o motor jit
+static void cpu_cria_nativo(cpu_t *self);
+static void cpu_destroi_nativo(cpu_t *self);
+static void compila_bloco(cpu_t *self, bloco_t *bloco, int opcodes[]);
+
 // CRIAÇÃO {{{1
 cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 {
@@ -44,6 +197,8 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 
   self->mmu = mmu;
   self->es = es;
+  self->bits_pagina = mmu_bits_pagina(mmu);
+  self->mascara_pagina = mmu_tam_pagina(mmu) - 1;
   // inicializa registradores
   self->PC = 0;
   self->A = 0;
@@ -52,6 +207,11 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
   self->complemento = 0;
   self->modo = usuario;
   self->funcaoC = NULL;
+  self->breakpoint = -1;
+  self->no_breakpoint = false;
+  self->interrompida = false;
+  self->conta_espera = false;
+  self->espera = 0;
   // inicializa instruções privilegiadas
   memset(self->privilegiadas, 0, sizeof(self->privilegiadas));
   self->privilegiadas[PARA] = true;
@@ -59,6 +219,16 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
   self->privilegiadas[ESCR] = true;
   self->privilegiadas[RETI] = true;
   self->privilegiadas[CHAMAC] = true;
+  // inicializa o motor de execução
+  self->motor = motor_predecodificado;
+  cpu_cria_decod(self);
+  cpu_cria_blocos(self);
+  self->nativo = NULL;
+  memset(self->usos_fusao, 0, sizeof(self->usos_fusao));
+  self->utlb_geracao = mmu_geracao(mmu);
+  self->utlb_ultima = &self->utlb_dados;
+  self->utlb_ligada = true;
+  utlb_esvazia(self);
   // gera uma interrupção de reset, para o SO poder executar
   cpu_interrompe(self, IRQ_RESET);
 
@@ -68,9 +238,37 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 void cpu_destroi(cpu_t *self)
 {
   // eu nao criei MMU nem es; quem criou que destrua!
+  cpu_destroi_nativo(self);
+  cpu_destroi_blocos(self);
+  cpu_destroi_decod(self);
   free(self);
 }
 
+void cpu_define_motor(cpu_t *self, cpu_motor_t motor)
+{
+  if (motor == motor_jit && self->nativo == NULL) {
+    cpu_cria_nativo(self);
+    // os blocos já traduzidos não foram compilados
+    for (int b = 0; b < N_BLOCOS; b++) {
+      self->blocos[b].inicio = -1;
+    }
+  }
+  self->motor = motor;
+}
+
+void cpu_define_micro_tlb(cpu_t *self, bool ligada)
+{
+  utlb_descarrega(self);
+  utlb_esvazia(self);
+  self->utlb_ligada = ligada;
+}
+
+void cpu_define_breakpoint(cpu_t *self, int endereco)
+{
+  self->breakpoint = endereco;
+  self->no_breakpoint = false;
+}
+
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t funcaoC, void *argC)
 {
   self->funcaoC = funcaoC;
@@ -126,28 +324,194 @@ void cpu_concatena_descricao(cpu_t *self, char *str)
   strcat(str, aux);
 }
 
+// MICRO-TLB {{{1
+// ---------------------------------------------------------------------
+// a CPU guarda a tradução da última página de código e da última de dados,
+//   e acessa o conteúdo delas diretamente na memória do hospedeiro, sem
+//   passar pela MMU; as páginas são marcadas como acessadas quando entram na
+//   micro-TLB (e como alteradas na primeira escrita), o que tem o mesmo
+//   efeito das marcações a cada acesso, porque o SO só pode alterar a tabela
+//   de páginas entre execuções de instruções, e a micro-TLB é conferida
+//   antes delas (e esvaziada depois de CHAMAC, que executa o SO)
+// com a TLB da MMU ligada, uma página só entra na micro-TLB depois de
+//   consultada na TLB, e cada acesso feito pela micro-TLB é um acerto na TLB;
+//   os acertos são acumulados nas entradas e passados à MMU antes da próxima
+//   consulta feita pela MMU (utlb_descarrega); se essa consulta substituir
+//   uma entrada da TLB, a geração da MMU muda e a micro-TLB é esvaziada
+//   (utlb_confere), para não continuar acertando numa página que saiu da TLB
+// a página de código que sai da micro-TLB fica guardada como a anterior, e
+//   volta para a entrada de código se for usada de novo (um laço que passa
+//   de uma página para a outra não precisa consultar a MMU a cada vez); ela
+//   continua na TLB e marcada, porque a geração não mudou desde que entrou
+
+static void utlb_esvazia(cpu_t *self)
+{
+  self->utlb_codigo.pagina = -1;
+  self->utlb_codigo.acertos = 0;
+  self->utlb_dados.pagina = -1;
+  self->utlb_dados.acertos = 0;
+  self->utlb_codigo_ant.pagina = -1;
+  self->utlb_codigo_ant.acertos = 0;
+}
+
+// esvazia a micro-TLB se as traduções da MMU podem ter mudado
+static void utlb_confere(cpu_t *self)
+{
+  unsigned geracao = mmu_geracao(self->mmu);
+  if (geracao != self->utlb_geracao) {
+    self->utlb_geracao = geracao;
+    utlb_esvazia(self);
+  }
+}
+
+// passa para a MMU os acertos na TLB feitos pela micro-TLB; os da entrada
+//   com o acerto mais recente por último, para a ordem dos usos ser mantida
+static void utlb_descarrega(cpu_t *self)
+{
+  micro_tlb_t *ultima = self->utlb_ultima;
+  micro_tlb_t *outra = ultima == &self->utlb_codigo ? &self->utlb_dados
+                                                    : &self->utlb_codigo;
+  micro_tlb_t *entradas[] = { outra, ultima };
+  for (int i = 0; i < 2; i++) {
+    micro_tlb_t *e = entradas[i];
+    if (e->acertos > 0 && e->pagina != -1 && e->modo == usuario) {
+      mmu_conta_acertos_tlb(self->mmu, e->pagina, e->acertos);
+    }
+    e->acertos = 0;
+  }
+}
+
+// retorna true se a entrada 'e' contém a página de 'endereco'
+static bool utlb_contem(cpu_t *self, micro_tlb_t *e, int endereco)
+{
+  return self->utlb_ligada && endereco >= 0 && e->modo == self->modo
+         && e->pagina == endereco >> self->bits_pagina;
+}
+
+// retorna true se a entrada 'e' contém a página de 'endereco', trazendo-a
+//   da página de código anterior se 'e' é a entrada de código
+static bool utlb_procura(cpu_t *self, micro_tlb_t *e, int endereco)
+{
+  if (utlb_contem(self, e, endereco)) return true;
+  if (e != &self->utlb_codigo
+      || !utlb_contem(self, &self->utlb_codigo_ant, endereco)) {
+    return false;
+  }
+  // os acertos são passados antes, para ficarem na ordem certa
+  utlb_descarrega(self);
+  micro_tlb_t atual = self->utlb_codigo;
+  self->utlb_codigo = self->utlb_codigo_ant;
+  self->utlb_codigo_ant = atual;
+  return true;
+}
+
+// traduz 'endereco' com a entrada 'e', que passa a conter a página dele se
+//   ainda não continha; marca a página como faria um acesso pela MMU (como
+//   alterada, se 'alteracao'), e conta o acesso como consulta à TLB se
+//   'consulta'
+// retorna o deslocamento do endereço no quadro, ou -1 se o acesso deve ser
+//   feito pela MMU
+static int utlb_traduz(cpu_t *self, micro_tlb_t *e, int endereco,
+                       bool alteracao, bool consulta)
+{
+  if (!utlb_procura(self, e, endereco)) {
+    if (!self->utlb_ligada || endereco < 0) return -1;
+    int pagina = endereco >> self->bits_pagina;
+    utlb_descarrega(self);
+    if (e == &self->utlb_codigo) self->utlb_codigo_ant = *e;
+    e->quadro = mmu_quadro_direto(self->mmu, pagina, alteracao, consulta,
+                                  self->modo, &e->end_quadro);
+    utlb_confere(self);
+    if (e->quadro == NULL) {
+      e->pagina = -1;
+      return -1;
+    }
+    e->pagina = pagina;
+    e->modo = self->modo;
+    e->alterada = alteracao;
+    e->acertos = 0;
+    return endereco & self->mascara_pagina;
+  }
+  if (alteracao && !e->alterada) {
+    mmu_marca_acesso(self->mmu, endereco, true, self->modo);
+    e->alterada = true;
+  }
+  if (consulta) {
+    e->acertos++;
+    self->utlb_ultima = e;
+  }
+  return endereco & self->mascara_pagina;
+}
+
+// traduz 'endereco' com a MMU, fora da micro-TLB (como mmu_traduz)
+static err_t utlb_traduz_pela_mmu(cpu_t *self, int endereco, int *pendfis)
+{
+  utlb_descarrega(self);
+  err_t err = mmu_traduz(self->mmu, endereco, pendfis, self->modo);
+  utlb_confere(self);
+  return err;
+}
+
+// coloca em '*pendfis' o endereço físico do PC, sem marcar a página (como
+//   mmu_traduz)
+static err_t traduz_pc(cpu_t *self, int *pendfis)
+{
+  micro_tlb_t *e = &self->utlb_codigo;
+  if (utlb_procura(self, e, self->PC)) {
+    e->acertos++;
+    self->utlb_ultima = e;
+    *pendfis = e->end_quadro + (self->PC & self->mascara_pagina);
+    return ERR_OK;
+  }
+  return utlb_traduz_pela_mmu(self, self->PC, pendfis);
+}
+
+// marca a página do PC como acessada (como mmu_marca_acesso, que não é uma
+//   consulta à TLB)
+static void marca_pc(cpu_t *self)
+{
+  if (utlb_traduz(self, &self->utlb_codigo, self->PC, false, false) < 0) {
+    mmu_marca_acesso(self->mmu, self->PC, false, self->modo);
+  }
+}
+
 // ACESSO À MEMÓRIA E E/S {{{1
 
 // ---------------------------------------------------------------------
 // funções auxiliares para usar durante a execução das instruções
 // alteram o estado da CPU caso ocorra erro
 
-// lê um valor da memória
-static bool pega_mem(cpu_t *self, int endereco, int *pval)
+// lê um valor da memória, traduzindo o endereço com a entrada 'e' da
+//   micro-TLB
+static bool le_mem(cpu_t *self, micro_tlb_t *e, int endereco, int *pval)
 {
+  int deslocamento = utlb_traduz(self, e, endereco, false, true);
+  if (deslocamento >= 0) {
+    *pval = e->quadro[deslocamento];
+    self->erro = ERR_OK;
+    return true;
+  }
+  utlb_descarrega(self);
   self->erro = mmu_le(self->mmu, endereco, pval, self->modo);
+  utlb_confere(self);
   if (self->erro == ERR_OK) return true;
   self->complemento = endereco;
   return false;
 }
 
+// lê um valor da memória
+static bool pega_mem(cpu_t *self, int endereco, int *pval)
+{
+  return le_mem(self, &self->utlb_dados, endereco, pval);
+}
+
 // lê o opcode da instrução no PC
 // retorna true se ele pode ser executado, ou põe em erro o motivo de não poder
 static bool pega_opcode(cpu_t *self, int *popc)
 {
   // não tem que testar endereços, é tarefa da mmu
   // não pode executar se houver erro na leitura da memória
-  if (!pega_mem(self, self->PC, popc)) return false;
+  if (!le_mem(self, &self->utlb_codigo, self->PC, popc)) return false;
   // pode executar se tiver privilégio para isso
   if (self->modo == supervisor || !self->privilegiadas[*popc]) return true;
   // não pode executar instrução privilegiada em modo usuário
@@ -158,13 +522,23 @@ static bool pega_opcode(cpu_t *self, int *popc)
 // lê o argumento 1 da instrução no PC
 static bool pega_A1(cpu_t *self, int *pA1)
 {
-  return pega_mem(self, self->PC + 1, pA1);
+  return le_mem(self, &self->utlb_codigo, self->PC + 1, pA1);
 }
 
 // escreve um valor na memória
 static bool poe_mem(cpu_t *self, int endereco, int val)
 {
-  self->erro = mmu_escreve(self->mmu, endereco, val, self->modo);
+  // a escrita é feita pela memória, para o observador ser avisado
+  micro_tlb_t *e = &self->utlb_dados;
+  int deslocamento = utlb_traduz(self, e, endereco, true, true);
+  if (deslocamento >= 0) {
+    self->erro = mem_escreve(mmu_mem(self->mmu), e->end_quadro + deslocamento,
+                             val);
+  } else {
+    utlb_descarrega(self);
+    self->erro = mmu_escreve(self->mmu, endereco, val, self->modo);
+    utlb_confere(self);
+  }
   if (self->erro == ERR_OK) return true;
   self->complemento = endereco;
   return false;
@@ -410,8 +784,11 @@ static void op_CHAMAC(cpu_t *self) // chama função em C
     self->erro = ERR_OP_INV;
     return;
   }
+  utlb_descarrega(self);
   self->A = self->funcaoC(self->argC, self->A);
   self->PC += 1;
+  // o SO pode ter alterado o mapeamento da memória
+  utlb_esvazia(self);
 }
 
 static void op_CHAMAS(cpu_t *self) // chamada de sistema
@@ -422,6 +799,282 @@ static void op_CHAMAS(cpu_t *self) // chamada de sistema
 
 }
 
+// INSTRUÇÕES PRÉ-DECODIFICADAS {{{1
+// ---------------------------------------------------------------------
+// implementação das instruções para o motor pré-decodificado
+// o argumento da instrução já foi lido da memória na decodificação
+// as instruções sem argumento usam as mesmas funções do motor de referência
+
+static void pd_NOP(cpu_t *self, int A1)    { op_NOP(self);    }
+static void pd_PARA(cpu_t *self, int A1)   { op_PARA(self);   }
+static void pd_TRAX(cpu_t *self, int A1)   { op_TRAX(self);   }
+static void pd_CPXA(cpu_t *self, int A1)   { op_CPXA(self);   }
+static void pd_INCX(cpu_t *self, int A1)   { op_INCX(self);   }
+static void pd_NEG(cpu_t *self, int A1)    { op_NEG(self);    }
+static void pd_RETI(cpu_t *self, int A1)   { op_RETI(self);   }
+static void pd_CHAMAC(cpu_t *self, int A1) { op_CHAMAC(self); }
+static void pd_CHAMAS(cpu_t *self, int A1) { op_CHAMAS(self); }
+
+static void pd_CARGI(cpu_t *self, int A1) // carrega imediato
+{
+  self->A = A1;
+  self->PC += 2;
+}
+
+static void pd_CARGM(cpu_t *self, int A1) // carrega da memória
+{
+  int mA1;
+  if (pega_mem(self, A1, &mA1)) {
+    self->A = mA1;
+    self->PC += 2;
+  }
+}
+
+static void pd_CARGX(cpu_t *self, int A1) // carrega indexado
+{
+  int mA1mX;
+  if (pega_mem(self, A1 + self->X, &mA1mX)) {
+    self->A = mA1mX;
+    self->PC += 2;
+  }
+}
+
+static void pd_ARMM(cpu_t *self, int A1) // armazena na memória
+{
+  if (poe_mem(self, A1, self->A)) {
+    self->PC += 2;
+  }
+}
+
+static void pd_ARMX(cpu_t *self, int A1) // armazena indexado
+{
+  if (poe_mem(self, A1 + self->X, self->A)) {
+    self->PC += 2;
+  }
+}
+
+static void pd_SOMA(cpu_t *self, int A1) // soma
+{
+  int mA1;
+  if (pega_mem(self, A1, &mA1)) {
+    self->A += mA1;
+    self->PC += 2;
+  }
+}
+
+static void pd_SUB(cpu_t *self, int A1) // subtração
+{
+  int mA1;
+  if (pega_mem(self, A1, &mA1)) {
+    self->A -= mA1;
+    self->PC += 2;
+  }
+}
+
+static void pd_MULT(cpu_t *self, int A1) // multiplicação
+{
+  int mA1;
+  if (pega_mem(self, A1, &mA1)) {
+    self->A *= mA1;
+    self->PC += 2;
+  }
+}
+
+static void pd_DIV(cpu_t *self, int A1) // divisão
+{
+  int mA1;
+  if (pega_mem(self, A1, &mA1)) {
+    self->A /= mA1;
+    self->PC += 2;
+  }
+}
+
+static void pd_RESTO(cpu_t *self, int A1) // resto
+{
+  int mA1;
+  if (pega_mem(self, A1, &mA1)) {
+    self->A %= mA1;
+    self->PC += 2;
+  }
+}
+
+static void pd_DESV(cpu_t *self, int A1) // desvio incondicional
+{
+  self->PC = A1;
+}
+
+static void pd_DESVZ(cpu_t *self, int A1) // desvio condicional
+{
+  self->PC = (self->A == 0) ? A1 : self->PC + 2;
+}
+
+static void pd_DESVNZ(cpu_t *self, int A1) // desvio condicional
+{
+  self->PC = (self->A != 0) ? A1 : self->PC + 2;
+}
+
+static void pd_DESVN(cpu_t *self, int A1) // desvio condicional
+{
+  self->PC = (self->A < 0) ? A1 : self->PC + 2;
+}
+
+static void pd_DESVP(cpu_t *self, int A1) // desvio condicional
+{
+  self->PC = (self->A > 0) ? A1 : self->PC + 2;
+}
+
+static void pd_CHAMA(cpu_t *self, int A1) // chamada de subrotina
+{
+  if (poe_mem(self, A1, self->PC + 2)) {
+    self->PC = A1 + 1;
+  }
+}
+
+static void pd_RET(cpu_t *self, int A1) // retorno de subrotina
+{
+  int mA1;
+  if (pega_mem(self, A1, &mA1)) {
+    self->PC = mA1;
+  }
+}
+
+static void pd_LE(cpu_t *self, int A1) // leitura de E/S
+{
+  int dado;
+  if (pega_es(self, A1, &dado)) {
+    self->A = dado;
+    self->PC += 2;
+  }
+}
+
+static void pd_ESCR(cpu_t *self, int A1) // escrita de E/S
+{
+  if (poe_es(self, A1, self->A)) {
+    self->PC += 2;
+  }
+}
+
+static void pd_invalida(cpu_t *self, int A1) // opcode desconhecido
+{
+  self->erro = ERR_INSTR_INV;
+}
+
+// executa a instrução no PC com o motor de referência
+// usada para as posições que não podem ser pré-decodificadas
+static void pd_referencia(cpu_t *self, int A1);
+
+static f_instrucao_t instrucoes_decod[N_OPCODE] = {
+  [NOP]    = pd_NOP,    [PARA]   = pd_PARA,   [CARGI]  = pd_CARGI,
+  [CARGM]  = pd_CARGM,  [CARGX]  = pd_CARGX,  [ARMM]   = pd_ARMM,
+  [ARMX]   = pd_ARMX,   [TRAX]   = pd_TRAX,   [CPXA]   = pd_CPXA,
+  [INCX]   = pd_INCX,   [SOMA]   = pd_SOMA,   [SUB]    = pd_SUB,
+  [MULT]   = pd_MULT,   [DIV]    = pd_DIV,    [RESTO]  = pd_RESTO,
+  [NEG]    = pd_NEG,    [DESV]   = pd_DESV,   [DESVZ]  = pd_DESVZ,
+  [DESVNZ] = pd_DESVNZ, [DESVN]  = pd_DESVN,  [DESVP]  = pd_DESVP,
+  [CHAMA]  = pd_CHAMA,  [RET]    = pd_RET,    [LE]     = pd_LE,
+  [ESCR]   = pd_ESCR,   [RETI]   = pd_RETI,   [CHAMAC] = pd_CHAMAC,
+  [CHAMAS] = pd_CHAMAS,
+};
+
+// PRÉ-DECODIFICAÇÃO {{{1
+
+// chamada pela memória a cada escrita
+// descarta a decodificação das posições que dependem dos endereços alterados:
+//   as instruções que começam neles e a anterior, que pode ter o primeiro
+//   como argumento
+static void cpu_memoria_alterada(void *arg, int endereco, int n);
+
+static void cpu_cria_decod(cpu_t *self)
+{
+  mem_t *mem = mmu_mem(self->mmu);
+  self->n_blocos_decod = (mem_tam(mem) + TAM_BLOCO_DECOD - 1) / TAM_BLOCO_DECOD;
+  self->blocos_decod = calloc(self->n_blocos_decod, sizeof(*self->blocos_decod));
+  assert(self->blocos_decod != NULL);
+  mem_define_observador(mem, cpu_memoria_alterada, self);
+}
+
+static void cpu_destroi_decod(cpu_t *self)
+{
+  mem_define_observador(mmu_mem(self->mmu), NULL, NULL);
+  for (int b = 0; b < self->n_blocos_decod; b++) {
+    free(self->blocos_decod[b]);
+  }
+  free(self->blocos_decod);
+}
+
+static void invalida_decod(cpu_t *self, int endfis)
+{
+  if (endfis < 0) return;
+  instr_decod_t *bloco = self->blocos_decod[endfis / TAM_BLOCO_DECOD];
+  if (bloco != NULL) {
+    bloco[endfis % TAM_BLOCO_DECOD].executa = NULL;
+  }
+}
+
+static void cpu_memoria_alterada(void *arg, int endereco, int n)
+{
+  cpu_t *self = arg;
+  invalida_decod(self, endereco - 1);
+  for (int end = endereco; end < endereco + n; end++) {
+    invalida_decod(self, end);
+    // os blocos traduzidos da página são descartados se a posição alterada
+    //   faz parte de algum deles
+    if (self->em_bloco[end]) {
+      self->versao_pagina[end >> self->bits_pagina]++;
+    }
+  }
+}
+
+// retorna true se a instrução acessa dispositivos de E/S; CHAMAC conta, porque
+//   o SO acessa dispositivos
+static bool instrucao_usa_es(int opcode)
+{
+  return opcode == LE || opcode == ESCR || opcode == CHAMAC;
+}
+
+// decodifica a instrução no endereço físico 'endfis' (que é válido)
+static void decodifica(cpu_t *self, int endfis, instr_decod_t *instr)
+{
+  mem_t *mem = mmu_mem(self->mmu);
+  int opcode;
+  mem_le(mem, endfis, &opcode);
+  instr->A1 = 0;
+  instr->privilegiada = false;
+  instr->es = instrucao_usa_es(opcode);
+  if (opcode < 0 || opcode >= N_OPCODE || instrucoes_decod[opcode] == NULL) {
+    instr->executa = pd_invalida;
+    return;
+  }
+  if (instrucao_num_args(opcode) > 0) {
+    // o argumento só pode ser lido agora se estiver na mesma página que o
+    //   opcode (senão o mapeamento pode ser diferente) e for um endereço válido;
+    //   se não, a instrução é executada pelo motor de referência
+    if (((endfis + 1) & self->mascara_pagina) == 0
+        || mem_le(mem, endfis + 1, &instr->A1) != ERR_OK) {
+      instr->executa = pd_referencia;
+      return;
+    }
+  }
+  instr->executa = instrucoes_decod[opcode];
+  instr->privilegiada = self->privilegiadas[opcode];
+}
+
+// retorna a instrução pré-decodificada no endereço físico 'endfis' (que é
+//   válido), decodificando se necessário
+static instr_decod_t *pega_instr_decod(cpu_t *self, int endfis)
+{
+  instr_decod_t **pbloco = &self->blocos_decod[endfis / TAM_BLOCO_DECOD];
+  if (*pbloco == NULL) {
+    *pbloco = calloc(TAM_BLOCO_DECOD, sizeof(**pbloco));
+    assert(*pbloco != NULL);
+  }
+  instr_decod_t *instr = &(*pbloco)[endfis % TAM_BLOCO_DECOD];
+  if (instr->executa == NULL) {
+    decodifica(self, endfis, instr);
+  }
+  return instr;
+}
+
 // EXECUTA UMA INSTRUÇÃO {{{1
 
 static void executa_a_instrucao(cpu_t *self, int opcode)
@@ -459,27 +1112,1059 @@ static void executa_a_instrucao(cpu_t *self, int opcode)
   }
 }
 
-void cpu_executa_1(cpu_t *self)
+// executa a instrução no PC com o motor de referência
+static void executa_referencia(cpu_t *self)
 {
-  // não executa se CPU já estiver em erro
-  if (self->erro != ERR_OK) return;
-
   int opcode;
   if (pega_opcode(self, &opcode)) {
     executa_a_instrucao(self, opcode);
   }
+}
 
-  // se a CPU entrou em erro, causa uma interrupção
-  // a menos que a CPU tenha parado, porque a única forma de a CPU entrar nesse
-  //   estado é pela execução da instrução PARA em modo supervisor, e é a forma de
-  //   o SO dizer que não tem mais nada para fazer, e deve-se deixar a CPU dormindo
-  //   até que venha uma interrupção de E/S
+static void pd_referencia(cpu_t *self, int A1)
+{
+  executa_referencia(self);
+}
+
+// busca a instrução pré-decodificada no PC, com uma única tradução de endereço
+//   para o opcode e o argumento
+// a busca não marca a página como acessada, isso é feito na execução
+// retorna NULL e coloca a CPU em erro se a busca não for possível
+static instr_decod_t *busca_predecodificada(cpu_t *self)
+{
+  int endfis;
+  self->erro = traduz_pc(self, &endfis);
+  if (self->erro != ERR_OK) {
+    self->complemento = self->PC;
+    return NULL;
+  }
+  return pega_instr_decod(self, endfis);
+}
+
+// executa a instrução pré-decodificada, que foi buscada no PC
+static void executa_predecodificada(cpu_t *self, instr_decod_t *instr)
+{
+  marca_pc(self);
+  if (instr->privilegiada && self->modo != supervisor) {
+    self->erro = ERR_INSTR_PRIV;
+    return;
+  }
+  instr->executa(self, instr->A1);
+}
+
+// se a instrução colocou a CPU em erro, causa uma interrupção
+// a menos que a CPU tenha parado, porque a única forma de a CPU entrar nesse
+//   estado é pela execução da instrução PARA em modo supervisor, e é a forma de
+//   o SO dizer que não tem mais nada para fazer, e deve-se deixar a CPU dormindo
+//   até que venha uma interrupção de E/S
+static void verifica_erro(cpu_t *self)
+{
   if (self->erro != ERR_OK && self->erro != ERR_CPU_PARADA) {
     // se a interrupção não é aceita nesse ponto, temos um problema grave...
     assert(cpu_interrompe(self, IRQ_ERR_CPU));
   }
 }
 
+void cpu_executa_1(cpu_t *self)
+{
+  // não executa se CPU já estiver em erro
+  if (self->erro != ERR_OK) return;
+  utlb_confere(self);
+
+  if (self->motor != motor_referencia) {
+    instr_decod_t *instr = busca_predecodificada(self);
+    if (instr != NULL) executa_predecodificada(self, instr);
+  } else {
+    executa_referencia(self);
+  }
+
+  verifica_erro(self);
+  utlb_descarrega(self);
+}
+
+// SUPERINSTRUÇÕES {{{1
+// ---------------------------------------------------------------------
+// cada superinstrução recebe as instruções pré-decodificadas da sequência e
+//   tem o mesmo efeito que executá-las uma a uma; se uma delas causar erro,
+//   as seguintes não são executadas
+// retorna o número de instruções executadas (contando a que causou erro)
+
+typedef int (*f_fusao_t)(cpu_t *self, instr_decod_t *seq);
+
+static int fus_CHAMADA_SISTEMA(cpu_t *self, instr_decod_t *seq)
+{
+  // cargi a / trax / cargi b: o valor de A é descartado pelo segundo cargi
+  self->X = seq[0].A1;
+  self->A = seq[2].A1;
+  self->PC += 5;
+  op_CHAMAS(self);
+  return 4;
+}
+
+static int fus_SALVA_X(cpu_t *self, instr_decod_t *seq)
+{
+  op_TRAX(self);
+  pd_ARMM(self, seq[1].A1);
+  return 2;
+}
+
+static int fus_RESTAURA_X(cpu_t *self, instr_decod_t *seq)
+{
+  op_TRAX(self);
+  pd_CARGM(self, seq[1].A1);
+  if (self->erro != ERR_OK) return 2;
+  op_TRAX(self);
+  return 3;
+}
+
+static int fus_CHAMAS_IMEDIATO(cpu_t *self, instr_decod_t *seq)
+{
+  self->A = seq[0].A1;
+  self->PC += 2;
+  op_CHAMAS(self);
+  return 2;
+}
+
+static int fus_TESTA_ZERO(cpu_t *self, instr_decod_t *seq)
+{
+  pd_CARGX(self, seq[0].A1);
+  if (self->erro != ERR_OK) return 1;
+  pd_DESVZ(self, seq[1].A1);
+  return 2;
+}
+
+static int fus_INCX_DESVIA(cpu_t *self, instr_decod_t *seq)
+{
+  self->X += 1;
+  self->PC = seq[1].A1;
+  return 2;
+}
+
+#define MAX_INSTR_FUSAO 4
+
+// as superinstruções, com as sequências de opcodes que elas substituem
+// as mais longas vêm primeiro, para terem preferência
+static struct {
+  char *nome;
+  int n_instr;
+  int opcodes[MAX_INSTR_FUSAO];
+  f_fusao_t executa;
+} fusoes[N_FUSOES] = {
+  [fus_chamada_sistema] = { "cargi/trax/cargi/chamas", 4,
+                            { CARGI, TRAX, CARGI, CHAMAS }, fus_CHAMADA_SISTEMA },
+  [fus_salva_x]         = { "trax/armm", 2,
+                            { TRAX, ARMM }, fus_SALVA_X },
+  [fus_restaura_x]      = { "trax/cargm/trax", 3,
+                            { TRAX, CARGM, TRAX }, fus_RESTAURA_X },
+  [fus_chamas_imediato] = { "cargi/chamas", 2,
+                            { CARGI, CHAMAS }, fus_CHAMAS_IMEDIATO },
+  [fus_testa_zero]      = { "cargx/desvz", 2,
+                            { CARGX, DESVZ }, fus_TESTA_ZERO },
+  [fus_incx_desvia]     = { "incx/desv", 2,
+                            { INCX, DESV }, fus_INCX_DESVIA },
+};
+
+// retorna a superinstrução mais longa que corresponde ao início dos 'n'
+//   opcodes, ou -1 se nenhuma corresponder
+static int encontra_fusao(int *opcodes, int n)
+{
+  int melhor = -1;
+  for (int f = 0; f < N_FUSOES; f++) {
+    if (fusoes[f].n_instr > n) continue;
+    if (melhor != -1 && fusoes[f].n_instr <= fusoes[melhor].n_instr) continue;
+    int i;
+    for (i = 0; i < fusoes[f].n_instr; i++) {
+      if (opcodes[i] != fusoes[f].opcodes[i]) break;
+    }
+    if (i == fusoes[f].n_instr) melhor = f;
+  }
+  return melhor;
+}
+
+void cpu_imprime_fusoes(cpu_t *self, FILE *arq)
+{
+  fprintf(arq, "SUPERINSTRUÇÕES\n");
+  for (int f = 0; f < N_FUSOES; f++) {
+    fprintf(arq, "%-24s %ld\n", fusoes[f].nome, self->usos_fusao[f]);
+  }
+}
+
+// TRADUÇÃO DE BLOCOS {{{1
+
+static void cpu_cria_blocos(cpu_t *self)
+{
+  int tam_mem = mem_tam(mmu_mem(self->mmu));
+  self->blocos = malloc(N_BLOCOS * sizeof(*self->blocos));
+  assert(self->blocos != NULL);
+  for (int b = 0; b < N_BLOCOS; b++) {
+    self->blocos[b].inicio = -1;
+  }
+  self->versao_pagina = calloc((tam_mem >> self->bits_pagina) + 1,
+                               sizeof(*self->versao_pagina));
+  assert(self->versao_pagina != NULL);
+  self->em_bloco = calloc(tam_mem, sizeof(*self->em_bloco));
+  assert(self->em_bloco != NULL);
+}
+
+static void cpu_destroi_blocos(cpu_t *self)
+{
+  free(self->blocos);
+  free(self->versao_pagina);
+  free(self->em_bloco);
+}
+
+// retorna true se a instrução termina um bloco, por poder alterar o PC de
+//   forma diferente de avançar para a próxima instrução
+static bool instrucao_termina_bloco(int opcode)
+{
+  switch (opcode) {
+    case DESV: case DESVZ: case DESVNZ: case DESVN: case DESVP:
+    case CHAMA: case RET: case CHAMAS:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// traduz o bloco que começa no endereço físico bloco->inicio
+// o bloco vai até uma instrução que altera o fluxo de execução, o final da
+//   página ou MAX_INSTR_BLOCO instruções; não entram no bloco instruções
+//   privilegiadas, de E/S ou que precisam do motor de referência, que são
+//   executadas uma a uma no laço principal
+static void traduz_bloco(cpu_t *self, bloco_t *bloco)
+{
+  mem_t *mem = mmu_mem(self->mmu);
+  int endfis = bloco->inicio;
+  int opcodes[MAX_INSTR_BLOCO];
+  bloco->n_instr = 0;
+  bloco->traduzido = true;
+  bloco->versao = self->versao_pagina[endfis >> self->bits_pagina];
+  while (bloco->n_instr < MAX_INSTR_BLOCO) {
+    instr_decod_t *instr = pega_instr_decod(self, endfis);
+    if (instr->privilegiada || instr->es
+        || instr->executa == pd_referencia || instr->executa == pd_invalida) {
+      break;
+    }
+    int opcode;
+    mem_le(mem, endfis, &opcode);
+    int tam = 1 + instrucao_num_args(opcode);
+    opcodes[bloco->n_instr] = opcode;
+    bloco->instr[bloco->n_instr++] = *instr;
+    for (int i = 0; i < tam; i++) {
+      self->em_bloco[endfis + i] = true;
+    }
+    endfis += tam;
+    if (instrucao_termina_bloco(opcode) || (endfis & self->mascara_pagina) == 0
+        || endfis >= mem_tam(mem)) {
+      break;
+    }
+  }
+  for (int i = 0; i < bloco->n_instr; i++) {
+    bloco->fusao[i] = encontra_fusao(&opcodes[i], bloco->n_instr - i);
+  }
+  bloco->nativo = NULL;
+  if (self->motor == motor_jit && self->nativo != NULL && bloco->n_instr > 0) {
+    compila_bloco(self, bloco, opcodes);
+  }
+}
+
+// retorna o bloco traduzido que começa no endereço físico 'endfis', ou NULL
+//   se ele ainda não foi executado vezes suficientes para ser traduzido
+static bloco_t *pega_bloco(cpu_t *self, int endfis)
+{
+  bloco_t *bloco = &self->blocos[endfis % N_BLOCOS];
+  int versao = self->versao_pagina[endfis >> self->bits_pagina];
+  if (bloco->inicio != endfis) {
+    bloco->inicio = endfis;
+    bloco->execucoes = 0;
+    bloco->traduzido = false;
+    bloco->nativo = NULL;
+  } else if (bloco->traduzido && bloco->versao != versao) {
+    // a página foi alterada desde a tradução; o bloco já era usado, então
+    //   é traduzido de novo imediatamente
+    traduz_bloco(self, bloco);
+  }
+  if (!bloco->traduzido) {
+    if (++bloco->execucoes < LIMIAR_TRADUCAO) return NULL;
+    traduz_bloco(self, bloco);
+  }
+  if (bloco->n_instr == 0) return NULL;
+  return bloco;
+}
+
+// soma ao tempo de espera o que a MMU cobrou pelas faltas na TLB
+static void atualiza_espera(cpu_t *self)
+{
+  self->espera += mmu_ciclos_extras(self->mmu);
+}
+
+// executa instruções do bloco, que começa no PC, enquanto o tempo gasto
+//   (instruções mais espera pela TLB) for menor que 'max'
+// para antes do breakpoint, depois de uma instrução que cause erro ou
+//   interrupção ou que altere o próprio bloco
+// as superinstruções só são usadas se couberem inteiras em 'max' e não houver
+//   breakpoint definido nem espera a contar, e só podem alterar a memória na
+//   última instrução
+// retorna o número de instruções executadas
+static int executa_bloco(cpu_t *self, bloco_t *bloco, int max)
+{
+  // todas as instruções do bloco estão na mesma página
+  marca_pc(self);
+  if (bloco->nativo != NULL && self->motor == motor_jit
+      && bloco->n_instr <= max && self->breakpoint == -1
+      && !self->conta_espera) {
+    int n = bloco->nativo(self, max);
+    verifica_erro(self);
+    return n;
+  }
+  int pagina = bloco->inicio >> self->bits_pagina;
+  int n_instr = bloco->n_instr < max ? bloco->n_instr : max;
+  int espera = self->espera;
+  int n = 0;
+  while (n < n_instr) {
+    if (n > 0 && self->PC == self->breakpoint) break;
+    instr_decod_t *instr = &bloco->instr[n];
+    int f = bloco->fusao[n];
+    if (f != -1 && self->breakpoint == -1 && !self->conta_espera
+        && n + fusoes[f].n_instr <= n_instr) {
+      self->usos_fusao[f]++;
+      n += fusoes[f].executa(self, instr);
+    } else {
+      instr->executa(self, instr->A1);
+      n++;
+    }
+    if (self->conta_espera) atualiza_espera(self);
+    if (self->erro != ERR_OK) {
+      verifica_erro(self);
+      break;
+    }
+    if (self->interrompida) break;
+    if (bloco->versao != self->versao_pagina[pagina]) break;
+    if (n + self->espera - espera >= max) break;
+  }
+  return n;
+}
+
+// CÓDIGO NATIVO {{{1
+// ---------------------------------------------------------------------
+// o motor jit compila cada bloco traduzido para código x86-64, que faz o
+//   mesmo que executa_bloco para um bloco que cabe inteiro em 'max'
+//   instruções, sem breakpoint nem espera a contar (senão, executa_bloco
+//   interpreta o bloco)
+// no código gerado, rbx aponta para a CPU, r12d conta as instruções
+//   executadas e r13d é o máximo de instruções; o PC na CPU é atualizado só
+//   antes das funções em C que o usam e na saída
+// as instruções que só usam A, X e o PC são geradas em linha; as leituras
+//   e escritas na memória acessam em linha o quadro da entrada de dados da
+//   micro-TLB, e chamam as funções do motor pré-decodificado se a página não
+//   estiver nela; as demais instruções também chamam essas funções
+// no final do bloco, se a página do novo PC estiver na entrada de código da
+//   micro-TLB (ou na anterior) e o bloco que começa nele estiver compilado,
+//   atualizado e couber no que falta de 'max', o código conta o acerto na
+//   micro-TLB e desvia diretamente para o bloco, sem voltar para
+//   cpu_executa_n
+
+#ifdef CPU_JIT_X86_64
+
+// tamanho do buffer de código nativo; quando enche, o código de todos os
+//   blocos é descartado e o buffer é reutilizado desde o início
+// nenhum endereço do buffer pode ser alterado e executado: ele é mapeado
+//   duas vezes, uma só para escrita e outra só para execução; o código gerado
+//   não depende de onde está (os desvios dentro dele são relativos, e as
+//   funções em C são chamadas pelo endereço absoluto)
+#define TAM_NATIVO (1 << 20)
+
+// onde o código está sendo gerado
+typedef struct {
+  unsigned char *p;
+  unsigned char *fim;
+  // deslocamento (desde o início do bloco) até onde o PC está atualizado
+  int pc_atualizado;
+} emissor_t;
+
+// deslocamentos na CPU, para o endereçamento relativo a rbx
+#define CAMPO(c) ((int)offsetof(cpu_t, c))
+#define CAMPO_UTLB(u, c) (CAMPO(u) + (int)offsetof(micro_tlb_t, c))
+
+static void emite(emissor_t *e, int n, const unsigned char bytes[n])
+{
+  if (e->p + n > e->fim) {
+    e->p = e->fim + 1;
+    return;
+  }
+  memcpy(e->p, bytes, n);
+  e->p += n;
+}
+
+static void emite_32(emissor_t *e, int32_t v)
+{
+  emite(e, 4, (unsigned char *)&v);
+}
+
+static void emite_64(emissor_t *e, int64_t v)
+{
+  emite(e, 8, (unsigned char *)&v);
+}
+
+// emite uma instrução com um operando '[rbx+campo]' (modrm com base rbx e
+//   deslocamento de 32 bits); 'reg' é o campo reg do modrm
+static void emite_rbx(emissor_t *e, int n, const unsigned char op[n], int reg,
+                      int campo)
+{
+  emite(e, n, op);
+  emite(e, 1, (unsigned char[]){ 0x83 | (reg << 3) });
+  emite_32(e, campo);
+}
+
+// emite um desvio com deslocamento de 32 bits e retorna a posição do
+//   deslocamento, para ser corrigido com corrige_desvio
+static unsigned char *emite_desvio(emissor_t *e, int n,
+                                   const unsigned char op[n])
+{
+  emite(e, n, op);
+  unsigned char *pos = e->p;
+  emite_32(e, 0);
+  return pos;
+}
+
+// faz o desvio em 'pos' ir para a posição atual
+static void corrige_desvio(emissor_t *e, unsigned char *pos)
+{
+  if (e->p > e->fim) return;
+  int32_t desl = e->p - (pos + 4);
+  memcpy(pos, &desl, 4);
+}
+
+// prólogo, chamado de executa_bloco como f_bloco_nativo_t
+static void emite_prologo(emissor_t *e)
+{
+  emite(e, 1, (unsigned char[]){ 0x53 });                   // push rbx
+  emite(e, 2, (unsigned char[]){ 0x41, 0x54 });             // push r12
+  emite(e, 2, (unsigned char[]){ 0x41, 0x55 });             // push r13
+  emite(e, 4, (unsigned char[]){ 0x48, 0x83, 0xec, 0x10 }); // sub rsp,16
+  emite(e, 3, (unsigned char[]){ 0x48, 0x89, 0xfb });       // mov rbx,rdi
+  emite(e, 3, (unsigned char[]){ 0x45, 0x31, 0xe4 });       // xor r12d,r12d
+  emite(e, 3, (unsigned char[]){ 0x41, 0x89, 0xf5 });       // mov r13d,esi
+}
+
+// tamanho do prólogo; um bloco encadeado é executado a partir daí
+#define TAM_PROLOGO 18
+
+// atualiza o PC na CPU até o deslocamento 'desl' do bloco, sem alterar o
+//   estado do emissor
+static void emite_soma_pc(emissor_t *e, int desl)
+{
+  if (desl == e->pc_atualizado) return;
+  emite_rbx(e, 1, (unsigned char[]){ 0x81 }, 0, CAMPO(PC)); // add [PC],imm
+  emite_32(e, desl - e->pc_atualizado);
+}
+
+static void atualiza_pc(emissor_t *e, int desl)
+{
+  emite_soma_pc(e, desl);
+  e->pc_atualizado = desl;
+}
+
+// soma 'n' ao contador de instruções e retorna o contador
+static void emite_retorno(emissor_t *e, int n)
+{
+  emite(e, 3, (unsigned char[]){ 0x41, 0x81, 0xc4 });       // add r12d,n
+  emite_32(e, n);
+  emite(e, 3, (unsigned char[]){ 0x44, 0x89, 0xe0 });       // mov eax,r12d
+  emite(e, 4, (unsigned char[]){ 0x48, 0x83, 0xc4, 0x10 }); // add rsp,16
+  emite(e, 2, (unsigned char[]){ 0x41, 0x5d });             // pop r13
+  emite(e, 2, (unsigned char[]){ 0x41, 0x5c });             // pop r12
+  emite(e, 1, (unsigned char[]){ 0x5b });                   // pop rbx
+  emite(e, 1, (unsigned char[]){ 0xc3 });                   // ret
+}
+
+// retorna depois de 'n' instruções, com o PC no deslocamento 'desl'
+static void emite_saida(emissor_t *e, int desl, int n)
+{
+  emite_soma_pc(e, desl);
+  emite_retorno(e, n);
+}
+
+// chama a função 'f', com os argumentos já nos registradores
+static void emite_chama(emissor_t *e, void *f)
+{
+  emite(e, 2, (unsigned char[]){ 0x48, 0xb8 });             // mov rax,f
+  emite_64(e, (int64_t)(intptr_t)f);
+  emite(e, 2, (unsigned char[]){ 0xff, 0xd0 });             // call rax
+}
+
+// chama a função 'f(self, A1)'; se 'resultado', coloca em rdx o endereço
+//   para o resultado da leitura de pega_mem, e o endereço vem em ecx
+static void emite_chamada(emissor_t *e, void *f, int A1, bool resultado)
+{
+  emite(e, 3, (unsigned char[]){ 0x48, 0x89, 0xdf });       // mov rdi,rbx
+  if (resultado) {
+    emite(e, 2, (unsigned char[]){ 0x89, 0xce });           // mov esi,ecx
+    emite(e, 3, (unsigned char[]){ 0x48, 0x89, 0xe2 });     // mov rdx,rsp
+  } else {
+    emite(e, 1, (unsigned char[]){ 0xbe });                 // mov esi,A1
+    emite_32(e, A1);
+  }
+  emite_chama(e, f);
+}
+
+// sai se a CPU estiver em erro, depois da instrução 'i'
+static void emite_testa_erro(emissor_t *e, int i)
+{
+  emite_rbx(e, 1, (unsigned char[]){ 0x81 }, 7, CAMPO(erro)); // cmp [erro],0
+  emite_32(e, ERR_OK);
+  unsigned char *ok = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x84 });
+  emite_retorno(e, i + 1);
+  corrige_desvio(e, ok);
+}
+
+// sai se a página do bloco foi alterada, depois da instrução 'i', com o PC
+//   no deslocamento 'desl'
+static void emite_testa_versao(emissor_t *e, bloco_t *bloco, int pagina, int i,
+                               int desl)
+{
+  // mov rsi,[versao_pagina]; cmp [rsi+4*pagina],versao
+  emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8b }, 6, CAMPO(versao_pagina));
+  emite(e, 2, (unsigned char[]){ 0x81, 0xbe });
+  emite_32(e, pagina * (int)sizeof(int));
+  emite_32(e, bloco->versao);
+  unsigned char *ok = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x84 });
+  emite_saida(e, desl, i + 1);
+  corrige_desvio(e, ok);
+}
+
+// lê para eax o valor da memória no endereço que está em ecx (ou em 'A1', se
+//   'constante'), como pega_mem; se a leitura não for possível, sai antes da
+//   instrução 'i', que está no deslocamento 'desl'
+static void emite_leitura(cpu_t *self, emissor_t *e, int A1, bool constante,
+                          int i, int desl)
+{
+  unsigned char *lento[4];
+  int n_lento = 0;
+  if (constante && A1 < 0) {
+    // o acesso vai ser feito (e vai falhar) em pega_mem
+    emite(e, 1, (unsigned char[]){ 0xb9 });                 // mov ecx,A1
+    emite_32(e, A1);
+  } else {
+    if (constante) {
+      emite(e, 1, (unsigned char[]){ 0xb9 });               // mov ecx,A1
+      emite_32(e, A1);
+      // cmp [utlb.pagina],A1>>bits
+      emite_rbx(e, 1, (unsigned char[]){ 0x81 }, 7, CAMPO_UTLB(utlb_dados, pagina));
+      emite_32(e, A1 >> self->bits_pagina);
+      lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+    } else {
+      emite(e, 2, (unsigned char[]){ 0x85, 0xc9 });         // test ecx,ecx
+      lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x88 });
+      emite(e, 2, (unsigned char[]){ 0x89, 0xc8 });         // mov eax,ecx
+      emite(e, 2, (unsigned char[]){ 0xc1, 0xe8 });         // shr eax,bits
+      emite(e, 1, (unsigned char[]){ self->bits_pagina });
+      // cmp eax,[utlb.pagina]
+      emite_rbx(e, 1, (unsigned char[]){ 0x3b }, 0, CAMPO_UTLB(utlb_dados, pagina));
+      lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+    }
+    // mov eax,[modo]; cmp eax,[utlb.modo]
+    emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 0, CAMPO(modo));
+    emite_rbx(e, 1, (unsigned char[]){ 0x3b }, 0, CAMPO_UTLB(utlb_dados, modo));
+    lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+    // acerto na micro-TLB, como em utlb_traduz
+    // inc [utlb.acertos]; lea rax,[utlb]; mov [utlb_ultima],rax
+    emite_rbx(e, 1, (unsigned char[]){ 0xff }, 0, CAMPO_UTLB(utlb_dados, acertos));
+    emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8d }, 0, CAMPO(utlb_dados));
+    emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x89 }, 0, CAMPO(utlb_ultima));
+    // mov rax,[utlb.quadro]
+    emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8b }, 0, CAMPO_UTLB(utlb_dados, quadro));
+    if (constante) {
+      // mov eax,[rax+4*deslocamento]
+      emite(e, 2, (unsigned char[]){ 0x8b, 0x80 });
+      emite_32(e, (A1 & self->mascara_pagina) * (int)sizeof(int));
+    } else {
+      emite(e, 2, (unsigned char[]){ 0x81, 0xe1 });         // and ecx,mascara
+      emite_32(e, self->mascara_pagina);
+      emite(e, 3, (unsigned char[]){ 0x8b, 0x04, 0x88 });   // mov eax,[rax+4*rcx]
+    }
+    unsigned char *feito = emite_desvio(e, 1, (unsigned char[]){ 0xe9 });
+    for (int k = 0; k < n_lento; k++) corrige_desvio(e, lento[k]);
+    n_lento = 0;
+    lento[n_lento++] = feito;
+  }
+  emite_chamada(e, pega_mem, 0, true);
+  emite(e, 2, (unsigned char[]){ 0x84, 0xc0 });             // test al,al
+  unsigned char *ok = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+  emite_saida(e, desl, i + 1);
+  corrige_desvio(e, ok);
+  emite(e, 3, (unsigned char[]){ 0x8b, 0x04, 0x24 });       // mov eax,[rsp]
+  for (int k = 0; k < n_lento; k++) corrige_desvio(e, lento[k]);
+}
+
+// executa ARMM, ARMX ou CHAMA, a instrução 'i' do bloco, no deslocamento
+//   'desl'; a escrita é feita em linha no quadro da entrada de dados da
+//   micro-TLB, se a página estiver nela e já estiver marcada como alterada,
+//   e a memória é avisada com cpu_memoria_alterada, como em mem_escreve;
+//   senão, é chamada a função do motor pré-decodificado
+static void emite_escrita(cpu_t *self, emissor_t *e, instr_decod_t *instr,
+                          int opcode, int i, int desl, int tam)
+{
+  int A1 = instr->A1;
+  bool constante = (opcode != ARMX);
+  unsigned char *lento[4];
+  int n_lento = 0;
+  unsigned char *feito = NULL;
+  if (!constante || A1 >= 0) {
+    // edx = valor a escrever
+    if (opcode == CHAMA) {
+      // mov edx,[PC]; add edx,deslocamento de PC+2
+      emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 2, CAMPO(PC));
+      emite(e, 2, (unsigned char[]){ 0x81, 0xc2 });
+      emite_32(e, desl + 2 - e->pc_atualizado);
+    } else {
+      emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 2, CAMPO(A)); // mov edx,[A]
+    }
+    if (constante) {
+      // cmp [utlb.pagina],A1>>bits
+      emite_rbx(e, 1, (unsigned char[]){ 0x81 }, 7, CAMPO_UTLB(utlb_dados, pagina));
+      emite_32(e, A1 >> self->bits_pagina);
+      lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+    } else {
+      emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 1, CAMPO(X)); // mov ecx,[X]
+      emite(e, 2, (unsigned char[]){ 0x81, 0xc1 });            // add ecx,A1
+      emite_32(e, A1);
+      emite(e, 2, (unsigned char[]){ 0x85, 0xc9 });            // test ecx,ecx
+      lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x88 });
+      emite(e, 2, (unsigned char[]){ 0x89, 0xc8 });            // mov eax,ecx
+      emite(e, 2, (unsigned char[]){ 0xc1, 0xe8 });            // shr eax,bits
+      emite(e, 1, (unsigned char[]){ self->bits_pagina });
+      // cmp eax,[utlb.pagina]
+      emite_rbx(e, 1, (unsigned char[]){ 0x3b }, 0, CAMPO_UTLB(utlb_dados, pagina));
+      lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+    }
+    // mov eax,[modo]; cmp eax,[utlb.modo]
+    emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 0, CAMPO(modo));
+    emite_rbx(e, 1, (unsigned char[]){ 0x3b }, 0, CAMPO_UTLB(utlb_dados, modo));
+    lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+    // cmp byte [utlb.alterada],0
+    emite_rbx(e, 1, (unsigned char[]){ 0x80 }, 7, CAMPO_UTLB(utlb_dados, alterada));
+    emite(e, 1, (unsigned char[]){ 0 });
+    lento[n_lento++] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x84 });
+    // acerto na micro-TLB, como em utlb_traduz
+    // inc [utlb.acertos]; lea rax,[utlb]; mov [utlb_ultima],rax
+    emite_rbx(e, 1, (unsigned char[]){ 0xff }, 0, CAMPO_UTLB(utlb_dados, acertos));
+    emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8d }, 0, CAMPO(utlb_dados));
+    emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x89 }, 0, CAMPO(utlb_ultima));
+    // mov esi,[utlb.end_quadro]; mov rax,[utlb.quadro]
+    emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 6, CAMPO_UTLB(utlb_dados, end_quadro));
+    emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8b }, 0, CAMPO_UTLB(utlb_dados, quadro));
+    if (constante) {
+      int deslocamento = A1 & self->mascara_pagina;
+      // mov [rax+4*deslocamento],edx; add esi,deslocamento
+      emite(e, 2, (unsigned char[]){ 0x89, 0x90 });
+      emite_32(e, deslocamento * (int)sizeof(int));
+      emite(e, 2, (unsigned char[]){ 0x81, 0xc6 });
+      emite_32(e, deslocamento);
+    } else {
+      emite(e, 2, (unsigned char[]){ 0x81, 0xe1 });            // and ecx,mascara
+      emite_32(e, self->mascara_pagina);
+      emite(e, 3, (unsigned char[]){ 0x89, 0x14, 0x88 });      // mov [rax+4*rcx],edx
+      emite(e, 2, (unsigned char[]){ 0x01, 0xce });            // add esi,ecx
+    }
+    // cpu_memoria_alterada(self, endereço físico, 1)
+    emite(e, 3, (unsigned char[]){ 0x48, 0x89, 0xdf });       // mov rdi,rbx
+    emite(e, 1, (unsigned char[]){ 0xba });                   // mov edx,1
+    emite_32(e, 1);
+    emite_chama(e, cpu_memoria_alterada);
+    if (opcode == CHAMA) {
+      emite_rbx(e, 1, (unsigned char[]){ 0xc7 }, 0, CAMPO(PC)); // mov [PC],A1+1
+      emite_32(e, A1 + 1);
+    }
+    feito = emite_desvio(e, 1, (unsigned char[]){ 0xe9 });
+    for (int k = 0; k < n_lento; k++) corrige_desvio(e, lento[k]);
+  }
+  // a função altera o PC; o de ARMM e ARMX volta para onde estava, para
+  //   ficar igual ao do caminho em linha
+  emite_soma_pc(e, desl);
+  emite_chamada(e, instr->executa, A1, false);
+  emite_testa_erro(e, i);
+  int pc = e->pc_atualizado;
+  e->pc_atualizado = desl + tam;
+  if (opcode != CHAMA) {
+    emite_soma_pc(e, pc);
+    e->pc_atualizado = pc;
+  }
+  if (feito != NULL) corrige_desvio(e, feito);
+}
+
+// traz a página do PC para a entrada de código da micro-TLB, se ela for a
+//   página de código anterior (ver utlb_procura); chamada no encadeamento
+static bool utlb_procura_pc(cpu_t *self)
+{
+  return utlb_procura(self, &self->utlb_codigo, self->PC);
+}
+
+// fim do bloco, com o PC atualizado e 'n' instruções executadas: desvia
+//   para o bloco no novo PC, se possível, ou retorna
+// faz o mesmo que cpu_executa_n faria: se a página do PC está na entrada de
+//   código da micro-TLB (ou na anterior, que volta para ela), traduz_pc
+//   acerta nela e marca_pc não faz nada
+static void emite_encadeamento(cpu_t *self, emissor_t *e, int n)
+{
+  unsigned char *sai[7];
+  emite(e, 3, (unsigned char[]){ 0x41, 0x81, 0xc4 });       // add r12d,n
+  emite_32(e, n);
+  // a página do novo PC tem que estar na entrada de código da micro-TLB
+  emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 0, CAMPO(PC)); // mov eax,[PC]
+  emite(e, 2, (unsigned char[]){ 0x85, 0xc0 });             // test eax,eax
+  sai[0] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x88 });
+  emite(e, 2, (unsigned char[]){ 0x89, 0xc1 });             // mov ecx,eax
+  emite(e, 2, (unsigned char[]){ 0xc1, 0xe9 });             // shr ecx,bits
+  emite(e, 1, (unsigned char[]){ self->bits_pagina });
+  // cmp ecx,[utlb.pagina]
+  emite_rbx(e, 1, (unsigned char[]){ 0x3b }, 1, CAMPO_UTLB(utlb_codigo, pagina));
+  unsigned char *mesma = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x84 });
+  // ou estar na página de código anterior
+  emite(e, 3, (unsigned char[]){ 0x48, 0x89, 0xdf });       // mov rdi,rbx
+  emite_chama(e, utlb_procura_pc);
+  emite(e, 2, (unsigned char[]){ 0x84, 0xc0 });             // test al,al
+  sai[1] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x84 });
+  emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 0, CAMPO(PC)); // mov eax,[PC]
+  corrige_desvio(e, mesma);
+  // mov edx,[modo]; cmp edx,[utlb.modo]
+  emite_rbx(e, 1, (unsigned char[]){ 0x8b }, 2, CAMPO(modo));
+  emite_rbx(e, 1, (unsigned char[]){ 0x3b }, 2, CAMPO_UTLB(utlb_codigo, modo));
+  sai[2] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+  // eax = endereço físico do novo PC
+  emite(e, 1, (unsigned char[]){ 0x25 });                   // and eax,mascara
+  emite_32(e, self->mascara_pagina);
+  // add eax,[utlb.end_quadro]
+  emite_rbx(e, 1, (unsigned char[]){ 0x03 }, 0,
+            CAMPO_UTLB(utlb_codigo, end_quadro));
+  // rdx = &self->blocos[eax % N_BLOCOS]
+  emite(e, 2, (unsigned char[]){ 0x89, 0xc1 });             // mov ecx,eax
+  emite(e, 2, (unsigned char[]){ 0x81, 0xe1 });             // and ecx,N_BLOCOS-1
+  emite_32(e, N_BLOCOS - 1);
+  emite(e, 2, (unsigned char[]){ 0x69, 0xc9 });             // imul ecx,ecx,tam
+  emite_32(e, sizeof(bloco_t));
+  emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8b }, 2, CAMPO(blocos));
+  emite(e, 3, (unsigned char[]){ 0x48, 0x01, 0xca });       // add rdx,rcx
+  // cmp eax,[rdx+inicio]
+  emite(e, 2, (unsigned char[]){ 0x3b, 0x82 });
+  emite_32(e, offsetof(bloco_t, inicio));
+  sai[3] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+  // a tradução tem que ser da versão atual da página
+  emite(e, 2, (unsigned char[]){ 0x89, 0xc1 });             // mov ecx,eax
+  emite(e, 2, (unsigned char[]){ 0xc1, 0xe9 });             // shr ecx,bits
+  emite(e, 1, (unsigned char[]){ self->bits_pagina });
+  // mov rsi,[versao_pagina]; mov ecx,[rsi+4*rcx]; cmp ecx,[rdx+versao]
+  emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8b }, 6, CAMPO(versao_pagina));
+  emite(e, 3, (unsigned char[]){ 0x8b, 0x0c, 0x8e });
+  emite(e, 2, (unsigned char[]){ 0x3b, 0x8a });
+  emite_32(e, offsetof(bloco_t, versao));
+  sai[4] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x85 });
+  // mov rax,[rdx+nativo]; test rax,rax
+  emite(e, 3, (unsigned char[]){ 0x48, 0x8b, 0x82 });
+  emite_32(e, offsetof(bloco_t, nativo));
+  emite(e, 3, (unsigned char[]){ 0x48, 0x85, 0xc0 });
+  sai[5] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x84 });
+  // o bloco tem que caber no que falta: r13d - r12d >= n_instr
+  emite(e, 3, (unsigned char[]){ 0x44, 0x89, 0xe9 });       // mov ecx,r13d
+  emite(e, 3, (unsigned char[]){ 0x44, 0x29, 0xe1 });       // sub ecx,r12d
+  emite(e, 2, (unsigned char[]){ 0x3b, 0x8a });             // cmp ecx,[rdx+n_instr]
+  emite_32(e, offsetof(bloco_t, n_instr));
+  sai[6] = emite_desvio(e, 2, (unsigned char[]){ 0x0f, 0x8c });
+  // acerto na micro-TLB, como em traduz_pc
+  // inc [utlb.acertos]; lea rcx,[utlb]; mov [utlb_ultima],rcx
+  emite_rbx(e, 1, (unsigned char[]){ 0xff }, 0,
+            CAMPO_UTLB(utlb_codigo, acertos));
+  emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x8d }, 1, CAMPO(utlb_codigo));
+  emite_rbx(e, 2, (unsigned char[]){ 0x48, 0x89 }, 1, CAMPO(utlb_ultima));
+  // jmp rax+TAM_PROLOGO
+  emite(e, 4, (unsigned char[]){ 0x48, 0x83, 0xc0, TAM_PROLOGO });
+  emite(e, 2, (unsigned char[]){ 0xff, 0xe0 });
+  for (int k = 0; k < 7; k++) corrige_desvio(e, sai[k]);
+  emite_retorno(e, 0);
+}
+
+static void cpu_cria_nativo(cpu_t *self)
+{
+  // sem o buffer, o motor jit funciona como o de blocos
+  self->nativo = NULL;
+  self->nativo_usado = 0;
+  int fd = memfd_create("cpu_jit", MFD_CLOEXEC);
+  if (fd < 0) return;
+  void *escrita = MAP_FAILED, *execucao = MAP_FAILED;
+  if (ftruncate(fd, TAM_NATIVO) == 0) {
+    escrita = mmap(NULL, TAM_NATIVO, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    execucao = mmap(NULL, TAM_NATIVO, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (escrita != MAP_FAILED && execucao != MAP_FAILED) {
+    self->nativo = escrita;
+    self->nativo_exec = execucao;
+    return;
+  }
+  if (escrita != MAP_FAILED) munmap(escrita, TAM_NATIVO);
+  if (execucao != MAP_FAILED) munmap(execucao, TAM_NATIVO);
+}
+
+static void cpu_destroi_nativo(cpu_t *self)
+{
+  if (self->nativo != NULL) {
+    munmap(self->nativo, TAM_NATIVO);
+    munmap(self->nativo_exec, TAM_NATIVO);
+  }
+}
+
+// gera o código nativo do bloco a partir de 'inicio', sem passar de 'fim'
+// retorna o fim do código gerado, ou NULL se não couber
+static unsigned char *gera_codigo(cpu_t *self, bloco_t *bloco, int opcodes[],
+                                  unsigned char *inicio, unsigned char *fim)
+{
+  emissor_t e = { .p = inicio, .fim = fim, .pc_atualizado = 0 };
+  int pagina = bloco->inicio >> self->bits_pagina;
+  emite_prologo(&e);
+  assert(e.p > e.fim || e.p - inicio == TAM_PROLOGO);
+  int desl = 0;
+  bool encadeia = true;
+  for (int i = 0; i < bloco->n_instr; i++) {
+    instr_decod_t *instr = &bloco->instr[i];
+    int A1 = instr->A1;
+    int tam = 1 + instrucao_num_args(opcodes[i]);
+    switch (opcodes[i]) {
+      case NOP:
+        break;
+      case CARGI:
+        emite_rbx(&e, 1, (unsigned char[]){ 0xc7 }, 0, CAMPO(A)); // mov [A],A1
+        emite_32(&e, A1);
+        break;
+      case TRAX:
+        emite_rbx(&e, 1, (unsigned char[]){ 0x8b }, 0, CAMPO(A)); // mov eax,[A]
+        emite_rbx(&e, 1, (unsigned char[]){ 0x8b }, 1, CAMPO(X)); // mov ecx,[X]
+        emite_rbx(&e, 1, (unsigned char[]){ 0x89 }, 1, CAMPO(A)); // mov [A],ecx
+        emite_rbx(&e, 1, (unsigned char[]){ 0x89 }, 0, CAMPO(X)); // mov [X],eax
+        break;
+      case CPXA:
+        emite_rbx(&e, 1, (unsigned char[]){ 0x8b }, 0, CAMPO(X)); // mov eax,[X]
+        emite_rbx(&e, 1, (unsigned char[]){ 0x89 }, 0, CAMPO(A)); // mov [A],eax
+        break;
+      case INCX:
+        emite_rbx(&e, 1, (unsigned char[]){ 0xff }, 0, CAMPO(X)); // inc [X]
+        break;
+      case NEG:
+        emite_rbx(&e, 1, (unsigned char[]){ 0xf7 }, 3, CAMPO(A)); // neg [A]
+        break;
+      case CARGM: case CARGX: case SOMA: case SUB: case MULT: case DIV:
+      case RESTO:
+        if (opcodes[i] == CARGX) {
+          emite_rbx(&e, 1, (unsigned char[]){ 0x8b }, 1, CAMPO(X)); // mov ecx,[X]
+          emite(&e, 2, (unsigned char[]){ 0x81, 0xc1 });            // add ecx,A1
+          emite_32(&e, A1);
+        }
+        emite_leitura(self, &e, A1, opcodes[i] != CARGX, i, desl);
+        if (opcodes[i] == SOMA) {
+          emite_rbx(&e, 1, (unsigned char[]){ 0x01 }, 0, CAMPO(A)); // add [A],eax
+        } else if (opcodes[i] == SUB) {
+          emite_rbx(&e, 1, (unsigned char[]){ 0x29 }, 0, CAMPO(A)); // sub [A],eax
+        } else if (opcodes[i] == MULT) {
+          // imul eax,[A]; mov [A],eax
+          emite_rbx(&e, 2, (unsigned char[]){ 0x0f, 0xaf }, 0, CAMPO(A));
+          emite_rbx(&e, 1, (unsigned char[]){ 0x89 }, 0, CAMPO(A));
+        } else if (opcodes[i] == DIV || opcodes[i] == RESTO) {
+          // mov ecx,eax; mov eax,[A]; cdq; idiv ecx; mov [A],eax (ou edx)
+          emite(&e, 2, (unsigned char[]){ 0x89, 0xc1 });
+          emite_rbx(&e, 1, (unsigned char[]){ 0x8b }, 0, CAMPO(A));
+          emite(&e, 1, (unsigned char[]){ 0x99 });
+          emite(&e, 2, (unsigned char[]){ 0xf7, 0xf9 });
+          emite_rbx(&e, 1, (unsigned char[]){ 0x89 }, opcodes[i] == DIV ? 0 : 2,
+                    CAMPO(A));
+        } else {
+          emite_rbx(&e, 1, (unsigned char[]){ 0x89 }, 0, CAMPO(A)); // mov [A],eax
+        }
+        break;
+      case RET:
+        emite_leitura(self, &e, A1, true, i, desl);
+        emite_rbx(&e, 1, (unsigned char[]){ 0x89 }, 0, CAMPO(PC)); // mov [PC],eax
+        e.pc_atualizado = desl + tam;
+        break;
+      case ARMM: case ARMX: case CHAMA:
+        emite_escrita(self, &e, instr, opcodes[i], i, desl, tam);
+        emite_testa_versao(&e, bloco, pagina, i, desl + tam);
+        break;
+      case DESV:
+        emite_rbx(&e, 1, (unsigned char[]){ 0xc7 }, 0, CAMPO(PC)); // mov [PC],A1
+        emite_32(&e, A1);
+        e.pc_atualizado = desl + tam;
+        break;
+      case DESVZ: case DESVNZ: case DESVN: case DESVP: {
+        // desvio com a condição contrária, para não alterar o PC
+        unsigned char cond;
+        switch (opcodes[i]) {
+          case DESVZ:  cond = 0x85; break; // jne
+          case DESVNZ: cond = 0x84; break; // je
+          case DESVN:  cond = 0x8d; break; // jge
+          default:     cond = 0x8e; break; // jle
+        }
+        atualiza_pc(&e, desl + tam);
+        emite_rbx(&e, 1, (unsigned char[]){ 0x81 }, 7, CAMPO(A)); // cmp [A],0
+        emite_32(&e, 0);
+        unsigned char *segue = emite_desvio(&e, 2, (unsigned char[]){ 0x0f, cond });
+        emite_rbx(&e, 1, (unsigned char[]){ 0xc7 }, 0, CAMPO(PC)); // mov [PC],A1
+        emite_32(&e, A1);
+        corrige_desvio(&e, segue);
+        break;
+      }
+      default:
+        // as demais chamam a função do motor pré-decodificado, que altera o PC
+        atualiza_pc(&e, desl);
+        emite_chamada(&e, instr->executa, A1, false);
+        if (opcodes[i] == CHAMAS) {
+          // a CPU aceitou a interrupção
+          encadeia = false;
+          break;
+        }
+        emite_testa_erro(&e, i);
+        e.pc_atualizado = desl + tam;
+        break;
+    }
+    desl += tam;
+  }
+  if (encadeia) {
+    atualiza_pc(&e, desl);
+    emite_encadeamento(self, &e, bloco->n_instr);
+  } else {
+    emite_retorno(&e, bloco->n_instr);
+  }
+  return e.p <= e.fim ? e.p : NULL;
+}
+
+// compila o bloco, na parte livre do buffer
+static void compila_bloco(cpu_t *self, bloco_t *bloco, int opcodes[])
+{
+  unsigned char *fim_buffer = self->nativo + TAM_NATIVO;
+  unsigned char *inicio = self->nativo + self->nativo_usado;
+  unsigned char *fim = gera_codigo(self, bloco, opcodes, inicio, fim_buffer);
+  if (fim == NULL) {
+    // o buffer encheu; nenhum código nativo está em execução (a compilação
+    //   é feita em cpu_executa_n), então pode ser todo descartado
+    for (int b = 0; b < N_BLOCOS; b++) self->blocos[b].nativo = NULL;
+    self->nativo_usado = 0;
+    inicio = self->nativo;
+    fim = gera_codigo(self, bloco, opcodes, inicio, fim_buffer);
+  }
+  if (fim == NULL) return;
+  // o código é executado pelo outro mapeamento do buffer
+  bloco->nativo = (f_bloco_nativo_t)(self->nativo_exec
+                                     + (inicio - self->nativo));
+  self->nativo_usado = fim - self->nativo;
+}
+
+#else // CPU_JIT_X86_64
+
+static void cpu_cria_nativo(cpu_t *self)
+{
+  // sem geração de código, o motor jit funciona como o de blocos
+  self->nativo = NULL;
+}
+
+static void cpu_destroi_nativo(cpu_t *self)
+{
+}
+
+static void compila_bloco(cpu_t *self, bloco_t *bloco, int opcodes[])
+{
+}
+
+#endif // CPU_JIT_X86_64
+
+// EXECUTA VÁRIAS INSTRUÇÕES {{{1
+
+// retorna true se a instrução no PC acessa E/S, para o motor de referência
+// lê a memória sem marcar a página; se a leitura não for possível, a
+//   execução vai causar o erro
+static bool referencia_usa_es(cpu_t *self)
+{
+  int endfis, opcode;
+  if (utlb_traduz_pela_mmu(self, self->PC, &endfis) != ERR_OK) return false;
+  if (mem_le(mmu_mem(self->mmu), endfis, &opcode) != ERR_OK) return false;
+  return instrucao_usa_es(opcode);
+}
+
+int cpu_executa_n(cpu_t *self, int max, cpu_parada_t *pmotivo, int *pespera)
+{
+  int n = 0;
+  *pmotivo = parada_limite;
+  self->interrompida = false;
+  utlb_confere(self);
+  // sem custo nas faltas, o tempo é o número de instruções, e não precisa ser
+  //   conferido a cada uma
+  mmu_config_tlb_t tlb = mmu_config_tlb(self->mmu);
+  self->conta_espera = (tlb.entradas > 0 && tlb.custo_falta > 0);
+  self->espera = 0;
+  while (n + self->espera < max) {
+    if (self->erro != ERR_OK) {
+      *pmotivo = parada_erro;
+      break;
+    }
+    if (self->PC == self->breakpoint && !self->no_breakpoint) {
+      self->no_breakpoint = true;
+      *pmotivo = parada_breakpoint;
+      break;
+    }
+    self->no_breakpoint = false;
+    if (self->motor == motor_blocos || self->motor == motor_jit) {
+      // o bloco é procurado pelo endereço físico do PC
+      int endfis;
+      bloco_t *bloco = NULL;
+      if (traduz_pc(self, &endfis) == ERR_OK) {
+        bloco = pega_bloco(self, endfis);
+      }
+      if (bloco != NULL) {
+        n += executa_bloco(self, bloco, max - n - self->espera);
+        if (self->interrompida) {
+          *pmotivo = parada_interrupcao;
+          break;
+        }
+        continue;
+      }
+    }
+    bool es;
+    cpu_modo_t modo = self->modo;
+    if (self->motor != motor_referencia) {
+      instr_decod_t *instr = busca_predecodificada(self);
+      es = (instr != NULL && instr->es);
+      if (es && n > 0) {
+        *pmotivo = parada_es;
+        break;
+      }
+      if (instr != NULL) executa_predecodificada(self, instr);
+    } else {
+      es = referencia_usa_es(self);
+      if (es && n > 0) {
+        *pmotivo = parada_es;
+        break;
+      }
+      executa_referencia(self);
+    }
+    verifica_erro(self);
+    n++;
+    if (self->conta_espera) atualiza_espera(self);
+    if (self->interrompida) {
+      *pmotivo = parada_interrupcao;
+      break;
+    }
+    if (es) {
+      *pmotivo = parada_es;
+      break;
+    }
+    if (self->modo != modo) {
+      *pmotivo = parada_modo;
+      break;
+    }
+  }
+  utlb_descarrega(self);
+  atualiza_espera(self);
+  *pespera = self->espera;
+  return n;
+}
+
 // INTERRUPÇÃO {{{1
 
 bool cpu_interrompe(cpu_t *self, irq_t irq)
@@ -492,6 +2177,7 @@ bool cpu_interrompe(cpu_t *self, irq_t irq)
   //   físicos e não lógicos, e que se tem permissão para realizar esse
   //   acesso (para quando existir proteção de memória)
   self->modo = supervisor;
+  utlb_confere(self);
 
   // esta é uma CPU boazinha, salva todo o estado interno da CPU no início da memória
   // self->erro é alterado por poe_mem, copia antes!
@@ -512,6 +2198,7 @@ bool cpu_interrompe(cpu_t *self, irq_t irq)
   self->PC = IRQ_END_TRATADOR;
   self->A = irq;
   self->erro = ERR_OK;
+  self->interrompida = true;
 
   return true;
 }
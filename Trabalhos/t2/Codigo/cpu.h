@@ -11,11 +11,37 @@ typedef struct cpu_t cpu_t; // tipo opaco
 // os modos de execução da CPU
 typedef enum { supervisor, usuario } cpu_modo_t;
 
+// os motores de execução de instruções
+// - referência: a cada instrução, lê o opcode e o argumento da memória (através
+//   da MMU) e seleciona a operação em um switch
+// - pré-decodificado: decodifica cada posição da memória uma vez, guardando a
+//   função que implementa a instrução e seu argumento; a decodificação é
+//   descartada quando a memória correspondente é alterada
+// - blocos: como o pré-decodificado, mas os blocos básicos executados com
+//   frequência são traduzidos para sequências de instruções pré-decodificadas,
+//   executadas sem passar pelo laço principal em cpu_executa_n; os blocos de
+//   uma página são descartados quando alguma instrução deles é alterada
+// - jit: como o de blocos, mas os blocos traduzidos são compilados para código
+//   nativo x86-64, num buffer mapeado com mmap (no Linux); um bloco compilado
+//   desvia diretamente para o seguinte, se ele também estiver compilado; em
+//   outros hospedeiros, ou se o buffer não puder ser alocado, é igual ao de
+//   blocos
+// todos têm o mesmo comportamento visível; o de referência serve para
+//   comparação (ver confere_motores.c)
+typedef enum {
+  motor_referencia,
+  motor_predecodificado,
+  motor_blocos,
+  motor_jit,
+} cpu_motor_t;
+
 #include "es.h"
 #include "err.h"
 #include "irq.h"
 #include "mmu.h"
 
+#include <stdio.h>
+
 // tipo da função a ser chamada quando executar a instrução CHAMAC
 typedef int (*func_chamaC_t)(void *argC, int reg_A);
 
@@ -33,6 +59,41 @@ void cpu_destroi(cpu_t *self);
 //     e causa uma interrupção
 void cpu_executa_1(cpu_t *self);
 
+// os motivos para cpu_executa_n retornar
+typedef enum {
+  parada_limite,       // gastou o tempo máximo
+  parada_interrupcao,  // a CPU aceitou uma interrupção
+  parada_erro,         // a CPU está parada (executou PARA)
+  parada_es,           // executou uma instrução que acessa E/S, ou a próxima acessa
+  parada_breakpoint,   // a próxima instrução está no endereço de breakpoint
+  parada_modo,         // executou uma instrução que mudou o modo (RETI)
+} cpu_parada_t;
+
+// executa instruções em sequência, como chamadas repetidas a cpu_executa_1,
+//   enquanto o tempo gasto for menor que 'max' unidades
+// cada instrução gasta uma unidade de tempo, mais o tempo que a CPU espera
+//   pelas faltas na TLB (ver mmu_ciclos_extras); esse tempo de espera é
+//   colocado em '*pespera', e a última instrução pode fazer o total passar
+//   de 'max'
+// retorna antes se a CPU aceitar uma interrupção ou estiver parada, ou antes
+//   da instrução no endereço de breakpoint, ou depois de uma instrução que
+//   mude o modo da CPU (quando ela pode passar a aceitar interrupções); o
+//   motivo do retorno é colocado em '*pmotivo'
+// as instruções que acessam E/S (LE, ESCR e CHAMAC, que chama o SO) são
+//   executadas sozinhas: se não for a primeira, retorna antes dela; se for,
+//   retorna logo depois. Assim quem chama pode atualizar o relógio e os
+//   dispositivos antes de cada acesso
+// retorna o número de instruções executadas (0 se a CPU estiver parada ou
+//   a primeira instrução estiver no breakpoint), sem o tempo de espera
+int cpu_executa_n(cpu_t *self, int max, cpu_parada_t *pmotivo, int *pespera);
+
+// define o endereço de breakpoint (-1 para nenhum)
+// cpu_executa_n retorna antes de executar uma instrução nesse endereço
+//   (mesmo que seja a primeira, por exemplo depois de uma interrupção), a
+//   não ser que tenha parado nela na execução anterior, para que se possa
+//   continuar depois do breakpoint
+void cpu_define_breakpoint(cpu_t *self, int endereco);
+
 // implementa uma interrupção
 // passa para modo supervisor, salva o estado da CPU no início da memória,
 //   altera A para identificar a requisição de interrupção, altera PC para
@@ -40,6 +101,20 @@ void cpu_executa_1(cpu_t *self);
 // retorna true se interrupção foi aceita ou false caso contrário
 bool cpu_interrompe(cpu_t *self, irq_t irq);
 
+// escolhe o motor de execução de instruções (o padrão é o pré-decodificado)
+void cpu_define_motor(cpu_t *self, cpu_motor_t motor);
+
+// liga ou desliga a micro-TLB, onde a CPU guarda as últimas páginas traduzidas
+//   para acessá-las sem passar pela MMU (o padrão é ligada); o resultado da
+//   execução é o mesmo, inclusive os bits de acesso e as estatísticas da TLB
+//   (ver confere_mmu.c)
+void cpu_define_micro_tlb(cpu_t *self, bool ligada);
+
+// imprime em 'arq' quantas vezes cada superinstrução foi executada
+// as superinstruções são sequências comuns de instruções que o motor de
+//   blocos executa de uma vez, com o mesmo efeito que a execução em sequência
+void cpu_imprime_fusoes(cpu_t *self, FILE *arq);
+
 // define a função a chamar quando executar a instrução CHAMAC
 // e o argumento a passar para ela (normalmente, um ponteiro para o SO)
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t func, void *argC);
@@ -27,6 +27,9 @@ typedef enum {
   D_RELOGIO_REAL          = 17,
   D_RELOGIO_TIMER         = 18,
   D_RELOGIO_INTERRUPCAO   = 19,
+  D_PIC_PENDENTES         = 20,
+  D_PIC_HABILITADAS       = 21,
+  D_PIC_CANCELA           = 22,
   N_DISPOSITIVOS
 } dispositivo_id_t;
 
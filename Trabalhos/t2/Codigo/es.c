@@ -4,6 +4,7 @@
 // so24b
 
 #include "es.h"
+#include "rastro.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -56,7 +57,9 @@ err_t es_le(es_t *self, dispositivo_id_t dispositivo, int *pvalor)
   if (self->dispositivos[dispositivo].f_leitura == NULL) return ERR_OP_INV;
   void *controladora = self->dispositivos[dispositivo].controladora;
   int id = self->dispositivos[dispositivo].id;
-  return self->dispositivos[dispositivo].f_leitura(controladora, id, pvalor);
+  err_t err = self->dispositivos[dispositivo].f_leitura(controladora, id, pvalor);
+  if (err == ERR_OK) RASTRO(rastro_le_es, dispositivo, *pvalor);
+  return err;
 }
 
 err_t es_escreve(es_t *self, dispositivo_id_t dispositivo, int valor)
@@ -65,5 +68,6 @@ err_t es_escreve(es_t *self, dispositivo_id_t dispositivo, int valor)
   if (self->dispositivos[dispositivo].f_escrita == NULL) return ERR_OP_INV;
   void *controladora = self->dispositivos[dispositivo].controladora;
   int id = self->dispositivos[dispositivo].id;
+  RASTRO(rastro_escreve_es, dispositivo, valor);
   return self->dispositivos[dispositivo].f_escrita(controladora, id, valor);
 }
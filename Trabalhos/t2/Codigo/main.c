@@ -6,19 +6,38 @@
 #include "controle.h"
 #include "memoria.h"
 #include "mmu.h"
+#include "tabpag.h"
 #include "cpu.h"
 #include "relogio.h"
+#include "pic.h"
 #include "console.h"
 #include "terminal.h"
 #include "es.h"
 #include "dispositivos.h"
 #include "so.h"
+#include "rastro.h"
+#include "log.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // constantes
-#define MEM_TAM 10000        // tamanho da memória principal
+#define MEM_TAM 10000        // tamanho padrão da memória principal (ver -m)
+#define TAM_PAGINA 16        // tamanho padrão das páginas (ver -p)
+// motor de execução da CPU (motor_referencia para comparar com o original,
+//   motor_jit com -j)
+#define MOTOR_CPU motor_blocos
+// arquivo onde é registrado o uso das superinstruções (com -e)
+#define ARQ_FUSOES "fusoes.txt"
+// configuração padrão da TLB (ver -T) e arquivo com suas estatísticas (com
+//   -e, se a TLB estiver ligada)
+#define TLB_ENTRADAS 16
+#define TLB_VIAS 4
+#define TLB_POLITICA tlb_lru
+#define TLB_USA_ASID true
+#define TLB_CUSTO_FALTA 0
+#define ARQ_TLB "tlb.txt"
 
 // estrutura com os componentes do computador simulado
 typedef struct {
@@ -26,20 +45,27 @@ typedef struct {
   mmu_t *mmu;
   cpu_t *cpu;
   relogio_t *relogio;
+  pic_t *pic;
   console_t *console;
   es_t *es;
   controle_t *controle;
 } hardware_t;
 
-static void cria_hardware(hardware_t *hw)
+// cria o hardware; se 'lote', sem tela e sem operador (ver controle_define_lote)
+// se 'rapido', os terminais não demoram para rolar e limpar a saída
+// a memória principal tem 'tam_mem' palavras, obtidas da forma 'tipo_mem', e
+//   é dividida em páginas de 'tam_pagina' palavras
+static void cria_hardware(hardware_t *hw, bool lote, bool rapido, int tam_mem,
+                          mem_tipo_t tipo_mem, int tam_pagina)
 {
   // cria a memória e a MMU
-  hw->mem = mem_cria(MEM_TAM);
-  hw->mmu = mmu_cria(hw->mem);
+  hw->mem = mem_cria_tipo(tam_mem, tipo_mem);
+  hw->mmu = mmu_cria(hw->mem, tam_pagina);
 
   // cria dispositivos de E/S
-  hw->console = console_cria();
-  hw->relogio = relogio_cria();
+  hw->console = lote ? console_cria_sem_tela() : console_cria();
+  hw->pic = pic_cria();
+  hw->relogio = relogio_cria(hw->pic);
 
   // cria o controlador de E/S e registra os dispositivos
   //   por exemplo, o dispositivo 8 do controlador de E/S (e da CPU) será o
@@ -48,40 +74,53 @@ static void cria_hardware(hardware_t *hw)
   // lê teclado, testa teclado, escreve tela, testa tela do terminal A
   terminal_t *terminal;
   terminal = console_terminal(hw->console, 'A');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_A_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_A_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_A_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_A_TELA_OK    , terminal, 3, terminal_leitura, NULL);
   // lê teclado, testa teclado, escreve tela, testa tela do terminal B
   terminal = console_terminal(hw->console, 'B');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_B_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_B_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_B_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_B_TELA_OK    , terminal, 3, terminal_leitura, NULL);
   // lê teclado, testa teclado, escreve tela, testa tela do terminal C
   terminal = console_terminal(hw->console, 'C');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_C_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_C_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_C_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_C_TELA_OK    , terminal, 3, terminal_leitura, NULL);
   // lê teclado, testa teclado, escreve tela, testa tela do terminal D
   terminal = console_terminal(hw->console, 'D');
+  terminal_define_pic(terminal, hw->pic);
   es_registra_dispositivo(hw->es, D_TERM_D_TECLADO    , terminal, 0, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_D_TECLADO_OK , terminal, 1, terminal_leitura, NULL);
   es_registra_dispositivo(hw->es, D_TERM_D_TELA       , terminal, 2, NULL, terminal_escrita);
   es_registra_dispositivo(hw->es, D_TERM_D_TELA_OK    , terminal, 3, terminal_leitura, NULL);
+  for (char t = 'A'; t <= 'D'; t++) {
+    terminal_define_rapido(console_terminal(hw->console, t), rapido);
+  }
   // lê relógio virtual, relógio real
   es_registra_dispositivo(hw->es, D_RELOGIO_INSTRUCOES, hw->relogio, 0, relogio_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_REAL      , hw->relogio, 1, relogio_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_TIMER     , hw->relogio, 2, relogio_leitura, relogio_escrita);
   es_registra_dispositivo(hw->es, D_RELOGIO_INTERRUPCAO,hw->relogio, 3, relogio_leitura, relogio_escrita);
+  // lê interrupções pendentes, lê e altera as habilitadas, cancela pendente
+  es_registra_dispositivo(hw->es, D_PIC_PENDENTES     , hw->pic, 0, pic_leitura, NULL);
+  es_registra_dispositivo(hw->es, D_PIC_HABILITADAS   , hw->pic, 1, pic_leitura, pic_escrita);
+  es_registra_dispositivo(hw->es, D_PIC_CANCELA       , hw->pic, 2, NULL, pic_escrita);
 
   // cria a unidade de execução e inicializa com a MMU e E/S
   hw->cpu = cpu_cria(hw->mmu, hw->es);
+  cpu_define_motor(hw->cpu, MOTOR_CPU);
 
-  // cria o controlador da CPU e inicializa com a unidade de execução, a console e
-  //   o relógio
-  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio);
+  // cria o controlador da CPU e inicializa com a unidade de execução, a console,
+  //   o relógio e o controlador de interrupções
+  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio, hw->pic);
+  if (lote) controle_define_lote(hw->controle);
 }
 
 static void destroi_hardware(hardware_t *hw)
@@ -90,24 +129,159 @@ static void destroi_hardware(hardware_t *hw)
   cpu_destroi(hw->cpu);
   es_destroi(hw->es);
   relogio_destroi(hw->relogio);
+  pic_destroi(hw->pic);
   console_destroi(hw->console);
   mmu_destroi(hw->mmu);
   mem_destroi(hw->mem);
 }
 
-int main()
+// retorna o tipo de memória com o nome 'nome', ou -1
+static mem_tipo_t tipo_de_memoria(char *nome)
+{
+  if (strcmp(nome, "densa") == 0) return mem_densa;
+  if (strcmp(nome, "esparsa") == 0) return mem_esparsa;
+  if (strcmp(nome, "enorme") == 0) return mem_enorme;
+  return -1;
+}
+
+// retorna o tipo de tabela de páginas com o nome 'nome', ou -1
+static tabpag_tipo_t tipo_de_tabpag(char *nome)
+{
+  for (tabpag_tipo_t tipo = 0; tipo < N_TABPAG_TIPOS; tipo++) {
+    if (strcmp(nome, tabpag_nome_do_tipo(tipo)) == 0) return tipo;
+  }
+  return -1;
+}
+
+// preenche '*pconfig' com a configuração da TLB descrita em 'txt' (ver -T),
+//   partindo da configuração padrão
+// retorna false se a descrição for inválida
+static bool le_config_tlb(char *txt, mmu_config_tlb_t *pconfig)
+{
+  mmu_config_tlb_t c = {
+    .entradas = TLB_ENTRADAS, .vias = TLB_VIAS, .politica = TLB_POLITICA,
+    .usa_asid = TLB_USA_ASID, .custo_falta = TLB_CUSTO_FALTA
+  };
+  char politica[16] = "";
+  int usa_asid = c.usa_asid;
+  sscanf(txt, "%d,%d,%15[^,],%d,%d", &c.entradas, &c.vias, politica, &usa_asid,
+         &c.custo_falta);
+  c.usa_asid = usa_asid;
+  if (strcmp(politica, "lru") == 0) c.politica = tlb_lru;
+  else if (strcmp(politica, "fifo") == 0) c.politica = tlb_fifo;
+  else if (strcmp(politica, "aleatoria") == 0) c.politica = tlb_aleatoria;
+  else if (politica[0] != '\0') return false;
+  if (c.vias > c.entradas) c.vias = c.entradas > 0 ? c.entradas : 1;
+  if (c.entradas < 0 || c.vias <= 0 || c.entradas % c.vias != 0
+      || c.custo_falta < 0) {
+    return false;
+  }
+  *pconfig = c;
+  return true;
+}
+
+int main(int argc, char *argv[])
 {
   hardware_t hw;
   so_t *so;
 
+  // opções:
+  //   -l executa em modo lote: sem tela, sem esperar comandos, até o SO não
+  //      ter mais nada a fazer
+  //   -r terminais rápidos, sem a demora da rolagem e limpeza da saída
+  //   -t arq   registra os eventos da execução e grava no arquivo 'arq', no
+  //            formato de rastro do chrome (ver rastro.h)
+  //   -v registra também as mensagens de depuração no log (log_da_console)
+  //   -j executa com o motor jit, que compila os blocos para código nativo
+  //      (ver cpu_motor_t)
+  //   -e grava no final os relatórios da execução: o uso das superinstruções
+  //      em fusoes.txt e, se a TLB estiver ligada, as estatísticas dela em
+  //      tlb.txt
+  //   -m tam   tamanho da memória principal, em palavras
+  //   -M tipo  forma de alocar a memória principal no hospedeiro: densa
+  //            (padrão), esparsa ou enorme (ver mem_tipo_t)
+  //   -p tam   tamanho das páginas da MMU, em palavras (potência de 2)
+  //   -P tipo  organização das tabelas de páginas criadas pelo SO: linear
+  //            (padrão), niveis ou invertida (ver tabpag_tipo_t)
+  //   -T ent,vias,política,asid,custo   configuração da TLB (ver
+  //            mmu_config_tlb_t); política é lru, fifo ou aleatoria, asid é
+  //            0 ou 1; os campos omitidos ficam com o valor padrão, ent 0
+  //            desliga a TLB
+  bool lote = false;
+  bool rapido = false;
+  bool relatorios = false;
+  bool jit = false;
+  char *arq_rastro = NULL;
+  int tam_mem = MEM_TAM;
+  char *tipo_mem = "densa";
+  char *config_tlb = "";
+  int tam_pagina = TAM_PAGINA;
+  char *tipo_tabpag = "linear";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-l") == 0) lote = true;
+    if (strcmp(argv[i], "-r") == 0) rapido = true;
+    if (strcmp(argv[i], "-e") == 0) relatorios = true;
+    if (strcmp(argv[i], "-j") == 0) jit = true;
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) arq_rastro = argv[++i];
+    if (strcmp(argv[i], "-v") == 0) {
+      for (int c = 0; c < N_LOG_CATEGORIAS; c++) log_define_nivel(c, log_depura);
+    }
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) tam_mem = atoi(argv[++i]);
+    if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) tipo_mem = argv[++i];
+    if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) config_tlb = argv[++i];
+    if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) tam_pagina = atoi(argv[++i]);
+    if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) tipo_tabpag = argv[++i];
+  }
+  mem_tipo_t tipo = tipo_de_memoria(tipo_mem);
+  if (tipo == -1 || tam_mem <= 0) {
+    fprintf(stderr, "Memória '%s' de %d palavras inválida\n", tipo_mem, tam_mem);
+    return 1;
+  }
+  if (tam_pagina <= 0 || (tam_pagina & (tam_pagina - 1)) != 0) {
+    fprintf(stderr, "Tamanho de página %d não é potência de 2\n", tam_pagina);
+    return 1;
+  }
+  tabpag_tipo_t tipo_tab = tipo_de_tabpag(tipo_tabpag);
+  if (tipo_tab == -1) {
+    fprintf(stderr, "Tabela de páginas '%s' inválida\n", tipo_tabpag);
+    return 1;
+  }
+  tabpag_define_tipo_padrao(tipo_tab);
+  mmu_config_tlb_t tlb;
+  if (!le_config_tlb(config_tlb, &tlb)) {
+    fprintf(stderr, "Configuração da TLB '%s' inválida\n", config_tlb);
+    return 1;
+  }
+
   // cria o hardware
-  cria_hardware(&hw);
+  cria_hardware(&hw, lote, rapido, tam_mem, tipo, tam_pagina);
+  if (jit) cpu_define_motor(hw.cpu, motor_jit);
+  mmu_configura_tlb(hw.mmu, tlb);
+  if (arq_rastro != NULL) rastro_liga(hw.relogio);
   // cria o sistema operacional
   so = so_cria(hw.cpu, hw.mem, hw.mmu, hw.es, hw.console);
   
   // executa o laço principal do controlador
   controle_laco(hw.controle);
 
+  if (arq_rastro != NULL && !rastro_grava(arq_rastro)) {
+    fprintf(stderr, "Não foi possível gravar o rastro em '%s'\n", arq_rastro);
+  }
+
+  if (relatorios) {
+    // registra o uso das superinstruções
+    FILE *arq = fopen(ARQ_FUSOES, "w");
+    if (arq != NULL) {
+      cpu_imprime_fusoes(hw.cpu, arq);
+      fclose(arq);
+    }
+    // e o comportamento da TLB
+    if (tlb.entradas > 0 && (arq = fopen(ARQ_TLB, "w")) != NULL) {
+      mmu_imprime_tlb(hw.mmu, arq);
+      fclose(arq);
+    }
+  }
+
   // destroi tudo
   so_destroi(so);
   destroi_hardware(&hw);
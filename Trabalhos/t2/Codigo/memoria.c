@@ -6,24 +6,59 @@
 #include "memoria.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <stdbool.h>
+#include <sys/mman.h>
 
 // tipo de dados para representar uma região de memória
 struct mem_t {
   int tam;
   int *conteudo;
+  mem_tipo_t tipo;
+  // função a chamar quando a memória é alterada, e seu argumento
+  mem_f_alteracao_t f_alteracao;
+  void *arg_alteracao;
 };
 
+// aloca o conteúdo de uma memória esparsa: reserva a faixa de endereços sem
+//   reservar espaço de troca (MAP_NORESERVE); o hospedeiro só aloca (e zera)
+//   cada página no primeiro acesso
+static int *aloca_esparsa(size_t bytes, bool enorme)
+{
+  int *conteudo = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  assert(conteudo != MAP_FAILED);
+#ifdef MADV_HUGEPAGE
+  // é só um pedido; se o hospedeiro não atender, segue com páginas normais
+  if (enorme) madvise(conteudo, bytes, MADV_HUGEPAGE);
+#endif
+  return conteudo;
+}
+
 mem_t *mem_cria(int tam)
+{
+  return mem_cria_tipo(tam, mem_densa);
+}
+
+mem_t *mem_cria_tipo(int tam, mem_tipo_t tipo)
 {
   mem_t *self;
   self = malloc(sizeof(*self));
   assert(self != NULL);
 
-  self->conteudo = malloc(tam * sizeof(*(self->conteudo)));
-  assert(self->conteudo != NULL);
+  size_t bytes = (size_t)tam * sizeof(*(self->conteudo));
+  if (tipo == mem_densa) {
+    self->conteudo = malloc(bytes);
+    assert(self->conteudo != NULL);
+  } else {
+    self->conteudo = aloca_esparsa(bytes, tipo == mem_enorme);
+  }
 
   self->tam = tam;
+  self->tipo = tipo;
+  self->f_alteracao = NULL;
+  self->arg_alteracao = NULL;
 
   return self;
 }
@@ -32,7 +67,11 @@ void mem_destroi(mem_t *self)
 {
   if (self != NULL) {
     if (self->conteudo != NULL) {
-      free(self->conteudo);
+      if (self->tipo == mem_densa) {
+        free(self->conteudo);
+      } else {
+        munmap(self->conteudo, (size_t)self->tam * sizeof(*(self->conteudo)));
+      }
     }
     free(self);
   }
@@ -66,6 +105,88 @@ err_t mem_escreve(mem_t *self, int endereco, int valor)
   err_t err = verifica_permissao(self, endereco);
   if (err == ERR_OK) {
     self->conteudo[endereco] = valor;
+    if (self->f_alteracao != NULL) {
+      self->f_alteracao(self->arg_alteracao, endereco, 1);
+    }
+  }
+  return err;
+}
+
+// OPERAÇÕES EM BLOCO {{{1
+
+// função auxiliar, verifica se as 'n' posições a partir de 'endereco' são
+//   válidas (sem estourar o int na soma)
+static err_t verifica_bloco(mem_t *self, int endereco, int n)
+{
+  if (n < 0 || endereco < 0 || endereco > self->tam - n) {
+    return ERR_END_INV;
+  }
+  return ERR_OK;
+}
+
+err_t mem_le_bloco(mem_t *self, int endereco, int n, int dados[n])
+{
+  err_t err = verifica_bloco(self, endereco, n);
+  if (err == ERR_OK) {
+    memcpy(dados, &self->conteudo[endereco], n * sizeof(*dados));
+  }
+  return err;
+}
+
+err_t mem_escreve_bloco(mem_t *self, int endereco, int n, int dados[n])
+{
+  err_t err = verifica_bloco(self, endereco, n);
+  if (err == ERR_OK && n > 0) {
+    memcpy(&self->conteudo[endereco], dados, n * sizeof(*dados));
+    if (self->f_alteracao != NULL) {
+      self->f_alteracao(self->arg_alteracao, endereco, n);
+    }
+  }
+  return err;
+}
+
+err_t mem_copia(mem_t *self, int destino, int origem, int n)
+{
+  err_t err = verifica_bloco(self, destino, n);
+  if (err == ERR_OK) err = verifica_bloco(self, origem, n);
+  if (err == ERR_OK && n > 0) {
+    memmove(&self->conteudo[destino], &self->conteudo[origem],
+            n * sizeof(*self->conteudo));
+    if (self->f_alteracao != NULL) {
+      self->f_alteracao(self->arg_alteracao, destino, n);
+    }
+  }
+  return err;
+}
+
+err_t mem_preenche(mem_t *self, int endereco, int n, int valor)
+{
+  err_t err = verifica_bloco(self, endereco, n);
+  if (err == ERR_OK && n > 0) {
+    // laço simples, o compilador vetoriza
+    int *p = &self->conteudo[endereco];
+    for (int i = 0; i < n; i++) {
+      p[i] = valor;
+    }
+    if (self->f_alteracao != NULL) {
+      self->f_alteracao(self->arg_alteracao, endereco, n);
+    }
   }
   return err;
 }
+
+const int *mem_acesso_direto(mem_t *self, int endereco, int n)
+{
+  if (verifica_bloco(self, endereco, n) != ERR_OK) return NULL;
+  return &self->conteudo[endereco];
+}
+
+// OBSERVADOR {{{1
+
+void mem_define_observador(mem_t *self, mem_f_alteracao_t f_alteracao, void *arg)
+{
+  self->f_alteracao = f_alteracao;
+  self->arg_alteracao = arg;
+}
+
+// vim: foldmethod=marker
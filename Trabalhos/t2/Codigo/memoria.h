@@ -11,11 +11,28 @@
 // tipo opaco que representa a memória
 typedef struct mem_t mem_t;
 
+// forma de obter do hospedeiro o espaço para o conteúdo da memória
+typedef enum {
+  mem_densa,    // um vetor com todo o conteúdo, alocado na criação
+  mem_esparsa,  // uma faixa de endereços reservada (mmap), cujas páginas só
+                //   ocupam memória do hospedeiro quando acessadas pela
+                //   primeira vez; o conteúdo inicial é zero
+  mem_enorme,   // como mem_esparsa, pedindo ao hospedeiro páginas enormes
+                //   (transparent huge pages), se ele suportar
+} mem_tipo_t;
+
 // cria uma região de memória com capacidade para 'tam' valores (inteiros)
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações sobre essa memória
+// a memória é do tipo mem_densa
 mem_t *mem_cria(int tam);
 
+// cria uma região de memória como mem_cria, obtendo o espaço da forma
+//   'tipo'; as memórias esparsas permitem simular memórias muito grandes,
+//   pagando no hospedeiro só pelas regiões usadas
+// mata o programa se o hospedeiro não fornecer o espaço
+mem_t *mem_cria_tipo(int tam, mem_tipo_t tipo);
+
 // destrói uma região de memória
 // nenhuma outra operação pode ser realizada na região após esta chamada
 void mem_destroi(mem_t *self);
@@ -31,4 +48,42 @@ err_t mem_le(mem_t *self, int endereco, int *pvalor);
 // retorna erro ERR_END_INV se endereço inválido
 err_t mem_escreve(mem_t *self, int endereco, int valor);
 
+// operações sobre blocos de 'n' valores a partir de 'endereco'
+// o intervalo todo é verificado antes, e copiado de uma vez; se alguma
+//   posição for inválida, retornam ERR_END_INV e não acessam a memória
+// são mais eficientes que repetir mem_le ou mem_escreve (carga de programas,
+//   cópia de páginas)
+
+// copia os 'n' valores a partir de 'endereco' para 'dados'
+err_t mem_le_bloco(mem_t *self, int endereco, int n, int dados[n]);
+
+// copia os 'n' valores em 'dados' para a memória a partir de 'endereco'
+err_t mem_escreve_bloco(mem_t *self, int endereco, int n, int dados[n]);
+
+// copia os 'n' valores a partir de 'origem' para 'destino'; os intervalos
+//   podem se sobrepor
+err_t mem_copia(mem_t *self, int destino, int origem, int n);
+
+// coloca 'valor' nas 'n' posições a partir de 'endereco'
+err_t mem_preenche(mem_t *self, int endereco, int n, int valor);
+
+// retorna um ponteiro para o conteúdo das 'n' posições a partir de 'endereco'
+//   na memória do hospedeiro, ou NULL se alguma for inválida
+// o ponteiro é só para leitura (as escritas devem ser feitas pelas outras
+//   funções, para o observador ser avisado), e vale enquanto a memória existir
+const int *mem_acesso_direto(mem_t *self, int endereco, int n);
+
+// tipo da função chamada quando a memória é alterada; recebe o argumento
+//   fornecido no registro e o intervalo alterado ('n' posições a partir de
+//   'endereco')
+typedef void (*mem_f_alteracao_t)(void *arg, int endereco, int n);
+
+// registra a função 'f_alteracao' para ser chamada após cada escrita bem
+//   sucedida na memória, com o argumento 'arg' (uma vez por operação, mesmo
+//   nas de bloco)
+// só uma função pode estar registrada; NULL cancela o registro
+// serve para quem mantém uma cópia derivada do conteúdo da memória (como a
+//   CPU, com as instruções pré-decodificadas) saber quando ela fica velha
+void mem_define_observador(mem_t *self, mem_f_alteracao_t f_alteracao, void *arg);
+
 #endif // MEMORIA_H
@@ -4,24 +4,74 @@
 // so24b
 
 #include "mmu.h"
+#include "rastro.h"
 #include <stdlib.h>
 #include <assert.h>
 
+// uma entrada da TLB
+typedef struct {
+  bool valida;
+  int asid;
+  int pagina;
+  int quadro;
+  // instante (em traduções) da carga e do último uso da entrada
+  unsigned long carga;
+  unsigned long uso;
+} entrada_tlb_t;
+
 // tipo de dados opaco para representar uma MMU
 struct mmu_t {
   // memória física
   mem_t *mem;
   // tabela de páginas
   tabpag_t *tabpag;
+  // tamanho da página (2^bits_pagina), e máscara do deslocamento na página
+  int bits_pagina;
+  int mascara_pagina;
+  // ASID da tabela de páginas
+  int asid;
+  // TLB: 'n_conjuntos' conjuntos de 'config.vias' entradas (NULL se
+  //   desligada)
+  mmu_config_tlb_t config;
+  int n_conjuntos;
+  entrada_tlb_t *tlb;
+  // número de traduções feitas com a TLB (o relógio das políticas)
+  unsigned long traducoes;
+  // estado do gerador de números pseudo-aleatórios (política aleatória)
+  unsigned sorteio;
+  mmu_estat_tlb_t estat;
+  // tempo cobrado pelas faltas, ainda não retirado com mmu_ciclos_extras
+  int ciclos_extras;
+  // geração das traduções diretas, e versão da tabela de páginas quando a
+  //   geração foi calculada (ver mmu_geracao)
+  unsigned geracao;
+  int versao_tabpag;
 };
 
-mmu_t *mmu_cria(mem_t *mem)
+// CRIAÇÃO {{{1
+
+mmu_t *mmu_cria(mem_t *mem, int tam_pagina)
 {
+  // só potências de 2
+  assert(tam_pagina > 0 && (tam_pagina & (tam_pagina - 1)) == 0);
   mmu_t *self;
   self = malloc(sizeof(*self));
   assert(self != NULL);
   self->mem = mem;
   self->tabpag = NULL;
+  self->bits_pagina = 0;
+  while ((1 << self->bits_pagina) < tam_pagina) self->bits_pagina++;
+  self->mascara_pagina = tam_pagina - 1;
+  self->asid = 0;
+  self->config = (mmu_config_tlb_t){ .entradas = 0, .vias = 1 };
+  self->n_conjuntos = 0;
+  self->tlb = NULL;
+  self->traducoes = 0;
+  self->sorteio = 1;
+  self->estat = (mmu_estat_tlb_t){ 0 };
+  self->ciclos_extras = 0;
+  self->geracao = 0;
+  self->versao_tabpag = 0;
   return self;
 }
 
@@ -29,26 +79,216 @@ void mmu_destroi(mmu_t *self)
 {
   if (self != NULL) {
     // nem a tabela de páginas nem a memória pertencem à MMU, não são liberadas aqui
+    free(self->tlb);
     free(self);
   }
 }
 
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag)
 {
+  mmu_define_tabpag_asid(self, tabpag, tabpag == NULL ? 0 : tabpag_asid(tabpag));
+}
+
+void mmu_define_tabpag_asid(mmu_t *self, tabpag_t *tabpag, int asid)
+{
+  if (tabpag != self->tabpag) {
+    self->estat.trocas++;
+    if (!self->config.usa_asid) mmu_esvazia_tlb(self);
+  }
   self->tabpag = tabpag;
+  self->asid = asid;
+  self->geracao++;
+  if (tabpag != NULL) self->versao_tabpag = tabpag_versao(tabpag);
+}
+
+// TLB {{{1
+
+void mmu_configura_tlb(mmu_t *self, mmu_config_tlb_t config)
+{
+  assert(config.entradas >= 0 && config.vias > 0);
+  assert(config.entradas % config.vias == 0);
+  free(self->tlb);
+  self->geracao++;
+  self->config = config;
+  self->n_conjuntos = config.entradas / config.vias;
+  self->tlb = NULL;
+  if (config.entradas > 0) {
+    self->tlb = calloc(config.entradas, sizeof(*self->tlb));
+    assert(self->tlb != NULL);
+  }
+}
+
+// retorna o ASID das entradas carregadas agora
+static int asid_atual(mmu_t *self)
+{
+  return self->config.usa_asid ? self->asid : 0;
+}
+
+// retorna a primeira entrada do conjunto onde pode estar a página
+static entrada_tlb_t *conjunto_da_pagina(mmu_t *self, int pagina)
+{
+  return &self->tlb[(unsigned)pagina % self->n_conjuntos * self->config.vias];
+}
+
+// invalida as entradas que satisfazem o critério: de todos os ASIDs ou
+//   só de 'asid', de todas as páginas ou só de 'pagina' (-1 é todos)
+static void invalida(mmu_t *self, int asid, int pagina)
+{
+  for (int i = 0; i < self->config.entradas; i++) {
+    entrada_tlb_t *e = &self->tlb[i];
+    if (e->valida && (asid == -1 || e->asid == asid)
+        && (pagina == -1 || e->pagina == pagina)) {
+      e->valida = false;
+      self->estat.invalidadas++;
+    }
+  }
+  self->geracao++;
+}
+
+void mmu_invalida_pagina(mmu_t *self, int pagina)
+{
+  invalida(self, asid_atual(self), pagina);
+}
+
+void mmu_invalida_asid(mmu_t *self, int asid)
+{
+  invalida(self, asid, -1);
 }
 
+void mmu_esvazia_tlb(mmu_t *self)
+{
+  if (self->tlb == NULL) return;
+  self->estat.esvaziamentos++;
+  invalida(self, -1, -1);
+}
+
+// escolhe a entrada do conjunto que será substituída
+static entrada_tlb_t *vitima(mmu_t *self, entrada_tlb_t *conjunto)
+{
+  int vias = self->config.vias;
+  for (int i = 0; i < vias; i++) {
+    if (!conjunto[i].valida) return &conjunto[i];
+  }
+  if (self->config.politica == tlb_aleatoria) {
+    // xorshift, só para ser reprodutível
+    self->sorteio ^= self->sorteio << 13;
+    self->sorteio ^= self->sorteio >> 17;
+    self->sorteio ^= self->sorteio << 5;
+    return &conjunto[self->sorteio % vias];
+  }
+  entrada_tlb_t *v = &conjunto[0];
+  for (int i = 1; i < vias; i++) {
+    unsigned long t_i, t_v;
+    if (self->config.politica == tlb_lru) {
+      t_i = conjunto[i].uso;
+      t_v = v->uso;
+    } else {
+      t_i = conjunto[i].carga;
+      t_v = v->carga;
+    }
+    if (t_i < t_v) v = &conjunto[i];
+  }
+  return v;
+}
+
+// retorna a entrada da TLB com a tradução da página 'pagina' no ASID atual,
+//   ou NULL se não tiver; não conta como consulta
+static entrada_tlb_t *busca_na_tlb(mmu_t *self, int pagina)
+{
+  int asid = asid_atual(self);
+  entrada_tlb_t *conjunto = conjunto_da_pagina(self, pagina);
+  for (int i = 0; i < self->config.vias; i++) {
+    entrada_tlb_t *e = &conjunto[i];
+    if (e->valida && e->pagina == pagina && e->asid == asid) return e;
+  }
+  return NULL;
+}
+
+// traduz a página com a TLB; na falta, consulta a tabela de páginas e, se a
+//   página for válida, carrega a tradução na TLB
+static err_t traduz_com_tlb(mmu_t *self, int pagina, int *pquadro)
+{
+  self->traducoes++;
+  entrada_tlb_t *e = busca_na_tlb(self, pagina);
+  if (e != NULL) {
+    self->estat.acertos++;
+    e->uso = self->traducoes;
+    *pquadro = e->quadro;
+    return ERR_OK;
+  }
+  self->estat.faltas++;
+  self->ciclos_extras += self->config.custo_falta;
+  int quadro;
+  err_t err = tabpag_traduz(self->tabpag, pagina, &quadro);
+  if (err == ERR_OK) {
+    e = vitima(self, conjunto_da_pagina(self, pagina));
+    // a página que sai pode estar na micro-TLB da CPU
+    if (e->valida) self->geracao++;
+    *e = (entrada_tlb_t){ .valida = true, .asid = asid_atual(self),
+                          .pagina = pagina, .quadro = quadro,
+                          .carga = self->traducoes, .uso = self->traducoes };
+    *pquadro = quadro;
+  }
+  return err;
+}
+
+mmu_config_tlb_t mmu_config_tlb(mmu_t *self)
+{
+  return self->config;
+}
+
+mmu_estat_tlb_t mmu_estat_tlb(mmu_t *self)
+{
+  return self->estat;
+}
+
+void mmu_imprime_tlb(mmu_t *self, FILE *arq)
+{
+  static char *nomes_politicas[] = {
+    [tlb_lru] = "lru", [tlb_fifo] = "fifo", [tlb_aleatoria] = "aleatoria"
+  };
+  mmu_estat_tlb_t *e = &self->estat;
+  long consultas = e->acertos + e->faltas;
+  fprintf(arq, "TLB: %d entradas, %d vias, %s, %s ASID, custo da falta %d\n",
+          self->config.entradas, self->config.vias,
+          nomes_politicas[self->config.politica],
+          self->config.usa_asid ? "com" : "sem", self->config.custo_falta);
+  fprintf(arq, "consultas: %ld\n", consultas);
+  fprintf(arq, "acertos: %ld (%.2f%%)\n", e->acertos,
+          consultas > 0 ? 100.0 * e->acertos / consultas : 0.0);
+  fprintf(arq, "faltas: %ld\n", e->faltas);
+  fprintf(arq, "trocas de tabela: %ld\n", e->trocas);
+  fprintf(arq, "esvaziamentos: %ld\n", e->esvaziamentos);
+  fprintf(arq, "entradas invalidadas: %ld\n", e->invalidadas);
+}
+
+int mmu_ciclos_extras(mmu_t *self)
+{
+  int n = self->ciclos_extras;
+  self->ciclos_extras = 0;
+  return n;
+}
+
+// TRADUÇÃO {{{1
+
 // tradur o endereço virtual 'endvirt', colocando o endereço físico
 //   correspondente em 'pendfis'.
 // retorna ERR_OK ou um erro se a tradução não for possível
 static err_t mmu__traduz(mmu_t *self, int endvirt, int *pendfis)
 {
-  int pagina = endvirt / TAM_PAGINA;
-  int deslocamento = endvirt % TAM_PAGINA;
+  int pagina = endvirt >> self->bits_pagina;
+  int deslocamento = endvirt & self->mascara_pagina;
   int quadro;
-  err_t err = tabpag_traduz(self->tabpag, pagina, &quadro);
+  err_t err;
+  if (self->tlb != NULL) {
+    err = traduz_com_tlb(self, pagina, &quadro);
+  } else {
+    err = tabpag_traduz(self->tabpag, pagina, &quadro);
+  }
   if (err == ERR_OK) {
-    *pendfis = quadro * TAM_PAGINA + deslocamento;
+    *pendfis = (quadro << self->bits_pagina) + deslocamento;
+  } else {
+    RASTRO(rastro_falta_pagina, endvirt, pagina);
   }
   return err;
 }
@@ -65,7 +305,7 @@ err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
   if (err == ERR_OK) {
     err = mem_le(self->mem, endfis, pvalor);
     if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, false);
+      tabpag_marca_bit_acesso(self->tabpag, endvirt >> self->bits_pagina, false);
     }
   }
   return err;
@@ -83,8 +323,138 @@ err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
   if (err == ERR_OK) {
     err = mem_escreve(self->mem, endfis, valor);
     if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, true);
+      tabpag_marca_bit_acesso(self->tabpag, endvirt >> self->bits_pagina, true);
     }
   }
   return err;
 }
+
+// função auxiliar de mmu_le_bloco e mmu_escreve_bloco: acessa o intervalo
+//   trecho a trecho, cada trecho dentro de uma página
+static err_t mmu__bloco(mmu_t *self, int endvirt, int n, int dados[n],
+                        bool escrita, cpu_modo_t modo)
+{
+  if (modo == supervisor || self->tabpag == NULL) {
+    if (escrita) return mem_escreve_bloco(self->mem, endvirt, n, dados);
+    return mem_le_bloco(self->mem, endvirt, n, dados);
+  }
+  if (n < 0 || endvirt < 0) return ERR_END_INV;
+  while (n > 0) {
+    int no_trecho = (self->mascara_pagina + 1) - (endvirt & self->mascara_pagina);
+    if (no_trecho > n) no_trecho = n;
+    int endfis;
+    err_t err = mmu__traduz(self, endvirt, &endfis);
+    if (err == ERR_OK) {
+      if (escrita) {
+        err = mem_escreve_bloco(self->mem, endfis, no_trecho, dados);
+      } else {
+        err = mem_le_bloco(self->mem, endfis, no_trecho, dados);
+      }
+    }
+    if (err != ERR_OK) return err;
+    tabpag_marca_bit_acesso(self->tabpag, endvirt >> self->bits_pagina, escrita);
+    endvirt += no_trecho;
+    dados += no_trecho;
+    n -= no_trecho;
+  }
+  return ERR_OK;
+}
+
+err_t mmu_le_bloco(mmu_t *self, int endvirt, int n, int dados[n],
+                   cpu_modo_t modo)
+{
+  return mmu__bloco(self, endvirt, n, dados, false, modo);
+}
+
+err_t mmu_escreve_bloco(mmu_t *self, int endvirt, int n, int dados[n],
+                        cpu_modo_t modo)
+{
+  return mmu__bloco(self, endvirt, n, dados, true, modo);
+}
+
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo)
+{
+  int endfis = endvirt;
+  if (modo != supervisor && self->tabpag != NULL) {
+    err_t err = mmu__traduz(self, endvirt, &endfis);
+    if (err != ERR_OK) return err;
+  }
+  // o acesso seria recusado pela memória
+  if (endfis < 0 || endfis >= mem_tam(self->mem)) return ERR_END_INV;
+  *pendfis = endfis;
+  return ERR_OK;
+}
+
+void mmu_marca_acesso(mmu_t *self, int endvirt, bool alteracao, cpu_modo_t modo)
+{
+  if (modo == supervisor || self->tabpag == NULL) return;
+  tabpag_marca_bit_acesso(self->tabpag, endvirt >> self->bits_pagina, alteracao);
+}
+
+// ACESSO DIRETO {{{1
+
+unsigned mmu_geracao(mmu_t *self)
+{
+  if (self->tabpag != NULL) {
+    int versao = tabpag_versao(self->tabpag);
+    if (versao != self->versao_tabpag) {
+      self->versao_tabpag = versao;
+      self->geracao++;
+    }
+  }
+  return self->geracao;
+}
+
+const int *mmu_quadro_direto(mmu_t *self, int pagina, bool alteracao,
+                             bool consulta, cpu_modo_t modo, int *pend_quadro)
+{
+  if (pagina < 0) return NULL;
+  bool traduz = (modo != supervisor && self->tabpag != NULL);
+  int quadro = pagina;
+  if (traduz) {
+    // o quadro é o que a TLB daria, mas a consulta só é contada se o acesso
+    //   direto for possível; senão, o acesso será feito (e contado) pela MMU
+    entrada_tlb_t *e = self->tlb == NULL ? NULL : busca_na_tlb(self, pagina);
+    if (e != NULL) {
+      quadro = e->quadro;
+    } else if (tabpag_traduz(self->tabpag, pagina, &quadro) != ERR_OK) {
+      return NULL;
+    }
+  }
+  int end_quadro = quadro << self->bits_pagina;
+  const int *conteudo = mem_acesso_direto(self->mem, end_quadro,
+                                          self->mascara_pagina + 1);
+  if (conteudo == NULL) return NULL;
+  if (traduz) {
+    if (consulta && self->tlb != NULL) traduz_com_tlb(self, pagina, &quadro);
+    tabpag_marca_bit_acesso(self->tabpag, pagina, alteracao);
+  }
+  *pend_quadro = end_quadro;
+  return conteudo;
+}
+
+void mmu_conta_acertos_tlb(mmu_t *self, int pagina, int n)
+{
+  if (self->tlb == NULL || self->tabpag == NULL || n <= 0) return;
+  self->traducoes += n;
+  self->estat.acertos += n;
+  entrada_tlb_t *e = busca_na_tlb(self, pagina);
+  if (e != NULL) e->uso = self->traducoes;
+}
+
+int mmu_tam_pagina(mmu_t *self)
+{
+  return self->mascara_pagina + 1;
+}
+
+int mmu_bits_pagina(mmu_t *self)
+{
+  return self->bits_pagina;
+}
+
+mem_t *mmu_mem(mmu_t *self)
+{
+  return self->mem;
+}
+
+// vim: foldmethod=marker
@@ -19,16 +19,65 @@ typedef struct mmu_t mmu_t;
 #include "err.h"
 #include "cpu.h"
 
-// tamanho de uma página, em palavras de memória
-// t2: pode ser alterado para comparar configurações diferentes
-#define TAM_PAGINA 10
+#include <stdio.h>
+
+// a MMU tem um modelo de TLB (cache de traduções), para medir o custo da
+//   tradução de endereços; a TLB não altera o resultado dos acessos, nem os
+//   bits de acesso e alteração (que continuam sendo marcados na tabela de
+//   páginas a cada acesso), só conta acertos e faltas e, se configurado,
+//   cobra um custo em tempo a cada falta (ver mmu_ciclos_extras)
+// as traduções são feitas com a TLB em todo acesso em modo usuário com tabela
+//   de páginas, e também a cada mmu_traduz (com os motores de execução
+//   pré-decodificado e de blocos, a CPU traduz com mmu_traduz)
+// com ASIDs, cada entrada é marcada com o identificador do espaço de
+//   endereçamento em que foi carregada (o ASID da tabela de páginas, ver
+//   tabpag_asid), e a troca de tabela não esvazia a TLB; sem ASIDs, toda
+//   troca de tabela de páginas esvazia a TLB
+// quando o SO altera a tabela de páginas, deve invalidar as entradas
+//   correspondentes (mmu_invalida_pagina, mmu_invalida_asid, mmu_esvazia_tlb),
+//   como em uma MMU real
+
+// política de substituição das entradas de um conjunto
+typedef enum {
+  tlb_lru,        // a usada há mais tempo
+  tlb_fifo,       // a carregada há mais tempo
+  tlb_aleatoria,  // qualquer uma (pseudo-aleatória, mas reprodutível)
+} tlb_politica_t;
+
+typedef struct {
+  // número de entradas (0 desliga a TLB)
+  int entradas;
+  // número de entradas por conjunto; deve dividir 'entradas' (1 é
+  //   mapeamento direto, 'entradas' é totalmente associativa)
+  int vias;
+  tlb_politica_t politica;
+  // se as entradas são marcadas com o ASID
+  bool usa_asid;
+  // unidades de tempo cobradas a cada falta na TLB
+  int custo_falta;
+} mmu_config_tlb_t;
+
+typedef struct {
+  long acertos;
+  long faltas;
+  // número de vezes que a TLB foi esvaziada, e de entradas invalidadas
+  //   (por esvaziamento ou invalidação de página ou ASID)
+  long esvaziamentos;
+  long invalidadas;
+  // número de trocas de tabela de páginas (mmu_define_tabpag*)
+  long trocas;
+} mmu_estat_tlb_t;
 
 // cria uma MMU para gerenciar acessos à memória
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa MMU
-// recebe 'mem', a memória física que será gerenciada
+// recebe 'mem', a memória física que será gerenciada, e o tamanho de uma
+//   página (e de um quadro), em palavras de memória, que deve ser uma
+//   potência de 2; a tradução separa página e deslocamento com deslocamento
+//   de bits e máscara
+// t2: o tamanho pode ser alterado para comparar configurações diferentes
 // mata o programa em caso de erro (malloc)
-mmu_t *mmu_cria(mem_t *mem);
+mmu_t *mmu_cria(mem_t *mem, int tam_pagina);
 
 // destrói uma MMU
 // nenhuma outra operação pode ser realizada na MMU após esta chamada
@@ -36,8 +85,45 @@ void mmu_destroi(mmu_t *self);
 
 // define a tabela de páginas a usar nas próximas traduções
 // se tabpag for NULL, os acessos serão repassados sem alteração à memória
+// usa o ASID da tabela (tabpag_asid); se a TLB usa ASIDs, não esvazia a TLB
+//   (as entradas das outras tabelas continuam lá, para quando voltarem a ser
+//   usadas); senão, esvazia se a tabela for diferente da atual
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag);
 
+// define a tabela de páginas como mmu_define_tabpag, mas identificada pelo
+//   ASID 'asid', escolhido pelo SO em vez do da tabela (por exemplo, para
+//   ter um número limitado de ASIDs, como em uma MMU real; o SO deve então
+//   invalidar as entradas de um ASID antes de reusá-lo)
+void mmu_define_tabpag_asid(mmu_t *self, tabpag_t *tabpag, int asid);
+
+// altera a configuração da TLB (a TLB é esvaziada)
+// a configuração inicial é uma TLB desligada
+void mmu_configura_tlb(mmu_t *self, mmu_config_tlb_t config);
+
+// invalida a entrada da TLB para a página 'pagina' do ASID atual
+void mmu_invalida_pagina(mmu_t *self, int pagina);
+
+// invalida todas as entradas da TLB com o ASID 'asid' (por exemplo, antes de
+//   reusar o ASID para outro processo)
+void mmu_invalida_asid(mmu_t *self, int asid);
+
+// invalida todas as entradas da TLB
+void mmu_esvazia_tlb(mmu_t *self);
+
+// retorna a configuração atual da TLB
+mmu_config_tlb_t mmu_config_tlb(mmu_t *self);
+
+// retorna as estatísticas da TLB, desde a criação da MMU
+mmu_estat_tlb_t mmu_estat_tlb(mmu_t *self);
+
+// imprime a configuração e as estatísticas da TLB no arquivo 'arq'
+void mmu_imprime_tlb(mmu_t *self, FILE *arq);
+
+// retorna as unidades de tempo cobradas pelas faltas na TLB desde a chamada
+//   anterior (e zera a contagem); a CPU espera esse tempo, além do das
+//   instruções (ver cpu_executa_n)
+int mmu_ciclos_extras(mmu_t *self);
+
 // coloca na posição apontada por 'pvalor' o valor que está na memória
 //   no endereço físico correspondente ao endereço virtual 'endvirt'
 // marca a página como acessada se o acesso for bem sucedido
@@ -58,4 +144,72 @@ err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo);
 //   à memória sem tradução
 err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo);
 
+// copia para 'dados' os 'n' valores a partir do endereço virtual 'endvirt',
+//   página a página (uma tradução e uma marcação de acesso por página)
+// retorna erro como mmu_le se alguma página não puder ser acessada; nesse
+//   caso, as páginas anteriores já foram copiadas
+err_t mmu_le_bloco(mmu_t *self, int endvirt, int n, int dados[n],
+                   cpu_modo_t modo);
+
+// copia os 'n' valores em 'dados' para a memória a partir do endereço virtual
+//   'endvirt', página a página, como mmu_le_bloco
+err_t mmu_escreve_bloco(mmu_t *self, int endvirt, int n, int dados[n],
+                        cpu_modo_t modo);
+
+// coloca em '*pendfis' o endereço físico correspondente ao endereço virtual
+//   'endvirt', sem acessar a memória e sem marcar a página como acessada
+// retorna o mesmo erro que mmu_le retornaria para esse endereço
+// em modo supervisor ou sem tabela de páginas, o endereço não é traduzido
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo);
+
+// marca como acessada (e como alterada, se 'alteracao' for true) a página que
+//   contém o endereço virtual 'endvirt', como faria um acesso bem sucedido
+// não faz nada em modo supervisor ou se não tiver tabela de páginas
+void mmu_marca_acesso(mmu_t *self, int endvirt, bool alteracao, cpu_modo_t modo);
+
+// acesso direto, para a micro-TLB da CPU
+// a CPU pode guardar o quadro de uma página já traduzida, e acessar o
+//   conteúdo dele diretamente, sem passar pela MMU a cada acesso; para isso,
+//   a tradução tem que continuar valendo (ver mmu_geracao), a página tem
+//   que ter os bits de acesso e alteração marcados como se cada acesso fosse
+//   feito pela MMU, e, com a TLB ligada, os acessos diretos têm que ser
+//   contados como acertos (ver mmu_conta_acertos_tlb)
+
+// retorna um número que muda sempre que as traduções obtidas com
+//   mmu_quadro_direto podem ter deixado de valer (troca ou alteração da
+//   tabela de páginas, invalidações, reconfiguração da TLB, substituição de
+//   uma entrada da TLB)
+unsigned mmu_geracao(mmu_t *self);
+
+// traduz a página 'pagina' e retorna um ponteiro para o conteúdo do quadro
+//   correspondente (mmu_tam_pagina valores) na memória do hospedeiro, só para
+//   leitura; coloca em '*pend_quadro' o endereço físico do início do quadro
+// marca a página como acessada (e alterada, se 'alteracao'), e, se
+//   'consulta', faz a consulta na TLB (se ligada), como faria um acesso bem
+//   sucedido com mmu_le (ou mmu_escreve) à página; sem 'consulta', a página
+//   é só marcada, como com mmu_marca_acesso
+// retorna NULL, sem marcar a página nem consultar a TLB, se a tradução falhar
+//   ou se o quadro não estiver todo na memória; o acesso deve então ser feito
+//   com mmu_le ou mmu_escreve, que dirão o erro
+// em modo supervisor ou sem tabela de páginas, a página não é traduzida
+const int *mmu_quadro_direto(mmu_t *self, int pagina, bool alteracao,
+                             bool consulta, cpu_modo_t modo, int *pend_quadro);
+
+// conta 'n' acertos na TLB para a página 'pagina', feitos com o quadro obtido
+//   por mmu_quadro_direto sem passar pela MMU
+// deve ser chamada antes da próxima consulta à TLB, para que os usos (e as
+//   substituições pela política LRU) fiquem na ordem certa em relação a ela
+// não faz nada se a TLB estiver desligada ou sem tabela de páginas
+void mmu_conta_acertos_tlb(mmu_t *self, int pagina, int n);
+
+// retorna o tamanho de uma página, em palavras de memória
+int mmu_tam_pagina(mmu_t *self);
+
+// retorna o número de bits do deslocamento dentro da página (o tamanho da
+//   página é 2 elevado a esse número)
+int mmu_bits_pagina(mmu_t *self);
+
+// retorna a memória física gerenciada pela MMU
+mem_t *mmu_mem(mmu_t *self);
+
 #endif // MMU_H
@@ -0,0 +1,76 @@
+// pic.h
+// controlador de interrupções
+// simulador de computador
+// so24b
+
+#ifndef PIC_H
+#define PIC_H
+
+// o controlador de interrupções recebe os pedidos de interrupção dos
+//   dispositivos e os repassa para a CPU
+// um pedido fica pendente até ser aceito pela CPU (que não aceita
+//   interrupções em modo supervisor) ou cancelado pelo dispositivo; cada
+//   pedido é repassado uma vez só
+// cada interrupção tem uma prioridade (a maior é entregue primeiro) e pode ser
+//   habilitada ou não; as interrupções de teclado e tela iniciam
+//   desabilitadas, e devem ser habilitadas pelo SO se quiser recebê-las
+// os dispositivos podem agendar eventos para acontecerem em um instante
+//   futuro (em unidades de tempo do relógio); o controlador os mantém em
+//   um heap ordenado pelo instante, e o controlador da CPU só precisa
+//   intervir quando o primeiro vence
+
+#include "err.h"
+#include "irq.h"
+
+#include <stdbool.h>
+
+typedef struct pic_t pic_t;
+
+// função chamada quando vence um evento agendado
+// recebe o argumento e o dado fornecidos no agendamento, e retorna true se a
+//   interrupção do evento deve ser pedida
+typedef bool (*pic_f_evento_t)(void *arg, int dado);
+
+// cria e inicializa um controlador de interrupções
+pic_t *pic_cria(void);
+
+// destrói um controlador de interrupções
+void pic_destroi(pic_t *self);
+
+// pede a interrupção 'irq'
+void pic_levanta(pic_t *self, irq_t irq);
+
+// cancela o pedido da interrupção 'irq', se ainda não foi entregue
+void pic_abaixa(pic_t *self, irq_t irq);
+
+// habilita ou desabilita a entrega da interrupção 'irq'
+void pic_habilita(pic_t *self, irq_t irq, bool habilitada);
+
+// altera a prioridade da interrupção 'irq'
+void pic_define_prioridade(pic_t *self, irq_t irq, int prioridade);
+
+// agenda um evento para daqui a 'atraso' unidades de tempo
+// quando o evento vencer, a função 'f' é chamada com 'arg' e 'dado', e se
+//   ela retornar true a interrupção 'irq' é pedida
+void pic_agenda(pic_t *self, int atraso, irq_t irq,
+                pic_f_evento_t f, void *arg, int dado);
+
+// informa a hora atual; os eventos que vencem até essa hora são executados
+void pic_avanca(pic_t *self, long long agora);
+
+// retorna quanto tempo falta para o próximo evento agendado (-1 se nenhum)
+int pic_tempo_ate_evento(pic_t *self);
+
+// coloca em *pirq a interrupção pendente habilitada de maior prioridade
+// retorna false se não houver nenhuma
+bool pic_proxima(pic_t *self, irq_t *pirq);
+
+// Funções para acessar o controlador como dispositivo de E/S, com id:
+//   '0' para ler as interrupções pendentes (bit 'irq' ligado se pendente)
+//   '1' para ler ou escrever as interrupções habilitadas (mesmo formato)
+//   '2' para escrever o número de uma interrupção pendente a cancelar
+// Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h
+err_t pic_leitura(void *disp, int id, int *pvalor);
+err_t pic_escrita(void *disp, int id, int valor);
+
+#endif // PIC_H
@@ -31,4 +31,9 @@ int prog_end_inicio(programa_t *self);
 // valor a colocar na posição 'ender' da memória
 int prog_dado(programa_t *self, int ender);
 
+// todos os valores do programa, a colocar na memória a partir de
+//   prog_end_carga (são prog_tamanho valores)
+// o vetor pertence ao programa, e deixa de existir com prog_destroi
+int *prog_dados(programa_t *self);
+
 #endif // PROGRAMA_H
@@ -0,0 +1,80 @@
+// rastro.h
+// registro de eventos da simulação, para ver a linha do tempo de uma execução
+// simulador de computador
+// so24b
+
+#ifndef RASTRO_H
+#define RASTRO_H
+
+// o rastro guarda os últimos RASTRO_CAPACIDADE eventos em um vetor circular
+//   (os mais antigos são sobrescritos), cada um com o instante no relógio
+//   simulado e no relógio do hospedeiro (em ns), o tipo e dois dados
+// no final, os eventos podem ser gravados em um arquivo no formato de rastro
+//   do chrome (json), que pode ser aberto em chrome://tracing ou em
+//   ui.perfetto.dev; o tempo na linha do tempo é o do relógio simulado (cada
+//   unidade aparece como 1us), o do hospedeiro vai nos argumentos
+// os eventos são registrados pelas macros abaixo, que custam um teste quando
+//   o rastro está desligado (o padrão), e nada se o simulador for compilado
+//   com SEM_RASTRO definido (make CPPFLAGS=-DSEM_RASTRO)
+// o rastro é único, e só deve ser usado pela thread da simulação
+
+#include "relogio.h"
+
+#include <stdbool.h>
+
+#define RASTRO_CAPACIDADE (1 << 16)
+
+typedef enum {
+  rastro_interrupcao,   // SO atendendo interrupção (a: irq)
+  rastro_escalona,      // SO escolheu processo (a: pid, -1 se nenhum)
+  rastro_despacha,      // SO retornou para a CPU (a: pid, b: 1 se vai parar)
+  rastro_estado,        // processo mudou de estado (a: pid, b: estado)
+  rastro_chamada,       // chamada de sistema (a: pid, b: número da chamada)
+  rastro_falta_pagina,  // tradução de endereço falhou (a: endereço, b: página)
+  rastro_le_es,         // leitura de dispositivo (a: dispositivo, b: valor)
+  rastro_escreve_es,    // escrita em dispositivo (a: dispositivo, b: valor)
+  N_RASTRO_EVENTOS
+} rastro_evento_t;
+
+// fase do evento: instantâneo, ou início e fim de um intervalo
+typedef enum {
+  rastro_instante,
+  rastro_inicio,
+  rastro_fim,
+} rastro_fase_t;
+
+#ifndef SEM_RASTRO
+// liga o registro de eventos; o relógio é usado para o tempo simulado
+void rastro_liga(relogio_t *relogio);
+
+// define nomes para os valores do dado b de um tipo de evento (por exemplo,
+//   os estados dos processos), usados para nomear os eventos no arquivo;
+//   'nomes' deve continuar existindo até a gravação
+void rastro_define_nomes(rastro_evento_t evento, int n, char *nomes[n]);
+
+// grava os eventos registrados no arquivo 'nome'
+// retorna false se não conseguir criar o arquivo
+bool rastro_grava(char *nome);
+
+// registra um evento (use as macros)
+void rastro_registra(rastro_evento_t evento, rastro_fase_t fase, int a, int b);
+
+extern bool rastro_ligado;
+
+#define RASTRO(evento, a, b) \
+  do { if (rastro_ligado) rastro_registra(evento, rastro_instante, a, b); } while (0)
+#define RASTRO_INICIO(evento, a, b) \
+  do { if (rastro_ligado) rastro_registra(evento, rastro_inicio, a, b); } while (0)
+#define RASTRO_FIM(evento, a, b) \
+  do { if (rastro_ligado) rastro_registra(evento, rastro_fim, a, b); } while (0)
+#else
+static inline void rastro_liga(relogio_t *relogio) { }
+static inline void rastro_define_nomes(rastro_evento_t evento, int n,
+                                       char *nomes[n]) { }
+static inline bool rastro_grava(char *nome) { return false; }
+#define RASTRO(evento, a, b) do { } while (0)
+#define RASTRO_INICIO(evento, a, b) do { } while (0)
+#define RASTRO_FIM(evento, a, b) do { } while (0)
+#endif
+
+#endif // RASTRO_H
@@ -9,6 +9,8 @@
 #include "irq.h"
 #include "programa.h"
 #include "tabpag.h"
+#include "rastro.h"
+#include "log.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -120,7 +122,7 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
   //   contém o endereço 99 (as 100 primeiras posições de memória (pelo menos)
   //   não vão ser usadas por programas de usuário)
   // t2: o controle de memória livre deve ser mais aprimorado que isso  
-  self->quadro_livre = 99 / TAM_PAGINA + 1;
+  self->quadro_livre = 99 / mmu_tam_pagina(self->mmu) + 1;
   return self;
 }
 
@@ -158,8 +160,10 @@ static int so_trata_interrupcao(void *argC, int reg_A)
 {
   so_t *self = argC;
   irq_t irq = reg_A;
-  // esse print polui bastante, recomendo tirar quando estiver com mais confiança
-  console_printf("SO: recebi IRQ %d (%s)", irq, irq_nome(irq));
+  // esse print polui bastante; é de depuração, só vai para o log com a
+  //   opção -v
+  LOG(log_depura, log_so, "SO: recebi IRQ %d (%s)", irq, irq_nome(irq));
+  RASTRO_INICIO(rastro_interrupcao, irq, 0);
   // salva o estado da cpu no descritor do processo que foi interrompido
   so_salva_estado_da_cpu(self);
   // faz o atendimento da interrupção
@@ -169,7 +173,9 @@ static int so_trata_interrupcao(void *argC, int reg_A)
   // escolhe o próximo processo a executar
   so_escalona(self);
   // recupera o estado do processo escolhido
-  return so_despacha(self);
+  int para = so_despacha(self);
+  RASTRO_FIM(rastro_interrupcao, irq, 0);
+  return para;
 }
 
 static void so_salva_estado_da_cpu(so_t *self)
@@ -197,6 +203,8 @@ static void so_escalona(so_t *self)
   //   executando. depois, implementar escalonador melhor
 }
 
+static void so_desarma_relogio(so_t *self);
+
 static int so_despacha(so_t *self)
 {
   // t1: se houver processo corrente, coloca o estado desse processo onde ele
@@ -204,10 +212,28 @@ static int so_despacha(so_t *self)
   // o valor retornado será o valor de retorno de CHAMAC
   // passa o processador para modo usuário
   mem_escreve(self->mem, IRQ_END_erro, ERR_OK);
-  if (self->erro_interno) return 1;
+  RASTRO(rastro_despacha, -1, self->erro_interno);
+  if (self->erro_interno) {
+    // a CPU vai ficar parada para sempre
+    so_desarma_relogio(self);
+    return 1;
+  }
   else return 0;
 }
 
+// desliga o relógio quando o SO não tem mais o que executar, para ele não
+//   continuar gerando interrupções; sem nada agendado, a execução sem
+//   operador (main -l) termina
+static void so_desarma_relogio(so_t *self)
+{
+  err_t e1, e2;
+  e1 = es_escreve(self->es, D_RELOGIO_INTERRUPCAO, 0);
+  e2 = es_escreve(self->es, D_RELOGIO_TIMER, 0);
+  if (e1 != ERR_OK || e2 != ERR_OK) {
+    console_printf("SO: problema ao desarmar o timer");
+  }
+}
+
 // TRATAMENTO DE UMA IRQ {{{1
 
 // funções auxiliares para tratar cada tipo de interrupção
@@ -295,7 +321,7 @@ static void so_trata_irq_relogio(so_t *self)
   // t1: deveria tratar a interrupção
   //   por exemplo, decrementa o quantum do processo corrente, quando se tem
   //   um escalonador com quantum
-  console_printf("SO: interrupção do relógio (não tratada)");
+  LOG(log_depura, log_so, "SO: interrupção do relógio (não tratada)");
 }
 
 // foi gerada uma interrupção para a qual o SO não está preparado
@@ -324,7 +350,7 @@ static void so_trata_irq_chamada_sistema(so_t *self)
     self->erro_interno = true;
     return;
   }
-  console_printf("SO: chamada de sistema %d", id_chamada);
+  LOG(log_depura, log_so, "SO: chamada de sistema %d", id_chamada);
   switch (id_chamada) {
     case SO_LE:
       so_chamada_le(self);
@@ -511,11 +537,11 @@ static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *program
   int end_ini = prog_end_carga(programa);
   int end_fim = end_ini + prog_tamanho(programa);
 
-  for (int end = end_ini; end < end_fim; end++) {
-    if (mem_escreve(self->mem, end, prog_dado(programa, end)) != ERR_OK) {
-      console_printf("Erro na carga da memória, endereco %d\n", end);
-      return -1;
-    }
+  if (mem_escreve_bloco(self->mem, end_ini, prog_tamanho(programa),
+                        prog_dados(programa)) != ERR_OK) {
+    console_printf("Erro na carga da memória, endereços %d-%d\n", end_ini,
+                   end_fim);
+    return -1;
   }
   console_printf("carregado na memória física, %d-%d", end_ini, end_fim);
   return end_ini;
@@ -534,10 +560,11 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self,
   //   colocadas na memória principal por demanda. Para simplificar ainda mais, a
   //   memória secundária pode ser alocada da forma como a principal está sendo
   //   alocada aqui (sem reuso)
+  int tam_pagina = mmu_tam_pagina(self->mmu);
   int end_virt_ini = prog_end_carga(programa);
   int end_virt_fim = end_virt_ini + prog_tamanho(programa) - 1;
-  int pagina_ini = end_virt_ini / TAM_PAGINA;
-  int pagina_fim = end_virt_fim / TAM_PAGINA;
+  int pagina_ini = end_virt_ini / tam_pagina;
+  int pagina_fim = end_virt_fim / tam_pagina;
   int quadro_ini = self->quadro_livre;
   // mapeia as páginas nos quadros
   int quadro = quadro_ini;
@@ -548,18 +575,17 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self,
   self->quadro_livre = quadro;
 
   // carrega o programa na memória principal
-  int end_fis_ini = quadro_ini * TAM_PAGINA;
-  int end_fis = end_fis_ini;
-  for (int end_virt = end_virt_ini; end_virt <= end_virt_fim; end_virt++) {
-    if (mem_escreve(self->mem, end_fis, prog_dado(programa, end_virt)) != ERR_OK) {
-      console_printf("Erro na carga da memória, end virt %d fís %d\n", end_virt,
-                     end_fis);
-      return -1;
-    }
-    end_fis++;
+  //   (os quadros são consecutivos, o programa é copiado de uma vez)
+  int end_fis_ini = quadro_ini * tam_pagina;
+  int end_fis_fim = end_fis_ini + prog_tamanho(programa) - 1;
+  if (mem_escreve_bloco(self->mem, end_fis_ini, prog_tamanho(programa),
+                        prog_dados(programa)) != ERR_OK) {
+    console_printf("Erro na carga da memória, end virt %d-%d fís %d-%d\n",
+                   end_virt_ini, end_virt_fim, end_fis_ini, end_fis_fim);
+    return -1;
   }
   console_printf("carregado na memória virtual V%d-%d F%d-%d",
-                 end_virt_ini, end_virt_fim, end_fis_ini, end_fis - 1);
+                 end_virt_ini, end_virt_fim, end_fis_ini, end_fis_fim);
   return end_virt_ini;
 }
 
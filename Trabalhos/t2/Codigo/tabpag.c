@@ -7,6 +7,21 @@
 #include <stdlib.h>
 #include <assert.h>
 
+// CONSTANTES E TIPOS {{{1
+
+// linear: capacidade mínima do vetor de descritores
+#define CAP_MINIMA_LINEAR 16
+// dois níveis: número de bits da página que indexam a tabela de segundo
+//   nível (os demais indexam o diretório), e capacidade mínima do diretório
+#define BITS_NIVEL2 10
+#define TAM_NIVEL2 (1 << BITS_NIVEL2)
+#define CAP_MINIMA_DIRETORIO 4
+// invertida: capacidade inicial da tabela global (potência de 2), e marcas
+//   das posições livres
+#define CAP_INICIAL_INVERTIDA 256
+#define INV_VAZIA -1
+#define INV_REMOVIDA -2
+
 // estrutura auxiliar, contém informação sobre uma página
 typedef struct {
   // quadro da memória principal correspondente à página
@@ -19,119 +34,438 @@ typedef struct {
   bool alterada;
 } descritor_t;
 
+// uma tabela de segundo nível da tabela em dois níveis
+typedef struct {
+  // número de páginas válidas na tabela
+  int n_validas;
+  descritor_t descritores[TAM_NIVEL2];
+} nivel2_t;
+
+// uma posição da tabela invertida
+typedef struct {
+  // identificação da tabela dona da página (ou INV_VAZIA, INV_REMOVIDA)
+  int dona;
+  int pagina;
+  descritor_t descritor;
+} entrada_inv_t;
+
 struct tabpag_t {
-  // número de descritores na tabela (pode ser 0)
+  tabpag_tipo_t tipo;
+  // alterada a cada mudança feita pelo SO (ver tabpag_versao)
+  int versao;
+  // número de páginas válidas
+  int n_validas;
+  // linear: número de descritores na tabela (pode ser 0), e capacidade do
+  //   vetor; o último descritor do vetor sempre contém uma página válida
   int tam_tab;
-  // vetor com os descritores
-  // o último descritor do vetor sempre contém uma página válida
-  // pode ser NULL (se tam_tab == 0)
+  int cap_tab;
+  // vetor com os descritores (pode ser NULL, se cap_tab == 0)
   descritor_t *tabela;
+  // dois níveis: diretório, com 'n_dir' tabelas de segundo nível (NULL se
+  //   não tiver página válida)
+  int n_dir;
+  nivel2_t **diretorio;
+  int n_nivel2;
+  // identificação da tabela, diferente para cada tabela criada: é o ASID
+  //   (ver tabpag_asid) e, na invertida, marca as entradas da tabela global
+  int id;
 };
 
+// a tabela invertida global, compartilhada por todas as tabelas desse tipo
+// é uma tabela hash com endereçamento aberto, indexada pela identificação da
+//   tabela e pelo número da página, com uma entrada por página válida
+static struct {
+  entrada_inv_t *entradas;
+  int cap;
+  // posições não vazias (com página ou marcadas como removida)
+  int ocupadas;
+  // número de páginas válidas, de todas as tabelas
+  int n_validas;
+} invertida;
+
+// identificação da próxima tabela criada (0 fica para "sem tabela")
+static int prox_id = 1;
+
+static tabpag_tipo_t tipo_padrao = tabpag_linear;
+
+static char *nomes_tipos[N_TABPAG_TIPOS] = {
+  [tabpag_linear] = "linear",
+  [tabpag_dois_niveis] = "niveis",
+  [tabpag_invertida] = "invertida",
+};
+
+// CRIAÇÃO {{{1
+
 tabpag_t *tabpag_cria(void)
+{
+  return tabpag_cria_tipo(tipo_padrao);
+}
+
+tabpag_t *tabpag_cria_tipo(tabpag_tipo_t tipo)
 {
   tabpag_t *self = malloc(sizeof(*self));
   assert(self != NULL);
+  self->tipo = tipo;
+  self->versao = 0;
+  self->n_validas = 0;
   self->tam_tab = 0;
+  self->cap_tab = 0;
   self->tabela = NULL;
+  self->n_dir = 0;
+  self->diretorio = NULL;
+  self->n_nivel2 = 0;
+  self->id = prox_id++;
   return self;
 }
 
+static void inv_remove_tabela(tabpag_t *self);
+
 void tabpag_destroi(tabpag_t *self)
 {
   if (self != NULL) {
     if (self->tabela != NULL) free(self->tabela);
+    for (int d = 0; d < self->n_dir; d++) {
+      free(self->diretorio[d]);
+    }
+    free(self->diretorio);
+    if (self->tipo == tabpag_invertida) inv_remove_tabela(self);
     free(self);
   }
 }
 
-// retorna true se a página for válida (pode ser traduzida em um quadro)
-static bool tabpag__pagina_valida(tabpag_t *self, int pagina)
+void tabpag_define_tipo_padrao(tabpag_tipo_t tipo)
 {
-  if (pagina < 0 || pagina >= self->tam_tab) return false;
-  return self->tabela[pagina].valida;
+  tipo_padrao = tipo;
 }
 
-void tabpag_invalida_pagina(tabpag_t *self, int pagina)
+char *tabpag_nome_do_tipo(tabpag_tipo_t tipo)
 {
-  // página já é inválida -- não faz nada
-  if (!tabpag__pagina_valida(self, pagina)) return;
-  // página não é a última da tabela -- marca como inválida
-  if (pagina < self->tam_tab - 1) {
-    self->tabela[pagina].valida = false;
-    return;
-  }
-  // última página na tabela -- reduz a tabela até que a última seja válida
-  do {
-    self->tam_tab--;
-  } while (self->tam_tab > 0 && !self->tabela[self->tam_tab - 1].valida);
-  if (self->tam_tab == 0) {
+  return nomes_tipos[tipo];
+}
+
+// LINEAR {{{1
+
+static descritor_t *lin_busca(tabpag_t *self, int pagina)
+{
+  if (pagina < 0 || pagina >= self->tam_tab) return NULL;
+  return &self->tabela[pagina];
+}
+
+static void lin_muda_capacidade(tabpag_t *self, int cap)
+{
+  if (cap == 0) {
     free(self->tabela);
     self->tabela = NULL;
   } else {
-    self->tabela = realloc(self->tabela, self->tam_tab * sizeof(descritor_t));
+    self->tabela = realloc(self->tabela, cap * sizeof(descritor_t));
     assert(self->tabela != NULL);
   }
+  self->cap_tab = cap;
 }
 
 // aumenta a tabela, se necessário, para que contenha 'pagina'
-static void tabpag__insere_pagina(tabpag_t *self, int pagina)
+// a capacidade dobra, para o custo das realocações ser amortizado
+static descritor_t *lin_insere(tabpag_t *self, int pagina)
 {
-  if (pagina < self->tam_tab) return;
-  int novo_tam = pagina + 1;
-  if (self->tam_tab == 0) {
-    self->tabela = malloc(novo_tam * sizeof(descritor_t));
-  } else {
-    self->tabela = realloc(self->tabela, novo_tam * sizeof(descritor_t));
+  if (pagina >= self->cap_tab) {
+    int cap = self->cap_tab < CAP_MINIMA_LINEAR ? CAP_MINIMA_LINEAR
+                                                : self->cap_tab;
+    while (cap <= pagina) cap *= 2;
+    lin_muda_capacidade(self, cap);
   }
-  assert(self->tabela != NULL);
   // marca as páginas inseridas como não válidas
-  while (self->tam_tab < novo_tam) {
+  while (self->tam_tab <= pagina) {
     self->tabela[self->tam_tab].valida = false;
     self->tam_tab++;
   }
+  return &self->tabela[pagina];
+}
+
+static void lin_remove(tabpag_t *self, int pagina)
+{
+  self->tabela[pagina].valida = false;
+  // última página na tabela -- reduz a tabela até que a última seja válida
+  if (pagina == self->tam_tab - 1) {
+    do {
+      self->tam_tab--;
+    } while (self->tam_tab > 0 && !self->tabela[self->tam_tab - 1].valida);
+  }
+  // só libera espaço quando sobra muito, para não realocar a cada remoção
+  if (self->tam_tab == 0) {
+    lin_muda_capacidade(self, 0);
+  } else if (self->cap_tab > CAP_MINIMA_LINEAR
+             && self->tam_tab <= self->cap_tab / 4) {
+    lin_muda_capacidade(self, self->cap_tab / 2);
+  }
+}
+
+// DOIS NÍVEIS {{{1
+
+static descritor_t *ni_busca(tabpag_t *self, int pagina)
+{
+  if (pagina < 0) return NULL;
+  int d = pagina >> BITS_NIVEL2;
+  if (d >= self->n_dir || self->diretorio[d] == NULL) return NULL;
+  return &self->diretorio[d]->descritores[pagina & (TAM_NIVEL2 - 1)];
+}
+
+static descritor_t *ni_insere(tabpag_t *self, int pagina)
+{
+  int d = pagina >> BITS_NIVEL2;
+  if (d >= self->n_dir) {
+    int n = self->n_dir < CAP_MINIMA_DIRETORIO ? CAP_MINIMA_DIRETORIO
+                                               : self->n_dir;
+    while (n <= d) n *= 2;
+    self->diretorio = realloc(self->diretorio, n * sizeof(*self->diretorio));
+    assert(self->diretorio != NULL);
+    while (self->n_dir < n) {
+      self->diretorio[self->n_dir++] = NULL;
+    }
+  }
+  nivel2_t *nivel2 = self->diretorio[d];
+  if (nivel2 == NULL) {
+    // calloc: todas as páginas inválidas
+    nivel2 = calloc(1, sizeof(*nivel2));
+    assert(nivel2 != NULL);
+    self->diretorio[d] = nivel2;
+    self->n_nivel2++;
+  }
+  descritor_t *descritor = &nivel2->descritores[pagina & (TAM_NIVEL2 - 1)];
+  if (!descritor->valida) nivel2->n_validas++;
+  return descritor;
+}
+
+static void ni_remove(tabpag_t *self, int pagina)
+{
+  int d = pagina >> BITS_NIVEL2;
+  nivel2_t *nivel2 = self->diretorio[d];
+  nivel2->descritores[pagina & (TAM_NIVEL2 - 1)].valida = false;
+  // a tabela de segundo nível sem páginas válidas é liberada
+  if (--nivel2->n_validas == 0) {
+    free(nivel2);
+    self->diretorio[d] = NULL;
+    self->n_nivel2--;
+  }
+}
+
+// INVERTIDA {{{1
+
+// posição da página da tabela na tabela global, ou da posição onde ela
+//   deve ser colocada se não estiver lá ('inserindo' permite reaproveitar
+//   uma posição removida)
+static int inv_posicao(entrada_inv_t *entradas, int cap, int id, int pagina,
+                       bool inserindo)
+{
+  unsigned long long chave = ((unsigned long long)id << 32) | (unsigned)pagina;
+  unsigned pos = (chave * 0x9E3779B97F4A7C15ull) >> 32 & (cap - 1);
+  int removida = -1;
+  for (;;) {
+    entrada_inv_t *e = &entradas[pos];
+    if (e->dona == id && e->pagina == pagina) return pos;
+    if (e->dona == INV_VAZIA) {
+      return (inserindo && removida != -1) ? removida : (int)pos;
+    }
+    if (e->dona == INV_REMOVIDA && removida == -1) removida = pos;
+    pos = (pos + 1) & (cap - 1);
+  }
+}
+
+// refaz a tabela global sem as posições removidas, dobrando de tamanho se
+//   estiver mais da metade ocupada por páginas válidas
+static void inv_refaz(void)
+{
+  int cap = invertida.cap == 0 ? CAP_INICIAL_INVERTIDA : invertida.cap;
+  if (2 * invertida.n_validas >= cap) cap *= 2;
+  entrada_inv_t *entradas = malloc(cap * sizeof(*entradas));
+  assert(entradas != NULL);
+  for (int i = 0; i < cap; i++) {
+    entradas[i].dona = INV_VAZIA;
+  }
+  for (int i = 0; i < invertida.cap; i++) {
+    entrada_inv_t *e = &invertida.entradas[i];
+    if (e->dona >= 0) {
+      entradas[inv_posicao(entradas, cap, e->dona, e->pagina, true)] = *e;
+    }
+  }
+  free(invertida.entradas);
+  invertida.entradas = entradas;
+  invertida.cap = cap;
+  invertida.ocupadas = invertida.n_validas;
+}
+
+static descritor_t *inv_busca(tabpag_t *self, int pagina)
+{
+  if (invertida.cap == 0) return NULL;
+  int pos = inv_posicao(invertida.entradas, invertida.cap, self->id, pagina,
+                        false);
+  if (invertida.entradas[pos].dona != self->id) return NULL;
+  return &invertida.entradas[pos].descritor;
+}
+
+static descritor_t *inv_insere(tabpag_t *self, int pagina)
+{
+  // mantém pelo menos um quarto das posições vazias
+  if (4 * (invertida.ocupadas + 1) > 3 * invertida.cap) inv_refaz();
+  int pos = inv_posicao(invertida.entradas, invertida.cap, self->id, pagina,
+                        true);
+  entrada_inv_t *e = &invertida.entradas[pos];
+  if (e->dona != self->id) {
+    if (e->dona == INV_VAZIA) invertida.ocupadas++;
+    e->dona = self->id;
+    e->pagina = pagina;
+    e->descritor.valida = false;
+  }
+  if (!e->descritor.valida) invertida.n_validas++;
+  return &e->descritor;
+}
+
+static void inv_remove(tabpag_t *self, int pagina)
+{
+  int pos = inv_posicao(invertida.entradas, invertida.cap, self->id, pagina,
+                        false);
+  invertida.entradas[pos].dona = INV_REMOVIDA;
+  invertida.n_validas--;
+}
+
+static void inv_remove_tabela(tabpag_t *self)
+{
+  for (int i = 0; i < invertida.cap && self->n_validas > 0; i++) {
+    if (invertida.entradas[i].dona == self->id) {
+      invertida.entradas[i].dona = INV_REMOVIDA;
+      invertida.n_validas--;
+      self->n_validas--;
+    }
+  }
+}
+
+// OPERAÇÕES {{{1
+
+// retorna o descritor da página, ou NULL se ela não tem descritor (nesse
+//   caso, é inválida)
+static descritor_t *tabpag__busca(tabpag_t *self, int pagina)
+{
+  switch (self->tipo) {
+    case tabpag_dois_niveis: return ni_busca(self, pagina);
+    case tabpag_invertida: return inv_busca(self, pagina);
+    default: return lin_busca(self, pagina);
+  }
+}
+
+// retorna o descritor da página, se ela for válida, ou NULL
+static descritor_t *tabpag__descritor_valido(tabpag_t *self, int pagina)
+{
+  descritor_t *descritor = tabpag__busca(self, pagina);
+  if (descritor == NULL || !descritor->valida) return NULL;
+  return descritor;
+}
+
+void tabpag_invalida_pagina(tabpag_t *self, int pagina)
+{
+  // página já é inválida -- não faz nada
+  if (tabpag__descritor_valido(self, pagina) == NULL) return;
+  self->versao++;
+  self->n_validas--;
+  switch (self->tipo) {
+    case tabpag_dois_niveis: ni_remove(self, pagina); break;
+    case tabpag_invertida: inv_remove(self, pagina); break;
+    default: lin_remove(self, pagina); break;
+  }
 }
 
 void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro)
 {
   assert(pagina >= 0);
-  tabpag__insere_pagina(self, pagina);
-  self->tabela[pagina].quadro = quadro;
-  self->tabela[pagina].valida = true;
-  self->tabela[pagina].acessada = false;
-  self->tabela[pagina].alterada = false;
+  self->versao++;
+  descritor_t *descritor;
+  switch (self->tipo) {
+    case tabpag_dois_niveis: descritor = ni_insere(self, pagina); break;
+    case tabpag_invertida: descritor = inv_insere(self, pagina); break;
+    default: descritor = lin_insere(self, pagina); break;
+  }
+  if (!descritor->valida) self->n_validas++;
+  descritor->quadro = quadro;
+  descritor->valida = true;
+  descritor->acessada = false;
+  descritor->alterada = false;
 }
 
 void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return;
-  self->tabela[pagina].acessada = true;
+  descritor_t *descritor = tabpag__descritor_valido(self, pagina);
+  if (descritor == NULL) return;
+  descritor->acessada = true;
   if (alteracao) {
-    self->tabela[pagina].alterada = true;
+    descritor->alterada = true;
   }
 }
 
 void tabpag_zera_bit_acesso(tabpag_t *self, int pagina)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return;
-  self->tabela[pagina].acessada = false;
+  descritor_t *descritor = tabpag__descritor_valido(self, pagina);
+  if (descritor == NULL) return;
+  self->versao++;
+  descritor->acessada = false;
 }
 
 bool tabpag_bit_acesso(tabpag_t *self, int pagina)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return false;
-  return self->tabela[pagina].acessada;
+  descritor_t *descritor = tabpag__descritor_valido(self, pagina);
+  if (descritor == NULL) return false;
+  return descritor->acessada;
 }
 
 bool tabpag_bit_alteracao(tabpag_t *self, int pagina)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return false;
-  return self->tabela[pagina].alterada;
+  descritor_t *descritor = tabpag__descritor_valido(self, pagina);
+  if (descritor == NULL) return false;
+  return descritor->alterada;
 }
 
 err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return ERR_PAG_AUSENTE;
-  *pquadro = self->tabela[pagina].quadro;
+  descritor_t *descritor = tabpag__descritor_valido(self, pagina);
+  if (descritor == NULL) return ERR_PAG_AUSENTE;
+  *pquadro = descritor->quadro;
   return ERR_OK;
 }
+
+int tabpag_versao(tabpag_t *self)
+{
+  return self->versao;
+}
+
+// ESPAÇO OCUPADO {{{1
+
+long tabpag_bytes(tabpag_t *self)
+{
+  long bytes = sizeof(*self);
+  switch (self->tipo) {
+    case tabpag_dois_niveis:
+      bytes += (long)self->n_dir * sizeof(*self->diretorio);
+      bytes += (long)self->n_nivel2 * sizeof(nivel2_t);
+      break;
+    case tabpag_invertida:
+      // a parte da tabela global proporcional às páginas da tabela
+      if (invertida.n_validas > 0) {
+        bytes += (long)invertida.cap * sizeof(entrada_inv_t) * self->n_validas
+                 / invertida.n_validas;
+      }
+      break;
+    default:
+      bytes += (long)self->cap_tab * sizeof(descritor_t);
+      break;
+  }
+  return bytes;
+}
+
+int tabpag_n_validas(tabpag_t *self)
+{
+  return self->n_validas;
+}
+
+int tabpag_asid(tabpag_t *self)
+{
+  return self->id;
+}
+
+// vim: foldmethod=marker
@@ -18,14 +18,38 @@
 // tipo opaco que representa a tabela de páginas
 typedef struct tabpag_t tabpag_t;
 
-// cria uma tabela de páginas
+// forma de organizar a tabela; todas têm o mesmo comportamento, mudam o
+//   espaço ocupado e o custo das operações
+typedef enum {
+  tabpag_linear,       // um vetor com um descritor para cada página, da 0
+                       //   até a última válida
+  tabpag_dois_niveis,  // um diretório de tabelas de segundo nível, cada uma
+                       //   com os descritores de um trecho de páginas; só
+                       //   existem as tabelas com alguma página válida
+  tabpag_invertida,    // uma tabela hash global, compartilhada por todas as
+                       //   tabelas desse tipo, com um descritor por página
+                       //   válida
+  N_TABPAG_TIPOS
+} tabpag_tipo_t;
+
+// cria uma tabela de páginas, do tipo padrão (ver tabpag_define_tipo_padrao)
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa tabela
 // mata o programa em caso de erro (malloc)
 tabpag_t *tabpag_cria(void);
 
+// cria uma tabela de páginas do tipo 'tipo'
+tabpag_t *tabpag_cria_tipo(tabpag_tipo_t tipo);
+
+// define o tipo das tabelas criadas com tabpag_cria (o padrão é
+//   tabpag_linear)
+void tabpag_define_tipo_padrao(tabpag_tipo_t tipo);
+
+// retorna o nome do tipo de tabela ("linear", "niveis" ou "invertida")
+char *tabpag_nome_do_tipo(tabpag_tipo_t tipo);
+
 // destrói uma tabela de páginas
-// libera a memória ocupara pela tabela
+// libera a memória ocupada pela tabela
 // nenhuma outra operação pode ser realizada na tabela após esta chamada
 void tabpag_destroi(tabpag_t *self);
 
@@ -61,4 +85,24 @@ bool tabpag_bit_alteracao(tabpag_t *self, int pagina);
 // retorna ERR_PAG_AUSENTE (e não altera '*pquadro') se a página for inválida
 err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro);
 
+// retorna a versão da tabela, um número que muda a cada alteração feita com
+//   tabpag_define_quadro, tabpag_invalida_pagina ou tabpag_zera_bit_acesso
+// a marcação dos bits (tabpag_marca_bit_acesso) não muda a versão
+// serve para quem guarda traduções feitas com a tabela (a MMU) saber se elas
+//   continuam valendo
+int tabpag_versao(tabpag_t *self);
+
+// retorna o espaço ocupado pela tabela na memória do hospedeiro, em bytes
+// para a tabela invertida, conta a parte da tabela global proporcional ao
+//   número de páginas válidas da tabela
+long tabpag_bytes(tabpag_t *self);
+
+// retorna o número de páginas válidas na tabela
+int tabpag_n_validas(tabpag_t *self);
+
+// retorna o identificador do espaço de endereçamento da tabela (ASID), usado
+//   pela TLB da MMU para distinguir as traduções de tabelas diferentes
+// cada tabela criada recebe um ASID diferente, maior que 0
+int tabpag_asid(tabpag_t *self);
+
 #endif // TABPAG_H